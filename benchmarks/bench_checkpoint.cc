@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include "common.hh"
+#include "solver/checkpoint.hh"
+
+using namespace qps;
+using namespace qps::bench;
+
+namespace {
+
+std::string temp_path(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// one snapshot of an n-site mps with bond dimension chi, committed (and
+// synced) like a solver step
+void BM_CheckpointWrite(benchmark::State& state) {
+    const int chi = static_cast<int>(state.range(0));
+    const auto compression = static_cast<Compression>(state.range(1));
+    const int n = 16;
+    std::vector<Tensor> sites;
+    for (int i = 0; i < n; ++i) sites.push_back(random_tensor({chi, 2, chi}, {"l", "s", "r"}));
+    const std::string path = temp_path("qps_bench.qpsc");
+
+    int64_t bytes = 0;
+    try {
+        CheckpointWriter writer(path, compression);
+        int64_t step = 0;
+        for (auto _ : state) {
+            for (int i = 0; i < n; ++i) writer.write("site_" + std::to_string(i), sites[i], step, 0.0);
+            writer.commit(step++, 0.0);
+        }
+        bytes = static_cast<int64_t>(n) * sites[0].data.size() * sizeof(Tensor::Scalar);
+    } catch (const std::exception& e) {
+        state.SkipWithError(e.what());
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    std::remove(path.c_str());
+}
+BENCHMARK(BM_CheckpointWrite)
+    ->ArgsProduct({{8, 32, 128}, {static_cast<int>(Compression::none), static_cast<int>(Compression::zlib)}})
+    ->UseRealTime()  // the fsync in commit is wall time, not cpu time
+    ->Unit(benchmark::kMillisecond);
+
+// reading a whole snapshot back through the mapping
+void BM_CheckpointRead(benchmark::State& state) {
+    const int chi = static_cast<int>(state.range(0));
+    const int n = 16;
+    const std::string path = temp_path("qps_bench_read.qpsc");
+    {
+        CheckpointWriter writer(path);
+        for (int i = 0; i < n; ++i) writer.write("site_" + std::to_string(i), random_tensor({chi, 2, chi}, {"l", "s", "r"}), 0, 0.0);
+        writer.commit(0, 0.0);
+    }
+    CheckpointReader reader(path);
+    for (auto _ : state) {
+        for (int i = 0; i < n; ++i) benchmark::DoNotOptimize(reader.read(reader.records()[i]));
+    }
+    state.SetBytesProcessed(state.iterations() * n * static_cast<int64_t>(chi) * chi * 2 * sizeof(Tensor::Scalar));
+    std::remove(path.c_str());
+}
+BENCHMARK(BM_CheckpointRead)->RangeMultiplier(4)->Range(8, 128)->Unit(benchmark::kMicrosecond);
+
+} // namespace
@@ -0,0 +1,128 @@
+#include <benchmark/benchmark.h>
+#include "common.hh"
+#include "solver/fixed_kernels.hh"
+#include "solver/solver.hh"
+#include <unsupported/Eigen/MatrixFunctions>
+
+using namespace qps;
+using namespace qps::bench;
+
+namespace {
+
+// one TEBD step (forward and backward sweep) of a random nearest-neighbour
+// chain, by site count and local dimension. the propagators are cached after
+// the first iteration, so this times the sweep itself
+void BM_TebdStep(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    const int d = static_cast<int>(state.range(1));
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(random_hermitian(d)));
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(random_hermitian(d * d)));
+    TruncationParams truncation;
+    truncation.max_bond_dim = 32;
+    const auto initial = MatrixProductState::product_state(
+        std::vector<Eigen::VectorXcd>(n, Eigen::VectorXcd::Ones(d).normalized()));
+
+    for (auto _ : state) {
+        TimeEvolutionSolver solver(0.05, 1, onsite);
+        solver.set_bond_operators(bonds);
+        solver.set_truncation(truncation);
+        solver.initialize_state(initial);
+        solver.build_network({});
+        benchmark::DoNotOptimize(solver.state().norm());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_TebdStep)
+    ->ArgsProduct({{8, 16, 32}, {2, 3}})
+    ->Unit(benchmark::kMillisecond);
+
+// the same chain after a few steps have built up entanglement, so the bonds
+// run at the truncation limit
+void BM_TebdSteadyStep(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    const int chi = static_cast<int>(state.range(1));
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(random_hermitian(2)));
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(random_hermitian(4)));
+    TruncationParams truncation;
+    truncation.max_bond_dim = chi;
+
+    TimeEvolutionSolver warmup(0.5, 20, onsite);
+    warmup.set_bond_operators(bonds);
+    warmup.set_truncation(truncation);
+    warmup.initialize_state(MatrixProductState::product_state(
+        std::vector<Eigen::VectorXcd>(n, Eigen::VectorXcd::Ones(2).normalized())));
+    warmup.build_network({});
+    const MatrixProductState entangled = warmup.state();
+
+    for (auto _ : state) {
+        TimeEvolutionSolver solver(0.05, 1, onsite);
+        solver.set_bond_operators(bonds);
+        solver.set_truncation(truncation);
+        solver.initialize_state(entangled);
+        solver.build_network({});
+        benchmark::DoNotOptimize(solver.state().norm());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_TebdSteadyStep)
+    ->ArgsProduct({{16}, {8, 16, 32}})
+    ->Unit(benchmark::kMillisecond);
+
+// imaginary-time steps on a density matrix of dimension d
+void BM_ThermalStep(benchmark::State& state) {
+    const int d = static_cast<int>(state.range(0));
+    const int steps = 10;
+    const std::vector<Tensor> ops = {Tensor::from_matrix(random_hermitian(d))};
+    const Tensor rho0 = Tensor::from_matrix(Eigen::MatrixXcd::Identity(d, d));
+    for (auto _ : state) {
+        ThermalSolver solver(1.0, steps, ops);
+        solver.initialize_state(rho0);
+        solver.build_network({});
+        benchmark::DoNotOptimize(solver.compute_quantity_of_interest());
+    }
+    state.SetItemsProcessed(state.iterations() * steps);
+}
+BENCHMARK(BM_ThermalStep)->RangeMultiplier(2)->Range(4, 256)->Unit(benchmark::kMicrosecond);
+
+// one-site gates on the middle site of a chi-bonded mps, through the
+// fixed-size kernel (generic = 0) or the permute-and-gemm path (generic = 1)
+void BM_SiteGate(benchmark::State& state) {
+    const int chi = static_cast<int>(state.range(0));
+    const int d = static_cast<int>(state.range(1));
+    const bool generic = state.range(2) != 0;
+    std::vector<Tensor> sites = {random_tensor({1, d, chi}, {"a", "s0", "b"}),
+                                 random_tensor({chi, d, chi}, {"b", "s1", "c"}),
+                                 random_tensor({chi, d, 1}, {"c", "s2", "d"})};
+    MatrixProductState mps = MatrixProductState::from_sites(std::move(sites), 1);
+    Eigen::MatrixXcd gate = (std::complex<double>(0, 0.1) * random_hermitian(d)).exp();
+    auto update = [&gate](const Eigen::Ref<const Eigen::MatrixXcd>& block) {
+        return Eigen::MatrixXcd(gate * block);
+    };
+    for (auto _ : state) {
+        if (generic) {
+            mps.apply_one_site(update, 1);
+        } else {
+            mps.apply_one_site_gate(gate, 1);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(chi) * chi * d * d);
+}
+BENCHMARK(BM_SiteGate)->ArgsProduct({{4, 16, 64}, {2, 3}, {0, 1}});
+
+// exponential of a d x d term: closed form / fixed size against Eigen's
+// dynamic expm (generic = 1)
+void BM_MatrixExponential(benchmark::State& state) {
+    const int d = static_cast<int>(state.range(0));
+    const bool generic = state.range(1) != 0;
+    const Eigen::MatrixXcd a = std::complex<double>(0, -0.05) * random_hermitian(d);
+    for (auto _ : state) {
+        if (generic) {
+            benchmark::DoNotOptimize(Eigen::MatrixXcd(a.exp()));
+        } else {
+            benchmark::DoNotOptimize(matrix_exponential(a));
+        }
+    }
+}
+BENCHMARK(BM_MatrixExponential)->ArgsProduct({{2, 3, 4, 9}, {0, 1}});
+
+} // namespace
@@ -0,0 +1,136 @@
+#include <benchmark/benchmark.h>
+#include "common.hh"
+#include "solver/block_tensor.hh"
+#include "solver/execution.hh"
+
+using namespace qps;
+using namespace qps::bench;
+
+namespace {
+
+// matrix product (n x n) * (n x n): a plain gemm with no permutation
+void BM_ContractMatrix(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    TensorNetwork network;
+    TensorHandle a = network.add_tensor(random_tensor({n, n}, {"i", "j"}), "A");
+    TensorHandle b = network.add_tensor(random_tensor({n, n}, {"j", "k"}), "B");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(network.contract(a, b, {"j"}));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n) * n * n);
+}
+BENCHMARK(BM_ContractMatrix)->RangeMultiplier(2)->Range(16, 512);
+
+// the same product with Precision::mixed: operands rounded to complex<float>
+// for a cgemm, the result widened back
+void BM_ContractMatrixMixed(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    ExecutionConfig config;
+    config.precision = Precision::mixed;
+    TensorNetwork network;
+    network.set_execution_context(std::make_shared<ExecutionContext>(config));
+    TensorHandle a = network.add_tensor(random_tensor({n, n}, {"i", "j"}), "A");
+    TensorHandle b = network.add_tensor(random_tensor({n, n}, {"j", "k"}), "B");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(network.contract(a, b, {"j"}));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n) * n * n);
+}
+BENCHMARK(BM_ContractMatrixMixed)->RangeMultiplier(2)->Range(16, 512);
+
+// mps site (chi, d, chi) with a one-site gate on its physical index, which
+// needs a permutation before the gemm
+void BM_ContractSiteGate(benchmark::State& state) {
+    const int chi = static_cast<int>(state.range(0));
+    const int d = static_cast<int>(state.range(1));
+    TensorNetwork network;
+    TensorHandle site = network.add_tensor(random_tensor({chi, d, chi}, {"l", "s", "r"}), "A");
+    TensorHandle gate = network.add_tensor(random_tensor({d, d}, {"t", "s"}), "G");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(network.contract(site, gate, {"s"}));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(chi) * chi * d * d);
+}
+BENCHMARK(BM_ContractSiteGate)->ArgsProduct({{16, 64, 256}, {2, 4}});
+
+// <psi|O|psi> over two mps sites, planned and contracted by contract_all
+void BM_ContractAllTwoSites(benchmark::State& state) {
+    const int chi = static_cast<int>(state.range(0));
+    const int d = 2;
+    TensorNetwork network;
+    std::vector<TensorHandle> handles = {
+        network.add_tensor(random_tensor({chi, d, chi}, {"l", "s0", "m"}), "A0"),
+        network.add_tensor(random_tensor({chi, d, chi}, {"m", "s1", "r"}), "A1"),
+        network.add_tensor(random_tensor({d, d, d, d}, {"s0", "s1", "t0", "t1"}), "O"),
+        network.add_tensor(random_tensor({chi, d, chi}, {"l", "t0", "n"}), "B0"),
+        network.add_tensor(random_tensor({chi, d, chi}, {"n", "t1", "r"}), "B1"),
+    };
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(network.contract_all(handles, {}));
+    }
+}
+BENCHMARK(BM_ContractAllTwoSites)->RangeMultiplier(2)->Range(8, 128);
+
+void BM_FromMatrix(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    const Eigen::MatrixXcd m = Eigen::MatrixXcd::Random(n, n);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Tensor::from_matrix(m));
+    }
+    state.SetBytesProcessed(state.iterations() * m.size() * sizeof(Tensor::Scalar));
+}
+BENCHMARK(BM_FromMatrix)->RangeMultiplier(4)->Range(16, 1024);
+
+void BM_ToMatrix(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    const Tensor t = random_tensor({n, n}, {"i", "j"});
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(t.to_matrix());
+    }
+    state.SetBytesProcessed(state.iterations() * t.data.size() * sizeof(Tensor::Scalar));
+}
+BENCHMARK(BM_ToMatrix)->RangeMultiplier(4)->Range(16, 1024);
+
+void BM_Permute(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    const Tensor t = random_tensor({n, n, n}, {"a", "b", "c"});
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(permute(t, {2, 0, 1}));
+    }
+    state.SetBytesProcessed(state.iterations() * t.data.size() * sizeof(Tensor::Scalar));
+}
+BENCHMARK(BM_Permute)->RangeMultiplier(2)->Range(8, 128);
+
+// u(1) mps site times its neighbour over a bond of chi states split evenly
+// into `sectors` charges, block-sparse against the same tensors dense
+std::pair<BlockTensor, BlockTensor> u1_sites(int chi, int sectors) {
+    auto bond = [&](const std::string& label, int flow) {
+        QnIndex idx{label, {}, flow};
+        for (int q = 0; q < sectors; ++q) idx.sectors.push_back({q, chi / sectors});
+        return idx;
+    };
+    QnIndex phys{"s", {{0, 1}, {1, 1}}, 1};
+    QnIndex phys2{"t", {{0, 1}, {1, 1}}, 1};
+    return {BlockTensor::random(Symmetry::u1, {bond("l", 1), phys, bond("m", -1)}),
+            BlockTensor::random(Symmetry::u1, {bond("m", 1), phys2, bond("r", -1)})};
+}
+
+void BM_ContractBlockSites(benchmark::State& state) {
+    const auto sites = u1_sites(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(contract_tensors(sites.first, sites.second, {{2, 0}}));
+    }
+}
+BENCHMARK(BM_ContractBlockSites)->ArgsProduct({{64, 256}, {4, 16}});
+
+void BM_ContractDenseSites(benchmark::State& state) {
+    const auto sites = u1_sites(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    const Tensor a = sites.first.to_dense();
+    const Tensor b = sites.second.to_dense();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(contract_tensors(a, b, {{2, 0}}));
+    }
+}
+BENCHMARK(BM_ContractDenseSites)->ArgsProduct({{64, 256}, {4, 16}});
+
+} // namespace
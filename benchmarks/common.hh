@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+#include "solver/tensor.hh"
+
+namespace qps::bench {
+
+inline Tensor random_tensor(const std::vector<int>& dims, const std::vector<std::string>& idx) {
+    Tensor t(dims, idx);
+    t.vector_view() = Eigen::VectorXcd::Random(t.data.size());
+    return t;
+}
+
+// random hermitian matrix, the shape of every hamiltonian term
+inline Eigen::MatrixXcd random_hermitian(int d) {
+    Eigen::MatrixXcd a = Eigen::MatrixXcd::Random(d, d);
+    return (a + a.adjoint()) / 2.0;
+}
+
+} // namespace qps::bench
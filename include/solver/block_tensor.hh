@@ -0,0 +1,130 @@
+#pragma once
+
+#include "solver/mps.hh"
+#include "solver/tensor.hh"
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace qps {
+
+// abelian symmetry conserved by a block tensor: charges add (u1, e.g.
+// particle number) or add modulo 2 (z2, e.g. parity)
+enum class Symmetry { u1, z2 };
+
+// a charge in its canonical range (z2 charges are 0 or 1)
+inline int normalize_charge(Symmetry symmetry, int q) {
+    return symmetry == Symmetry::z2 ? (q & 1) : q;
+}
+
+inline int fuse_charges(Symmetry symmetry, int a, int b) {
+    return normalize_charge(symmetry, a + b);
+}
+
+// an index whose basis splits into charge sectors. the dense view lays the
+// sectors out one after another in the listed order. flow is +1 for an
+// incoming index and -1 for an outgoing one; contracted indices must carry
+// the same sectors with opposite flows
+struct QnIndex {
+    struct Sector {
+        int charge;
+        int dim;
+        bool operator==(const Sector& other) const { return charge == other.charge && dim == other.dim; }
+    };
+
+    IndexId label;
+    std::vector<Sector> sectors;  // distinct charges
+    int flow = 1;
+
+    int dimension() const {
+        int d = 0;
+        for (const Sector& s : sectors) d += s.dim;
+        return d;
+    }
+    // position of a sector in the dense view
+    int offset(int sector) const {
+        int off = 0;
+        for (int k = 0; k < sector; ++k) off += sectors[k].dim;
+        return off;
+    }
+    // the same index seen from the other side of a bond
+    QnIndex dual() const { return QnIndex{label, sectors, -flow}; }
+};
+
+// tensor that conserves an abelian charge. a block is one choice of sector
+// per index, and it can only be nonzero if the charges of its sectors, signed
+// by their flows, fuse to the tensor's charge. only those blocks are stored,
+// each a dense Tensor with the sector dimensions and the index labels, so
+// contractions and svds run block by block and skip everything the symmetry
+// forces to zero
+class BlockTensor {
+public:
+    using Key = std::vector<int>;  // sector position on each index
+
+    BlockTensor() = default;
+    // no blocks yet, i.e. zero
+    BlockTensor(Symmetry symmetry, std::vector<QnIndex> indices, int charge = 0);
+
+    // every allowed block, zero-filled or with uniform random entries
+    static BlockTensor zeros(Symmetry symmetry, std::vector<QnIndex> indices, int charge = 0);
+    static BlockTensor random(Symmetry symmetry, std::vector<QnIndex> indices, int charge = 0);
+    // the blocks of a dense tensor laid out by sectors; throws if an element
+    // the symmetry forbids exceeds `tolerance` in magnitude
+    static BlockTensor from_dense(const Tensor& dense, Symmetry symmetry, std::vector<QnIndex> indices,
+                                  int charge = 0, double tolerance = 1e-12);
+
+    Tensor to_dense() const;
+
+    Symmetry symmetry() const { return symmetry_; }
+    int charge() const { return charge_; }
+    int rank() const { return static_cast<int>(indices_.size()); }
+    const std::vector<QnIndex>& indices() const { return indices_; }
+    const std::map<Key, Tensor>& blocks() const { return blocks_; }
+
+    // true if the symmetry lets block `key` be nonzero
+    bool allowed(const Key& key) const;
+    // the block at `key`, created zero-filled if missing
+    Tensor& block(const Key& key);
+    // nullptr if the block is not stored
+    const Tensor* find_block(const Key& key) const;
+    // add `t` to the block at `key`, taking it over if the block is new
+    void accumulate(const Key& key, Tensor&& t);
+
+    // stored elements, against the dense size of the product of dimensions
+    Eigen::Index nonzeros() const;
+    double norm() const;
+    // complex conjugate; flows and charge flip, so a.conj() contracts with a
+    BlockTensor conj() const;
+
+private:
+    Tensor make_block(const Key& key) const;
+
+    Symmetry symmetry_ = Symmetry::u1;
+    std::vector<QnIndex> indices_;
+    int charge_ = 0;
+    std::map<Key, Tensor> blocks_;
+};
+
+// reorder the indices: result index k is source index order[k]
+BlockTensor permute(const BlockTensor& tensor, const std::vector<int>& order);
+
+// contract over (t1 position, t2 position) pairs, like the dense version. only
+// pairs of blocks whose contracted sectors match are multiplied
+BlockTensor contract_tensors(const BlockTensor& t1, const BlockTensor& t2,
+                             const std::vector<std::pair<int, int>>& index_pairs);
+
+// truncated svd t = u * diag(s) * vh between the first `row_rank` indices
+// and the rest. each charge of the new bond is an independent svd of the
+// blocks with that row charge; the truncation ranks all singular values
+// together. u carries the bond as outgoing, vh as incoming
+struct BlockSvd {
+    BlockTensor u;   // row indices, then the bond
+    std::map<int, Eigen::VectorXd> singular_values;  // by bond charge, descending
+    BlockTensor vh;  // the bond, then the column indices
+    double discarded = 0.0;  // relative discarded weight
+};
+
+BlockSvd svd(const BlockTensor& tensor, int row_rank, IndexId bond,
+             const TruncationParams& truncation = TruncationParams());
+
+} // namespace qps
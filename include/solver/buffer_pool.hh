@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+namespace qps {
+
+struct BufferPoolStats {
+    uint64_t hits = 0;         // buffers handed out from a cache
+    uint64_t misses = 0;       // buffers that had to be allocated
+    uint64_t releases = 0;     // buffers returned to a cache
+    uint64_t dropped = 0;      // buffers freed because a cache was full
+    uint64_t cached_bytes = 0; // held by the caches of all threads right now
+};
+
+// recycles tensor buffers. the contractions of a trotter step produce the
+// same shapes step after step, so a freed buffer is kept in a per-thread
+// free list keyed by its exact element count and handed to the next tensor
+// of that size; once every shape of a step has been seen, steady-state
+// steps allocate no tensor storage at all. a buffer freed on another
+// thread than the one that allocated it goes to the freeing thread's cache.
+// a thread's cache is freed when the thread exits. counters are
+// process-wide, and only misses count as profiler allocations
+class BufferPool {
+public:
+    static BufferPoolStats stats();
+    static void reset_stats();
+
+    // bytes the caches of all threads may hold together (default 256 MiB);
+    // 0 turns caching off
+    static void set_capacity(size_t bytes);
+    static size_t capacity();
+    // frees everything cached by the calling thread
+    static void clear();
+};
+
+template <typename T>
+using PoolBuffer = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+
+// a (size x 1) buffer with unspecified contents
+template <typename T>
+PoolBuffer<T> acquire_buffer(Eigen::Index size);
+// hand a buffer back; it is left empty
+template <typename T>
+void release_buffer(PoolBuffer<T>&& buffer);
+
+extern template PoolBuffer<float> acquire_buffer<float>(Eigen::Index);
+extern template PoolBuffer<double> acquire_buffer<double>(Eigen::Index);
+extern template PoolBuffer<std::complex<float>> acquire_buffer<std::complex<float>>(Eigen::Index);
+extern template PoolBuffer<std::complex<double>> acquire_buffer<std::complex<double>>(Eigen::Index);
+extern template void release_buffer<float>(PoolBuffer<float>&&);
+extern template void release_buffer<double>(PoolBuffer<double>&&);
+extern template void release_buffer<std::complex<float>>(PoolBuffer<std::complex<float>>&&);
+extern template void release_buffer<std::complex<double>>(PoolBuffer<std::complex<double>>&&);
+
+} // namespace qps
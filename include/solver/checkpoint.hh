@@ -0,0 +1,119 @@
+#pragma once
+
+#include "solver/tensor.hh"
+#include <complex>
+#include <cstdint>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace qps {
+
+// binary checkpoint container, one file per run holding many records.
+//
+// layout (little endian):
+//   file header  "QPSCKPT\0" | u32 version | u32 reserved           16 bytes
+//   per record   fixed header                                         64 bytes
+//                  u32 magic "QREC" | u32 header_bytes
+//                  u64 payload_bytes | u64 raw_bytes
+//                  i64 step | f64 time
+//                  u32 dtype | u32 compression | u32 rank
+//                  u32 name_len | u32 indices_len | u32 params_len
+//                i64 dims[rank], name, index names ('\n' separated),
+//                solver params (json), zero padding
+//                payload, starting on a 64-byte boundary of the file
+//
+// the payload is the tensor buffer in its native column-major order, so an
+// uncompressed record can be memory-mapped as-is (numpy: order='F').
+//
+// a record named "commit" marks the records before it as one consistent
+// snapshot; resuming and appending only trust data up to the last commit
+enum class CheckpointDtype : uint32_t { complex128 = 0 };
+enum class Compression : uint32_t { none = 0, zlib = 1 };
+
+struct CheckpointRecord {
+    std::string name;
+    std::vector<std::string> index_names;
+    std::vector<int64_t> dims;
+    std::string params;
+    int64_t step = 0;
+    double time = 0.0;
+    CheckpointDtype dtype = CheckpointDtype::complex128;
+    Compression compression = Compression::none;
+    uint64_t payload_offset = 0;
+    uint64_t payload_bytes = 0;
+    uint64_t raw_bytes = 0;
+};
+
+class CheckpointWriter {
+public:
+    // truncates `path` unless `append` is set and the file already exists
+    explicit CheckpointWriter(const std::string& path, Compression compression = Compression::none,
+                              bool append = false);
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // solver parameters (a json object) attached to every following record
+    void set_params(const std::string& json) { params_ = json; }
+    void write(const std::string& name, const Tensor& tensor, int64_t step, double time);
+    void flush();
+    // seal the records written so far as the snapshot of `step` and sync
+    // them to disk
+    void commit(int64_t step, double time);
+
+private:
+    std::FILE* file_ = nullptr;
+    Compression compression_;
+    std::string params_ = "{}";
+    uint64_t offset_ = 0;
+};
+
+// maps a checkpoint file read-only and indexes its records
+class CheckpointReader {
+public:
+    explicit CheckpointReader(const std::string& path);
+    ~CheckpointReader();
+    CheckpointReader(const CheckpointReader&) = delete;
+    CheckpointReader& operator=(const CheckpointReader&) = delete;
+
+    const std::vector<CheckpointRecord>& records() const { return records_; }
+    // index of the last record with this name (and step, if given), or -1
+    int find(const std::string& name, int64_t step = -1) const;
+    // index of the last commit record, or -1
+    int last_commit() const { return find(kCommitRecord); }
+
+    static constexpr const char* kCommitRecord = "commit";
+
+    // zero-copy view of an uncompressed payload inside the mapping
+    const std::complex<double>* data(const CheckpointRecord& record) const;
+    // the record as a tensor (decompressed if needed)
+    Tensor read(const CheckpointRecord& record) const;
+
+private:
+    const unsigned char* map_ = nullptr;
+    size_t size_ = 0;
+    std::vector<CheckpointRecord> records_;
+};
+
+// when a solver writes a snapshot: every `every_steps` steps and/or every
+// `every_seconds` of wall time, whichever comes first, and after the last
+// step. zero disables a criterion
+struct CheckpointPolicy {
+    int every_steps = 1;
+    double every_seconds = 0.0;
+};
+
+class CheckpointSchedule {
+public:
+    explicit CheckpointSchedule(const CheckpointPolicy& policy);
+    // true if a snapshot is due after `step` (0-based); restarts the clock
+    bool due(int step, bool last);
+
+private:
+    CheckpointPolicy policy_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+} // namespace qps
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "solver/solver.hh"
+#include "solver/thread_pool.hh"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace qps {
+
+// one member of an ensemble: solver parameters and the state to start from
+struct EnsembleJob {
+    std::vector<double> params;  // given to the factory and to build_network
+    Tensor initial_state;
+};
+
+struct EnsembleResult {
+    size_t job = 0;
+    double value = 0.0;    // compute_quantity_of_interest() at the end
+    double seconds = 0.0;  // wall time of the job
+    int worker = -1;       // pool worker that ran it
+    std::string error;     // empty unless the job threw
+
+    bool ok() const { return error.empty(); }
+};
+
+// aggregate over the last batch; value statistics cover successful jobs
+struct EnsembleSummary {
+    size_t jobs = 0;
+    size_t failed = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double wall_seconds = 0.0;  // whole batch
+    double job_seconds = 0.0;   // sum of per-job times
+    size_t steals = 0;          // jobs a worker took from another's queue
+
+    double throughput() const { return wall_seconds > 0.0 ? jobs / wall_seconds : 0.0; }
+};
+
+// builds a configured solver for one parameter set
+using SolverFactory = std::function<std::unique_ptr<Solver>(const std::vector<double>& params)>;
+
+// runs a batch of independent solvers on a work-stealing pool. every solver
+// is given the same propagator cache, so jobs with equal terms and step sizes
+// share their exponentials. solvers are otherwise private to their job
+class EnsembleRunner {
+public:
+    // 0 threads means one per hardware thread
+    explicit EnsembleRunner(SolverFactory factory, size_t num_threads = 0);
+
+    void set_propagator_cache(PropagatorCache& cache) { propagators_ = &cache; }
+    size_t num_threads() const { return pool_.size(); }
+
+    // results are returned in job order; a job that throws is reported in
+    // its result and does not stop the others
+    std::vector<EnsembleResult> run(const std::vector<EnsembleJob>& jobs);
+    const EnsembleSummary& summary() const { return summary_; }
+
+private:
+    SolverFactory factory_;
+    ThreadPool pool_;
+    PropagatorCache* propagators_ = &PropagatorCache::shared();
+    EnsembleSummary summary_;
+};
+
+} // namespace qps
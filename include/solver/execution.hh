@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace qps {
+
+class ThreadPool;
+
+// arithmetic of the contractions. in mixed mode a TEBD run keeps its
+// matrix product state in complex<float>, and the dense gemms of
+// complex<double> tensors (networks, DMRG environments) round their
+// operands to complex<float> while permuting them and widen the product
+// back. either halves the memory traffic and doubles the BLAS throughput at
+// about 1e-7 relative error per contraction. gates, norms, SVDs,
+// eigensolvers and energies stay in double
+enum class Precision {
+    full,
+    mixed,
+};
+
+struct ExecutionConfig {
+    size_t num_threads = 1;              // 0: one per hardware thread
+    size_t permute_threshold = 1 << 16;  // elements below which a permutation stays serial
+    Precision precision = Precision::full;
+};
+
+// how wide the tensor kernels run. a contraction is a permutation plus one
+// gemm: the context spreads large permutations over its own workers, and
+// an ExecutionScope gives BLAS the same number of threads for a whole run
+// (OpenBLAS keeps small gemms on one thread by itself), so the two never
+// run more threads than the context was given. contractions never change
+// the BLAS setting themselves
+class ExecutionContext {
+public:
+    explicit ExecutionContext(const ExecutionConfig& config = ExecutionConfig());
+    ~ExecutionContext();
+    ExecutionContext(const ExecutionContext&) = delete;
+    ExecutionContext& operator=(const ExecutionContext&) = delete;
+
+    // the single-threaded context used when none is given
+    static const ExecutionContext& serial();
+
+    const ExecutionConfig& config() const { return config_; }
+    size_t num_threads() const { return config_.num_threads; }
+    Precision precision() const { return config_.precision; }
+    // workers for permutations; null for a serial context
+    ThreadPool* pool() const { return pool_.get(); }
+
+    bool parallel_permute(size_t elements) const {
+        return pool_ && elements >= config_.permute_threshold;
+    }
+
+private:
+    ExecutionConfig config_;
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+// BLAS threading is a process-wide setting; this sets it for a scope. code
+// that runs solvers on its own workers pins BLAS to one thread this way so
+// the pools do not oversubscribe. scopes may overlap, also across threads:
+// the setting from before the first one is restored when the last one
+// ends, and in between the most recent request holds
+class BlasThreads {
+public:
+    explicit BlasThreads(int num_threads);
+    ~BlasThreads();
+    BlasThreads(const BlasThreads&) = delete;
+    BlasThreads& operator=(const BlasThreads&) = delete;
+
+    static int get();
+    static void set(int num_threads);
+};
+
+// a context's BLAS threading for the length of a solver run, applied once
+// when the run starts. BLAS gets the context's threads, or one when the run
+// is itself a job on a pool worker; a serial context leaves it alone
+class ExecutionScope {
+public:
+    explicit ExecutionScope(const ExecutionContext& ctx);
+    ~ExecutionScope();
+    ExecutionScope(const ExecutionScope&) = delete;
+    ExecutionScope& operator=(const ExecutionScope&) = delete;
+
+private:
+    std::unique_ptr<BlasThreads> blas_;
+};
+
+} // namespace qps
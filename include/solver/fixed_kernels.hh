@@ -0,0 +1,28 @@
+#pragma once
+
+#include "solver/tensor.hh"
+#include <Eigen/Dense>
+
+namespace qps {
+
+// kernels specialized at compile time for the local dimensions most models
+// use, qubits (d = 2) and qutrits (d = 3). gates are held in fixed-size
+// Eigen matrices and applied as unrolled loops over the physical index, in
+// place and without any heap allocation, where the generic path permutes
+// the tensor into a gemm block and back. callers fall back to the generic
+// path when a function returns false
+
+// physical dimensions of a site or a bond with a fixed-size gate kernel:
+// 2 and 3 on one site, 4, 6 and 9 on a bond
+bool has_fixed_gate_kernel(int dim);
+
+// exp(a): closed form for 2 x 2, fixed-size pade for the other kernel
+// dimensions, and Eigen's dynamic expm for everything else
+Eigen::MatrixXcd matrix_exponential(const Eigen::MatrixXcd& a);
+
+// apply a gate in place: a d x d gate on a site tensor (b_l, d, b_r), or a
+// (d1 d2) x (d1 d2) gate with rows in kronecker order s1 * d2 + s2 on a
+// two-site block (b_l, d1, d2, b_r)
+bool apply_fixed_gate(const Eigen::MatrixXcd& gate, Tensor& t);
+
+} // namespace qps
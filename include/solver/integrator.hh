@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+namespace qps {
+
+// how one TEBD step of size h is split into sweeps over the hamiltonian terms.
+// every scheme is a composition of the first-order sweep F(t) (terms in
+// order) and its adjoint B(t) (terms in reverse order); such a composition
+// has the order of the splitting it is built from, for any number of terms
+enum class Integrator {
+    second_order,  // strang: F(h/2) B(h/2)
+    forest_ruth,   // forest-ruth / yoshida triple jump of strang steps, 4th order
+    suzuki,        // suzuki's five-stage fractal of strang steps, 4th order
+    omelyan,       // omelyan-mryglod-folk optimized forest-ruth-like, 4th order
+};
+
+const char* integrator_name(Integrator integrator);
+int integrator_order(Integrator integrator);
+
+// weights of the sweeps of one step: sweep k advances every term by
+// weights[k] * h, forward for even k and backward for odd k. they sum to 1
+std::vector<double> sweep_weights(Integrator integrator);
+
+// step-doubling control: a step of size h is compared with two of h/2 and
+// accepted if the two states differ by at most `tolerance` (2-norm). the
+// next h is scaled by safety * (tolerance / error)^(1 / (order + 1)),
+// bounded to [min_factor, max_factor]. the difference comes from overlaps,
+// which puts a floor of about 1e-8 under useful tolerances
+struct AdaptiveParams {
+    bool enabled = false;
+    double tolerance = 1e-6;
+    double safety = 0.9;
+    double min_factor = 0.2;
+    double max_factor = 5.0;
+    double min_step = 1e-10;  // a step this small is accepted regardless
+    double max_step = 0.0;    // 0: no upper bound
+};
+
+// next trial step after an error estimate of `error` on a step of size h
+double adapt_step(const AdaptiveParams& params, int order, double h, double error);
+
+} // namespace qps
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <complex>
+#include <functional>
+
+namespace qps {
+
+// how a solver applies exp(scale * H): by forming the dense exponential
+// once (cached), or by a krylov expmv straight on the state
+enum class PropagationMode { dense, krylov };
+
+struct KrylovParams {
+    int max_dim = 40;          // largest krylov space before the step is split
+    double tolerance = 1e-12;  // error bound relative to the norm of the input
+};
+
+// counters accumulated over expmv calls, for logging and tuning
+struct KrylovStats {
+    int calls = 0;
+    int max_dim_used = 0;
+    int substeps = 0;
+    double max_error_estimate = 0.0;
+
+    void merge(const KrylovStats& other) {
+        calls += other.calls;
+        max_dim_used = std::max(max_dim_used, other.max_dim_used);
+        substeps += other.substeps;
+        max_error_estimate = std::max(max_error_estimate, other.max_error_estimate);
+    }
+};
+
+// y = H x. x and y are blocks of vectors; H acts on their rows
+using LinearMap = std::function<void(const Eigen::MatrixXcd& x, Eigen::MatrixXcd& y)>;
+
+// exp(scale * H) v for hermitian H by lanczos, without forming the dense
+// exponential. a block v is treated as one vector in the frobenius inner
+// product, so a single krylov space serves all of its columns. the krylov
+// dimension grows until the a-posteriori error estimate meets the tolerance;
+// if max_dim is reached first, the step is split into substeps.
+// scale is -i dt for real time and -dbeta for imaginary time
+Eigen::MatrixXcd expmv(const LinearMap& H, std::complex<double> scale,
+                       const Eigen::Ref<const Eigen::MatrixXcd>& v,
+                       const KrylovParams& params = KrylovParams(), KrylovStats* stats = nullptr);
+
+Eigen::MatrixXcd expmv(const Eigen::MatrixXcd& H, std::complex<double> scale,
+                       const Eigen::Ref<const Eigen::MatrixXcd>& v,
+                       const KrylovParams& params = KrylovParams(), KrylovStats* stats = nullptr);
+
+// lowest eigenvalue of a hermitian H by restarted lanczos. v holds the start
+// vector (any nonzero block) and returns the normalized eigenvector. each
+// restart begins from the best ritz vector so far; the iteration stops once
+// the residual norm |H v - e v| is at most the tolerance, or after
+// max_restarts restarts. each lanczos round counts as a substep, and the
+// final residual goes into max_error_estimate
+double lowest_eigenpair(const LinearMap& H, Eigen::MatrixXcd& v,
+                        const KrylovParams& params = KrylovParams(), KrylovStats* stats = nullptr,
+                        int max_restarts = 20);
+
+} // namespace qps
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// highest verbosity compiled into the solvers: 0 off, 1 summary, 2 step,
+// 3 gate. release builds drop the per-gate level, whose measurements cost
+// as much as the gates themselves
+#ifndef QPS_MAX_VERBOSITY
+#ifdef NDEBUG
+#define QPS_MAX_VERBOSITY 2
+#else
+#define QPS_MAX_VERBOSITY 3
+#endif
+#endif
+
+namespace qps {
+
+enum class Verbosity { off = 0, summary = 1, step = 2, gate = 3 };
+
+template <Verbosity V>
+constexpr bool verbosity_compiled_in = static_cast<int>(V) <= QPS_MAX_VERBOSITY;
+
+// what the solver does when the writer thread falls behind
+enum class Backpressure {
+    block,  // wait for space in the queue; nothing is lost
+    drop,   // discard the record and count it; the solver never waits
+};
+
+struct MetricsConfig {
+    Verbosity verbosity = Verbosity::step;  // gate is opt-in and capped by QPS_MAX_VERBOSITY
+    int sample_every = 1;                   // log every n-th step (and the last)
+    Backpressure backpressure = Backpressure::block;
+    size_t queue_capacity = 4096;           // rounded up to a power of two
+};
+
+// plain record passed from the solver to the writer thread; no allocation
+struct MetricRecord {
+    enum class Kind { init, gate, step };
+    Kind kind = Kind::gate;
+    int step = 0;
+    int site = 0;
+    int span = 1;          // sites touched by the gate
+    bool forward = true;
+    bool measured = false; // energy and norm are filled in
+    int bond_dim = 0;      // operator dimension for init records
+    double time = 0.0;
+    double energy = 0.0;
+    double norm = 0.0;
+    double discarded = 0.0;
+    double truncation_error = 0.0;
+};
+
+// bounded single-producer single-consumer ring buffer
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        buffer_.resize(n);
+        mask_ = n - 1;
+    }
+
+    bool try_push(const T& value) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) > mask_) return false;
+        buffer_[head & mask_] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return false;
+        value = buffer_[tail & mask_];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> buffer_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+// writes solver_data.json and debug.log for a TEBD run on a background
+// thread. the solver only pushes records; formatting and file output happen
+// on the writer, so the hot loop never touches a stream
+class MetricsSink {
+public:
+    // params_json is the body of the "parameters" object
+    MetricsSink(const std::string& dir, const std::string& params_json, const MetricsConfig& config);
+    ~MetricsSink();
+    MetricsSink(const MetricsSink&) = delete;
+    MetricsSink& operator=(const MetricsSink&) = delete;
+
+    bool wants(Verbosity v) const {
+        return v != Verbosity::off && static_cast<int>(v) <= static_cast<int>(config_.verbosity);
+    }
+    bool sampled(int step, bool last) const {
+        return step % config_.sample_every == 0 || last;
+    }
+
+    void push(const MetricRecord& record);
+    // drain the queue, finish both files and join the writer
+    void close();
+    size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void write(const MetricRecord& record);
+    void write_gate_json(std::string& out, const MetricRecord& record);
+
+    MetricsConfig config_;
+    SpscQueue<MetricRecord> queue_;
+    std::atomic<bool> done_{false};
+    std::atomic<size_t> dropped_{0};
+    std::thread writer_;
+    std::ofstream json_;
+    std::ofstream log_;
+    // the step being assembled on the writer thread
+    std::string forward_;
+    std::string backward_;
+    bool first_step_ = true;
+    bool closed_ = false;
+};
+
+} // namespace qps
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "solver/tensor.hh"
+#include <complex>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace qps {
+
+class ExecutionContext;
+class ThreadPool;
+
+// settings for svd-based bond compression
+struct TruncationParams {
+    int max_bond_dim = 64;               // hard cap on the kept singular values
+    double max_discarded_weight = 1e-12; // relative weight sum(s_dropped^2) / sum(s^2)
+};
+
+// number of leading values of a descending spectrum to keep, at least one,
+// and the relative weight the rest discard
+int truncation_rank(const Eigen::VectorXd& s, const TruncationParams& truncation, double& discarded);
+
+// matrix product state on an open chain.
+// site i is a rank-3 tensor with indices (b_i, s_i, b_{i+1}): left bond,
+// physical index, right bond. the boundary bonds b_0 and b_N have dimension 1.
+// dense vectors and gate matrices use the kronecker convention, i.e. site 0
+// is the slowest index: gate row = s_i * d_{i+1} + s_{i+1}.
+// the site tensors are stored as T and contracted in T. gates, svds, qrs,
+// norms and expectation values always work in complex<double>, on widened
+// copies of the sites they touch, so a complex<float> state halves the
+// memory and gemm traffic of a run without single-precision factorizations
+template <typename T>
+class BasicMatrixProductState {
+public:
+    using Site = BasicTensor<T>;
+
+    BasicMatrixProductState() = default;
+
+    // product state from one local vector per site
+    static BasicMatrixProductState product_state(const std::vector<Eigen::VectorXcd>& site_states);
+
+    // decompose a dense state vector by successive svds
+    static BasicMatrixProductState from_dense(const Eigen::VectorXcd& psi,
+                                              const std::vector<int>& physical_dims,
+                                              const TruncationParams& truncation = TruncationParams());
+
+    // reassemble a state from its site tensors, e.g. read from a checkpoint.
+    // center is the orthogonality center they are in (-1 if unknown) and
+    // truncation_error the weight already discarded
+    static BasicMatrixProductState from_sites(std::vector<Site> sites, int center = -1,
+                                              double truncation_error = 0.0);
+
+    // the same state with its sites converted to U
+    template <typename U>
+    BasicMatrixProductState<U> cast() const {
+        BasicMatrixProductState<U> out;
+        for (const Site& t : sites_) out.sites_.push_back(t.template cast<U>());
+        out.bond_labels_ = bond_labels_;
+        out.phys_labels_ = phys_labels_;
+        out.bond_spectra_ = bond_spectra_;
+        out.center_ = center_;
+        out.discarded_weight_ = discarded_weight_;
+        out.right_canonical_ = right_canonical_;
+        out.execution_ = execution_;
+        return out;
+    }
+
+    // threading and gemm precision of the state's contractions; serial
+    // until set. copies share the context
+    void set_execution_context(std::shared_ptr<const ExecutionContext> ctx) { execution_ = std::move(ctx); }
+    const ExecutionContext& execution_context() const;
+
+    int num_sites() const { return static_cast<int>(sites_.size()); }
+    int physical_dim(int site) const { return sites_[site].dimensions[1]; }
+    // dimension of bond b, i.e. between site b-1 and site b (0 <= b <= N)
+    int bond_dim(int bond) const;
+    int max_bond_dim() const;
+    const Site& site(int i) const { return sites_[i]; }
+
+    // orthogonality center: sites left of it are left-orthonormal, sites
+    // right of it right-orthonormal. -1 if the state is not in canonical form
+    int center() const { return center_; }
+    void move_center(int site);
+
+    // a local update maps the block whose rows are the physical (kronecker)
+    // index and whose columns are the bonds to its new value, e.g. gate * block
+    using LocalUpdate = std::function<Eigen::MatrixXcd(const Eigen::Ref<const Eigen::MatrixXcd>& block)>;
+
+    // apply a d x d gate on one site. gates of dimension 2 and 3 (and 4, 6
+    // and 9 on a bond) go through the fixed-size kernels of fixed_kernels.hh
+    void apply_one_site_gate(const Eigen::MatrixXcd& gate, int site);
+    void apply_one_site(const LocalUpdate& update, int site);
+
+    // apply a (d_i d_{i+1}) x (d_i d_{i+1}) gate on sites (site, site+1) and
+    // split the result with a truncated svd. the orthogonality center ends on
+    // site+1 when sweeping right and on site otherwise. returns the relative
+    // discarded weight of this truncation
+    double apply_two_site_gate(const Eigen::MatrixXcd& gate, int site,
+                               const TruncationParams& truncation, bool sweep_right = true);
+    double apply_two_site(const LocalUpdate& update, int site,
+                          const TruncationParams& truncation, bool sweep_right = true);
+
+    // one gate of a trotter layer: an update of the bond (site, site+1)
+    struct LayerGate {
+        int site;
+        LocalUpdate update;
+        // a dense gate to apply instead of update, through a fixed-size
+        // kernel where there is one
+        const Eigen::MatrixXcd* gate = nullptr;
+    };
+
+    // apply two-site updates on disjoint bonds as one layer, concurrently on
+    // `pool` when given. uses hastings' form of tebd: the state is kept
+    // right-orthonormal with exact bond spectra (center 0), so each update
+    // touches only its own two sites and bond. the result does not depend on
+    // the schedule. returns the summed discarded weight
+    double apply_layer(const std::vector<LayerGate>& gates, const TruncationParams& truncation,
+                       ThreadPool* pool = nullptr);
+
+    // <psi|O|psi> / <psi|psi>. these move the orthogonality center, except
+    // in the right-canonical form apply_layer keeps, which they preserve
+    std::complex<double> expectation_one_site(const Eigen::MatrixXcd& op, int site);
+    std::complex<double> expectation_two_site(const Eigen::MatrixXcd& op, int site);
+
+    // <this|other>, accumulated in double
+    std::complex<double> overlap(const BasicMatrixProductState& other) const;
+    double norm() const;
+    void normalize();
+
+    Eigen::VectorXcd to_dense() const;
+
+    // schmidt spectrum of bond b from the last svd on it (empty if none yet)
+    const Eigen::VectorXd& singular_values(int bond) const { return bond_spectra_[bond]; }
+    // accumulated discarded weight of all truncations so far
+    double truncation_error() const { return discarded_weight_; }
+
+    std::size_t memory_bytes() const;
+
+private:
+    template <typename>
+    friend class BasicMatrixProductState;
+
+    // index labels are interned once per chain, not once per gate
+    void init_labels(int n);
+    Site site_tensor(int site, int dl, int d, int dr) const;
+    void move_center_right(int site);
+    void move_center_left(int site);
+    void canonicalize();
+    // right-orthonormalize every site but 0 by svds, recording exact spectra
+    void right_canonicalize();
+    // site tensor (b_l, d, b_r) or two-site block (b_l, d1, d2, b_r) after
+    // `gate` when given, and after `update` otherwise
+    static void update_block(Tensor& t, const LocalUpdate& update, const Eigen::MatrixXcd* gate);
+    // update_block on a site, through a widened copy in single precision
+    void update_site(int site, const LocalUpdate& update, const Eigen::MatrixXcd* gate);
+    double update_two_site(const LocalUpdate& update, const Eigen::MatrixXcd* gate, int site,
+                           const TruncationParams& truncation, bool sweep_right);
+    double update_bond(const LocalUpdate& update, const Eigen::MatrixXcd* gate, int site,
+                       const TruncationParams& truncation);
+    // contracted in T and widened
+    Tensor two_site_theta(int site) const;
+    // multiply the left bond of a site tensor or block by bond_spectra_[site]
+    void scale_by_spectrum(Tensor& t, int site) const;
+
+    std::vector<Site> sites_;
+    std::vector<IndexId> bond_labels_;
+    std::vector<IndexId> phys_labels_;
+    std::vector<Eigen::VectorXd> bond_spectra_;
+    int center_ = -1;
+    double discarded_weight_ = 0.0;
+    // set by right_canonicalize, cleared by anything that moves the center
+    bool right_canonical_ = false;
+    std::shared_ptr<const ExecutionContext> execution_;
+};
+
+extern template class BasicMatrixProductState<std::complex<float>>;
+extern template class BasicMatrixProductState<std::complex<double>>;
+
+using MatrixProductState = BasicMatrixProductState<std::complex<double>>;
+
+// a state in complex<double>: the state itself, or a widened copy of a
+// single-precision one
+inline const MatrixProductState& widen(const MatrixProductState& s) { return s; }
+inline MatrixProductState widen(const BasicMatrixProductState<std::complex<float>>& s) {
+    return s.cast<std::complex<double>>();
+}
+
+} // namespace qps
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "solver/mps.hh"
+#include <complex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace qps {
+
+// many expectation values of one matrix product state in a single pass.
+// every observable is a product of one-site operators on distinct sites: a
+// local term has one factor, a two-point correlator two. the observables
+// are kept as a prefix tree over their (site, operator) factors, so the
+// partial contraction up to a shared prefix (e.g. Z_i for all Z_i Z_j) is
+// computed once and extended site by site. with the left and right norm
+// environments cached for the pass, each local term costs O(1)
+// contractions, and all correlators that start with the same factor cost
+// O(N) together, instead of a full O(N) contraction per observable
+class ObservableBatch {
+public:
+    using Factor = std::pair<int, Eigen::MatrixXcd>;  // (site, operator)
+
+    // returns the position of the observable in measure()'s result. factors
+    // may come in any site order but must be on distinct sites
+    size_t add(const std::string& name, std::vector<Factor> factors);
+    size_t add_local(const std::string& name, const Eigen::MatrixXcd& op, int site) {
+        return add(name, {{site, op}});
+    }
+    size_t add_correlator(const std::string& name, const Eigen::MatrixXcd& a, int i,
+                          const Eigen::MatrixXcd& b, int j) {
+        return add(name, {{i, a}, {j, b}});
+    }
+
+    size_t size() const { return names_.size(); }
+    bool empty() const { return names_.empty(); }
+    const std::string& name(size_t k) const { return names_[k]; }
+    const std::vector<std::string>& names() const { return names_; }
+
+    // <psi|O_k|psi> / <psi|psi> for every observable, in the order added
+    std::vector<std::complex<double>> measure(const MatrixProductState& state) const;
+
+private:
+    // one factor in the prefix tree; node 0 is the empty root
+    struct Node {
+        int site = -1;
+        int op = -1;                  // position in operators_
+        std::vector<int> children;    // ordered by site
+        std::vector<size_t> ends;     // observables whose last factor this is
+    };
+
+    int intern_operator(const Eigen::MatrixXcd& op);
+
+    std::vector<Eigen::MatrixXcd> operators_;  // distinct operators
+    std::vector<Node> nodes_ = std::vector<Node>(1);
+    std::vector<std::string> names_;
+};
+
+// the values of an ObservableBatch after one step of a run
+struct ObservableRecord {
+    int step = 0;
+    double time = 0.0;
+    std::vector<std::complex<double>> values;
+};
+
+} // namespace qps
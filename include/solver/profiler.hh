@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 0 compiles every timer and counter out; otherwise they are compiled in
+// and cost one relaxed load each while the profiler is disabled at runtime
+#ifndef QPS_PROFILE
+#define QPS_PROFILE 1
+#endif
+
+namespace qps {
+
+// where a run spends its time. phases nest (a step contains contractions,
+// a contraction contains a permutation), so their times overlap
+enum class Phase {
+    step,      // one solver time step
+    contract,  // contract_tensors: permutation + gemm
+    permute,   // index reordering copies
+    expm,      // dense matrix exponentials (propagator cache misses)
+    krylov,    // krylov expmv
+    svd,       // mps truncation
+    copy,      // to_matrix / from_matrix style copies
+    io,        // checkpoint writes
+    count,
+};
+
+constexpr size_t kNumPhases = static_cast<size_t>(Phase::count);
+// bucket b counts calls that took [2^b, 2^(b+1)) ns; the last one is open
+constexpr size_t kHistogramBuckets = 40;
+
+const char* phase_name(Phase phase);
+
+struct PhaseStats {
+    uint64_t calls = 0;
+    uint64_t nanoseconds = 0;
+    std::array<uint64_t, kHistogramBuckets> histogram{};
+};
+
+// profiler state at one moment; the difference of two is what happened
+// between them
+struct ProfileSnapshot {
+    std::array<PhaseStats, kNumPhases> phases{};
+    uint64_t contractions = 0;
+    uint64_t flops = 0;            // real floating-point operations in gemms
+    uint64_t bytes_allocated = 0;  // tensor buffers the pool had to allocate
+    uint64_t bytes_written = 0;    // checkpoint records
+
+    ProfileSnapshot operator-(const ProfileSnapshot& earlier) const;
+    // a json object; `indent` spaces in front of every line but the first
+    std::string to_json(int indent = 0) const;
+};
+
+class Profiler;
+
+namespace detail {
+extern std::atomic<bool> profiler_enabled;
+extern thread_local Profiler* current_profiler;
+}
+
+// relaxed atomic counters. the global profiler sees everything recorded in
+// the process; a run also records into its own profiler (see ProfileScope),
+// so concurrent runs such as ensemble jobs report only their own work
+class Profiler {
+public:
+    Profiler() = default;
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    static Profiler& global();
+    // the run profiler attributed on this thread, or null
+    static Profiler* current() { return detail::current_profiler; }
+
+    static bool enabled() {
+        return QPS_PROFILE && detail::profiler_enabled.load(std::memory_order_relaxed);
+    }
+    static void set_enabled(bool enabled) { detail::profiler_enabled.store(enabled, std::memory_order_relaxed); }
+
+    void record(Phase phase, uint64_t nanoseconds);
+    void count_contraction(uint64_t flops) {
+        contractions_.fetch_add(1, std::memory_order_relaxed);
+        flops_.fetch_add(flops, std::memory_order_relaxed);
+    }
+    void count_allocation(uint64_t bytes) { bytes_allocated_.fetch_add(bytes, std::memory_order_relaxed); }
+    void count_written(uint64_t bytes) { bytes_written_.fetch_add(bytes, std::memory_order_relaxed); }
+
+    ProfileSnapshot snapshot() const;
+    void reset();
+
+private:
+    struct PhaseCounters {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> nanoseconds{0};
+        std::array<std::atomic<uint64_t>, kHistogramBuckets> histogram{};
+    };
+
+    std::array<PhaseCounters, kNumPhases> phases_;
+    std::atomic<uint64_t> contractions_{0};
+    std::atomic<uint64_t> flops_{0};
+    std::atomic<uint64_t> bytes_allocated_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+};
+
+// attributes what this thread records, and the thread pool tasks it submits,
+// to `run` until the scope ends. null leaves the attribution unchanged
+class ProfileScope {
+public:
+    explicit ProfileScope(Profiler* run) : previous_(detail::current_profiler) {
+        if (run) detail::current_profiler = run;
+    }
+    ~ProfileScope() { detail::current_profiler = previous_; }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler* previous_;
+};
+
+namespace profile {
+
+// the global profiler and, if one is attributed, the run's
+inline void record(Phase phase, uint64_t nanoseconds) {
+    Profiler::global().record(phase, nanoseconds);
+    if (Profiler* run = Profiler::current()) run->record(phase, nanoseconds);
+}
+inline void count_contraction(uint64_t flops) {
+    if (!Profiler::enabled()) return;
+    Profiler::global().count_contraction(flops);
+    if (Profiler* run = Profiler::current()) run->count_contraction(flops);
+}
+inline void count_allocation(uint64_t bytes) {
+    if (!Profiler::enabled()) return;
+    Profiler::global().count_allocation(bytes);
+    if (Profiler* run = Profiler::current()) run->count_allocation(bytes);
+}
+inline void count_written(uint64_t bytes) {
+    if (!Profiler::enabled()) return;
+    Profiler::global().count_written(bytes);
+    if (Profiler* run = Profiler::current()) run->count_written(bytes);
+}
+
+} // namespace profile
+
+// times its scope into a phase. the clock is only read while profiling
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Phase phase) : phase_(phase), active_(Profiler::enabled()) {
+        if (active_) start_ = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+        if (active_) {
+            const auto elapsed = std::chrono::steady_clock::now() - start_;
+            profile::record(phase_, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Phase phase_;
+    bool active_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace qps
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace qps {
+
+// real time: exp(-i dt H), imaginary time: exp(-dt H)
+enum class TimeKind { real, imaginary };
+
+// cache of dense matrix exponentials keyed by operator content, step size and
+// time kind. translation-invariant chains and repeated runs with the same dt
+// then pay for one expm per distinct term. lookups are thread safe, and a
+// returned propagator stays valid after it is evicted
+class PropagatorCache {
+public:
+    using Matrix = Eigen::MatrixXcd;
+
+    explicit PropagatorCache(size_t capacity = 1024) : capacity_(capacity) {}
+
+    // the cache shared by all solvers unless they are given their own
+    static PropagatorCache& shared();
+
+    std::shared_ptr<const Matrix> get(const Matrix& op, double dt, TimeKind kind);
+
+    size_t size() const;
+    size_t hits() const;
+    size_t misses() const;
+    // oldest entries are evicted first once the capacity is exceeded
+    void set_capacity(size_t capacity);
+    void clear();
+
+private:
+    struct Entry {
+        Matrix op;
+        double dt;
+        TimeKind kind;
+        std::shared_ptr<const Matrix> propagator;
+    };
+
+    static uint64_t content_hash(const Matrix& op, double dt, TimeKind kind);
+    void evict();
+
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, std::vector<Entry>> entries_;
+    std::deque<uint64_t> insertion_order_;
+    size_t capacity_;
+    size_t size_ = 0;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+};
+
+} // namespace qps
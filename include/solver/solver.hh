@@ -1,7 +1,18 @@
 #pragma once
 
 #include "solver/tensor.hh"
+#include "solver/mps.hh"
+#include "solver/observables.hh"
+#include "solver/propagator_cache.hh"
+#include "solver/krylov.hh"
+#include "solver/integrator.hh"
+#include "solver/checkpoint.hh"
+#include "solver/metrics.hh"
+#include "solver/execution.hh"
+#include "solver/profiler.hh"
+#include <algorithm>
 #include <memory>
+#include <stdexcept>
 #include <vector>
 #include <string>
 
@@ -23,32 +34,152 @@ public:
 
     // set checkpoint directory
     void set_checkpoint_dir(const std::string& dir) { checkpoint_dir_ = dir; }
+    // states are written to <checkpoint_dir>/states.qpsc (see checkpoint.hh)
+    void set_checkpoint_compression(Compression compression) { checkpoint_compression_ = compression; }
+    // how often states.qpsc gets a committed snapshot (default: every step)
+    void set_checkpoint_policy(const CheckpointPolicy& policy) { checkpoint_policy_ = policy; }
+    // restore the last committed snapshot in the checkpoint directory, so the
+    // next build_network continues from there and appends to the same file.
+    // returns false (and changes nothing) if there is none to resume from
+    virtual bool resume() { throw std::runtime_error("this solver cannot resume from a checkpoint"); }
+    // first step the next build_network will run
+    int start_step() const { return start_step_; }
+
+    // verbosity, sampling and backpressure of solver_data.json / debug.log
+    void set_metrics(const MetricsConfig& config) { metrics_ = config; }
+
+    // matrix exponentials are shared through PropagatorCache::shared() unless
+    // a solver is given its own cache
+    void set_propagator_cache(PropagatorCache& cache) { propagators_ = &cache; }
+
+    // propagating solvers form dense exponentials by default; krylov mode
+    // applies exp(scale * H) to the state directly, for large local dimensions
+    void set_propagation_mode(PropagationMode mode, const KrylovParams& params = KrylovParams()) {
+        propagation_ = mode;
+        krylov_ = params;
+    }
+    const KrylovStats& krylov_stats() const { return krylov_stats_; }
+
+    // threading and precision for the contractions of the solver's tensor
+    // network and matrix product state
+    void set_execution_context(std::shared_ptr<const ExecutionContext> ctx) {
+        execution_ = ctx;
+        network_.set_execution_context(std::move(ctx));
+    }
+
+    // high-water mark of the tensor storage held by the solver
+    virtual size_t peak_memory_bytes() const { return network_.peak_bytes(); }
 
 protected:
     TensorNetwork network_;
+    std::shared_ptr<const ExecutionContext> execution_;  // null: serial
     std::vector<Tensor> local_operators_;
     std::vector<std::string> boundary_conditions_;
     std::string checkpoint_dir_;
+    Compression checkpoint_compression_ = Compression::none;
+    CheckpointPolicy checkpoint_policy_;
+    int start_step_ = 0;
+    MetricsConfig metrics_;
+    PropagatorCache* propagators_ = &PropagatorCache::shared();
+    PropagationMode propagation_ = PropagationMode::dense;
+    KrylovParams krylov_;
+    KrylovStats krylov_stats_;
+};
+
+// order in which TEBD applies its gates
+enum class SweepOrder {
+    sequential,  // forward then backward sweep over the sites
+    even_odd,    // layers of disjoint bonds, each layer's gates run concurrently
 };
 
-// solver for time evolution problems
+// solver for time evolution problems.
+// runs TEBD on a matrix product state: local_operators[i] is the on-site
+// term of site i, and optional bond operators couple sites (i, i+1)
 class TimeEvolutionSolver : public Solver {
 public:
     TimeEvolutionSolver(double time_step, int num_steps,
                        const std::vector<Tensor>& local_operators)
         : time_step_(time_step), num_steps_(num_steps),
-          local_operators_(local_operators) {}
+          local_operators_(local_operators) {
+        // the gates are small dense matrices; sparse terms are expanded once
+        for (auto& op : local_operators_) op = op.to_dense();
+    }
 
+    // dense state vector over all sites (site 0 slowest)
     void initialize_state(const Tensor& initial_state) override;
+    void initialize_state(const MatrixProductState& initial_state);
     void build_network(const std::vector<double>& params) override;
     double compute_quantity_of_interest() override;
+    bool resume() override;
+
+    // nearest-neighbour terms, bond_operators[i] acts on sites (i, i+1)
+    void set_bond_operators(const std::vector<Tensor>& bond_operators) {
+        bond_operators_ = bond_operators;
+        for (auto& op : bond_operators_) op = op.to_dense();
+    }
+    void set_truncation(const TruncationParams& truncation) { truncation_ = truncation; }
+    // even_odd runs each layer on num_threads workers (0: one per hardware
+    // thread, or one when the solver already runs on a pool worker); its
+    // results do not depend on the thread count
+    void set_sweep_order(SweepOrder order, size_t num_threads = 0) {
+        sweep_order_ = order;
+        sweep_threads_ = num_threads;
+    }
+
+    // splitting scheme of each step (default: second-order strang)
+    void set_integrator(Integrator integrator) { integrator_ = integrator; }
+    // step-size control by step doubling. time_step / num_steps is then only
+    // the first trial step, and the run ends at time_step
+    void set_adaptive(const AdaptiveParams& params) { adaptive_ = params; }
+    // accepted step sizes and rejected trial steps of the last run
+    const std::vector<double>& step_sizes() const { return step_sizes_; }
+    int rejected_steps() const { return rejected_steps_; }
+
+    // measured in one pass after every `every` steps and after the last;
+    // the values of the last run are in measurements()
+    void set_observables(ObservableBatch observables, int every = 1) {
+        observables_ = std::move(observables);
+        observe_every_ = std::max(1, every);
+    }
+    const std::vector<ObservableRecord>& measurements() const { return measurements_; }
+
+    const MatrixProductState& state() const { return state_; }
+    size_t peak_memory_bytes() const override { return peak_state_bytes_; }
+    // <H> of the current state
+    double energy();
 
 private:
     void build_trotter_decomposition();
+    // the run on the state in the precision of the execution context
+    template <typename T>
+    void evolve(BasicMatrixProductState<T>& state);
+    template <typename T>
+    double energy(BasicMatrixProductState<T>& state) const;
+    std::string checkpoint_params() const;
+    // hamiltonian term swept by gate i: h_i (x) 1 + bond_i, or h_{N-1} alone
+    Eigen::MatrixXcd local_term(size_t i) const;
+    // term of bond i in the even/odd split; the last bond also takes h_{N-1}
+    Eigen::MatrixXcd bond_term(size_t i) const;
     
     double time_step_;
     int num_steps_;
     std::vector<Tensor> local_operators_;
+    std::vector<Tensor> bond_operators_;
+    TruncationParams truncation_;
+    SweepOrder sweep_order_ = SweepOrder::sequential;
+    size_t sweep_threads_ = 0;
+    Integrator integrator_ = Integrator::second_order;
+    AdaptiveParams adaptive_;
+    std::vector<double> step_sizes_;
+    int rejected_steps_ = 0;
+    // where a resumed adaptive run continues
+    double start_time_ = 0.0;
+    double start_step_size_ = 0.0;
+    ObservableBatch observables_;
+    int observe_every_ = 1;
+    std::vector<ObservableRecord> measurements_;
+    MatrixProductState state_;
+    size_t peak_state_bytes_ = 0;
 };
 
 // solver for thermal/statistical problems
@@ -62,15 +193,101 @@ public:
     void initialize_state(const Tensor& initial_state) override;
     void build_network(const std::vector<double>& params) override;
     double compute_quantity_of_interest() override;
+    bool resume() override;
+
+    // the (trace-normalized) density matrix
+    const Tensor& state() const { return network_.get_tensor("rho"); }
 
 private:
     void build_imaginary_time_evolution();
+    std::string checkpoint_params() const;
     
     double beta_;
     int num_steps_;
     std::vector<Tensor> local_operators_;
 };
 
+// sites optimized together by a DMRG step
+enum class DMRGUpdate {
+    two_site,     // bonds grow up to the truncation limits
+    single_site,  // cheaper per step, but keeps the bond dimensions it starts with
+};
+
+struct DMRGParams {
+    int max_sweeps = 20;                // a sweep is one pass right and one back
+    int min_sweeps = 2;
+    double energy_tolerance = 1e-10;    // energy change over the last sweep
+    double truncation_tolerance = 1e-8; // largest discarded weight in the last sweep
+    DMRGUpdate update = DMRGUpdate::two_site;
+    KrylovParams eigensolver{20, 1e-10};  // local lanczos
+};
+
+// ground-state solver: DMRG sweeps over a matrix product state. the
+// hamiltonian is the one TimeEvolutionSolver evolves with, on-site terms
+// local_operators[i] plus nearest-neighbour bond operators, turned into an
+// MPO. the left and right environments of every site are cached, and a
+// sweep only extends them by the site it just updated
+class DMRGSolver : public Solver {
+public:
+    explicit DMRGSolver(const std::vector<Tensor>& local_operators)
+        : local_operators_(local_operators) {
+        for (auto& op : local_operators_) op = op.to_dense();
+    }
+
+    // dense state vector over all sites (site 0 slowest), or an mps. the
+    // start state needs an overlap with the ground state
+    void initialize_state(const Tensor& initial_state) override;
+    void initialize_state(const MatrixProductState& initial_state);
+    // sweep until converged or max_sweeps; params are unused
+    void build_network(const std::vector<double>& params) override;
+    // the ground-state energy
+    double compute_quantity_of_interest() override { return energy_; }
+    bool resume() override;
+
+    // nearest-neighbour terms, bond_operators[i] acts on sites (i, i+1)
+    void set_bond_operators(const std::vector<Tensor>& bond_operators) {
+        bond_operators_ = bond_operators;
+        for (auto& op : bond_operators_) op = op.to_dense();
+    }
+    void set_truncation(const TruncationParams& truncation) { truncation_ = truncation; }
+    void set_params(const DMRGParams& params) { params_ = params; }
+
+    const MatrixProductState& state() const { return state_; }
+    double energy() const { return energy_; }
+    // energy and largest discarded weight after each sweep of the last run
+    const std::vector<double>& sweep_energies() const { return sweep_energies_; }
+    const std::vector<double>& sweep_truncation() const { return sweep_truncation_; }
+    bool converged() const { return converged_; }
+    size_t peak_memory_bytes() const override { return peak_bytes_; }
+
+private:
+    void run_sweeps();
+    void build_mpo();
+    // optimize sites (i, i+1) and split them, leaving the center on i+1
+    // when sweeping right and on i otherwise; returns the discarded weight
+    double update_two_site(int i, bool sweep_right);
+    double update_one_site(int i, bool sweep_right);
+    std::string checkpoint_params() const;
+
+    std::vector<Tensor> local_operators_;
+    std::vector<Tensor> bond_operators_;
+    TruncationParams truncation_;
+    DMRGParams params_;
+    MatrixProductState state_;
+    // (mpo left, mpo right, out, in) per site
+    std::vector<Tensor> mpo_;
+    std::vector<Tensor> sites_;
+    // (ket bond, mpo bond, bra bond) environments of the sites left and
+    // right of site i
+    std::vector<Tensor> left_;
+    std::vector<Tensor> right_;
+    double energy_ = 0.0;
+    std::vector<double> sweep_energies_;
+    std::vector<double> sweep_truncation_;
+    bool converged_ = false;
+    size_t peak_bytes_ = 0;
+};
+
 // solver for expectation value problems
 class ExpectationValueSolver : public Solver {
 public:
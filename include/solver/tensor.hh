@@ -2,100 +2,576 @@
 
 #include <Eigen/Dense>
 #include <Eigen/Core>
+#include <Eigen/Sparse>
 #include <unsupported/Eigen/CXX11/Tensor>
 #include <unsupported/Eigen/CXX11/src/Tensor/Tensor.h>
+#include "solver/buffer_pool.hh"
+#include "solver/profiler.hh"
+#include <complex>
+#include <deque>
+#include <map>
 #include <vector>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <unordered_map>
+#include <initializer_list>
+#include <iosfwd>
+#include <utility>
 
 namespace qps {
 
-// tensor in the network with dimensions and data
-struct Tensor {
-    using DataType = Eigen::Tensor<double, 2>;  // rank-2 tensor (matrix)
+// interned index label. names are registered once in a process-wide table
+// and afterwards compared, hashed and copied as plain integers
+struct IndexId {
+    int value = -1;
+
+    IndexId() = default;
+    explicit IndexId(int id) : value(id) {}
+    IndexId(const std::string& name) : value(intern(name)) {}
+    IndexId(const char* name) : value(intern(name)) {}
+
+    const std::string& name() const;
+
+    bool operator==(IndexId other) const { return value == other.value; }
+    bool operator!=(IndexId other) const { return value != other.value; }
+    bool operator<(IndexId other) const { return value < other.value; }
+
+private:
+    static int intern(const std::string& name);
+};
+
+std::ostream& operator<<(std::ostream& os, IndexId idx);
+
+// dense column-major storage for a tensor of arbitrary rank
+// (the first index runs fastest, matching Eigen's default matrix layout).
+// the library instantiates it for complex<float> and complex<double>.
+// buffers come from and go back to the BufferPool (see buffer_pool.hh)
+template <typename T>
+class BasicTensorData {
+public:
+    using Scalar = T;
+    using Buffer = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+
+    BasicTensorData() = default;
+    explicit BasicTensorData(const std::vector<int>& dims) { resize(dims); }
+    BasicTensorData(const BasicTensorData& other)
+        : buffer_(acquire_buffer<Scalar>(other.size())), dims_(other.dims_), strides_(other.strides_) {
+        buffer_ = other.buffer_;
+    }
+    BasicTensorData(BasicTensorData&&) = default;
+    BasicTensorData& operator=(const BasicTensorData& other) {
+        if (this == &other) return *this;
+        if (buffer_.size() != other.size()) {
+            release_buffer<Scalar>(std::move(buffer_));
+            buffer_ = acquire_buffer<Scalar>(other.size());
+        }
+        buffer_ = other.buffer_;  // same size: no allocation
+        dims_ = other.dims_;
+        strides_ = other.strides_;
+        return *this;
+    }
+    // the moved-from side keeps the old buffer and releases it
+    BasicTensorData& operator=(BasicTensorData&&) = default;
+    ~BasicTensorData() { release_buffer<Scalar>(std::move(buffer_)); }
+
+    void resize(const std::vector<int>& dims) {
+        dims_.assign(dims.begin(), dims.end());
+        strides_.resize(dims.size());
+        Eigen::Index total = 1;
+        for (size_t k = 0; k < dims.size(); ++k) {
+            strides_[k] = total;
+            total *= dims[k];
+        }
+        if (buffer_.size() != total) {
+            release_buffer<Scalar>(std::move(buffer_));
+            buffer_ = acquire_buffer<Scalar>(total);
+        }
+        buffer_.setZero();
+    }
+
+    // take over an existing buffer without copying. a column-major buffer
+    // already has the first-index-fastest layout, only its shape changes
+    void adopt(Buffer&& buffer, const std::vector<int>& dims) {
+        Eigen::Index total = 1;
+        for (int d : dims) total *= d;
+        if (buffer.size() != total) {
+            throw std::runtime_error("adopted buffer size does not match the dimensions");
+        }
+        release_buffer<Scalar>(std::move(buffer_));
+        buffer_ = std::move(buffer);
+        buffer_.resize(total, 1);  // same size: keeps the allocation
+        dims_.assign(dims.begin(), dims.end());
+        strides_.resize(dims.size());
+        Eigen::Index stride = 1;
+        for (size_t k = 0; k < dims.size(); ++k) {
+            strides_[k] = stride;
+            stride *= dims[k];
+        }
+    }
+
+    // element-wise converted copy, e.g. complex<double> to complex<float>
+    template <typename U>
+    BasicTensorData<U> cast() const {
+        BasicTensorData<U> out;
+        typename BasicTensorData<U>::Buffer buffer = acquire_buffer<U>(size());
+        buffer = buffer_.template cast<U>();
+        out.adopt(std::move(buffer), std::vector<int>(dims_.begin(), dims_.end()));
+        return out;
+    }
+
+    int rank() const { return static_cast<int>(dims_.size()); }
+    Eigen::Index size() const { return buffer_.size(); }
+    Eigen::Index dimension(int k) const { return dims_[k]; }
+    Eigen::Index stride(int k) const { return strides_[k]; }
+
+    Scalar* data() { return buffer_.data(); }
+    const Scalar* data() const { return buffer_.data(); }
+
+    // linear (column-major) element access
+    Scalar& operator()(Eigen::Index i) { return buffer_(i); }
+    const Scalar& operator()(Eigen::Index i) const { return buffer_(i); }
+
+    // element access with one coordinate per index
+    template <typename... Idx>
+    Scalar& operator()(Eigen::Index i0, Eigen::Index i1, Idx... rest) {
+        return buffer_(offset(i0, i1, static_cast<Eigen::Index>(rest)...));
+    }
+    template <typename... Idx>
+    const Scalar& operator()(Eigen::Index i0, Eigen::Index i1, Idx... rest) const {
+        return buffer_(offset(i0, i1, static_cast<Eigen::Index>(rest)...));
+    }
+
+private:
+    template <typename... Idx>
+    Eigen::Index offset(Idx... idx) const {
+        const Eigen::Index coords[] = {idx...};
+        eigen_assert(sizeof...(Idx) == dims_.size());
+        Eigen::Index off = 0;
+        for (size_t k = 0; k < sizeof...(Idx); ++k) off += coords[k] * strides_[k];
+        return off;
+    }
+
+    Buffer buffer_;
+    std::vector<Eigen::Index> dims_;
+    std::vector<Eigen::Index> strides_;
+};
+
+extern template class BasicTensorData<std::complex<float>>;
+extern template class BasicTensorData<std::complex<double>>;
+
+using TensorData = BasicTensorData<std::complex<double>>;
+
+// tensor with dimensions and data, templated on its scalar type.
+// a tensor is dense unless `sparse` is set; its elements then live only in
+// that compressed row-major matrix, laid out like matrix_view() (rows are the
+// first index, columns the others in column-major order), and `data` is empty.
+// contractions mix both kinds; code that reads `data` directly takes dense
+// tensors (to_dense() converts).
+// Tensor is complex<double>, so that real-time propagators are exact, and it
+// is what networks, operators and checkpoints hold; complex<float> tensors
+// hold the state of single-precision runs (see MatrixProductState)
+template <typename T>
+struct BasicTensor {
+    using DataType = BasicTensorData<T>;  // dense tensor of any rank
+    using Scalar = T;
+    using Matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+    using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+    using SparseMatrix = Eigen::SparseMatrix<Scalar, Eigen::RowMajor>;
     DataType data;
-    std::vector<std::string> indices;  // index names
+    std::vector<IndexId> indices;  // interned index labels
     std::vector<int> dimensions;  // tensor dimensions
+    std::shared_ptr<const SparseMatrix> sparse;  // immutable, shared by copies
 
     // default constructor for unordered_map
-    Tensor() : data(0, 0) {}
+    BasicTensor() = default;
+
+    BasicTensor(const std::vector<int>& dims, std::initializer_list<IndexId> idx)
+        : BasicTensor(dims, std::vector<IndexId>(idx)) {}
+
+    // string labels are interned once here
+    BasicTensor(const std::vector<int>& dims, const std::vector<std::string>& idx)
+        : BasicTensor(dims, std::vector<IndexId>(idx.begin(), idx.end())) {}
 
-    Tensor(const std::vector<int>& dims, const std::vector<std::string>& idx)
+    BasicTensor(const std::vector<int>& dims, const std::vector<IndexId>& idx)
         : indices(idx), dimensions(dims) {
         if (dims.size() != idx.size()) {
             throw std::runtime_error("number of dimensions must match number of indices");
         }
-        if (dims.size() != 2) {
-            throw std::runtime_error("only rank-2 tensors are supported");
+        for (int d : dims) {
+            if (d <= 0) {
+                throw std::runtime_error("tensor dimensions must be positive");
+            }
         }
-        
-        data = DataType(dims[0], dims[1]);
+
+        data = DataType(dims);
     }
 
-    // helper function to create tensor from matrix
-    static Tensor from_matrix(const Eigen::MatrixXd& mat, 
-                            const std::vector<std::string>& idx = {"i", "j"}) {
-        Tensor tensor({static_cast<int>(mat.rows()), static_cast<int>(mat.cols())}, idx);
-        for (int i = 0; i < mat.rows(); ++i) {
-            for (int j = 0; j < mat.cols(); ++j) {
-                tensor.data(i, j) = mat(i, j);
-            }
-        }
+    using MatrixView = Eigen::Map<Matrix>;
+    using ConstMatrixView = Eigen::Map<const Matrix>;
+    using VectorView = Eigen::Map<Vector>;
+    using ConstVectorView = Eigen::Map<const Vector>;
+
+    // helper function to create tensor from a real or complex matrix
+    template <typename Derived>
+    static BasicTensor from_matrix(const Eigen::MatrixBase<Derived>& mat,
+                                   const std::vector<IndexId>& idx = {"i", "j"}) {
+        ScopedTimer timer(Phase::copy);
+        BasicTensor tensor({static_cast<int>(mat.rows()), static_cast<int>(mat.cols())}, idx);
+        tensor.matrix_view() = mat.template cast<Scalar>();
         return tensor;
     }
 
-    // helper function to create tensor from vector
-    static Tensor from_vector(const Eigen::VectorXd& vec,
-                            const std::vector<std::string>& idx = {"i", "col"}) {
-        Tensor tensor({static_cast<int>(vec.size()), 1}, idx);
-        for (int i = 0; i < vec.size(); ++i) {
-            tensor.data(i, 0) = vec(i);
+    // adopt the storage of a matrix of the tensor's scalar; no element is copied
+    static BasicTensor from_matrix(Matrix&& mat, const std::vector<IndexId>& idx = {"i", "j"}) {
+        BasicTensor tensor;
+        tensor.indices = idx;
+        tensor.dimensions = {static_cast<int>(mat.rows()), static_cast<int>(mat.cols())};
+        if (idx.size() != 2) {
+            throw std::runtime_error("number of dimensions must match number of indices");
         }
+        tensor.data.adopt(std::move(mat), tensor.dimensions);
         return tensor;
     }
 
-    // helper function to convert tensor to matrix
-    Eigen::MatrixXd to_matrix() const {
-        Eigen::MatrixXd mat(data.dimension(0), data.dimension(1));
-        for (int i = 0; i < data.dimension(0); ++i) {
-            for (int j = 0; j < data.dimension(1); ++j) {
-                mat(i, j) = data(i, j);
-            }
+    // helper function to create tensor from a real or complex vector
+    template <typename Derived>
+    static BasicTensor from_vector(const Eigen::MatrixBase<Derived>& vec,
+                                   const std::vector<IndexId>& idx = {"i", "col"}) {
+        ScopedTimer timer(Phase::copy);
+        BasicTensor tensor({static_cast<int>(vec.size()), 1}, idx);
+        tensor.vector_view() = vec.template cast<Scalar>();
+        return tensor;
+    }
+
+    static BasicTensor from_vector(Vector&& vec, const std::vector<IndexId>& idx = {"i", "col"}) {
+        Matrix column = std::move(vec);  // moves the allocation
+        return from_matrix(std::move(column), idx);
+    }
+
+    // sparse tensor from a sparse matrix
+    template <typename Derived>
+    static BasicTensor from_sparse(const Eigen::SparseMatrixBase<Derived>& mat,
+                                   const std::vector<IndexId>& idx = {"i", "j"}) {
+        return from_sparse(SparseMatrix(mat.template cast<Scalar>()),
+                           {static_cast<int>(mat.rows()), static_cast<int>(mat.cols())}, idx);
+    }
+    // any rank: `mat` has the first index as rows and the others as columns
+    static BasicTensor from_sparse(SparseMatrix mat, const std::vector<int>& dims, const std::vector<IndexId>& idx);
+
+    bool is_sparse() const { return sparse != nullptr; }
+    // stored elements: the nonzeros of a sparse tensor, all of a dense one
+    Eigen::Index nonzeros() const { return sparse ? sparse->nonZeros() : data.size(); }
+    // dense copy (of a dense tensor too)
+    BasicTensor to_dense() const;
+    // sparse copy keeping the elements with |x| > tolerance
+    BasicTensor to_sparse(double tolerance = 0.0) const;
+
+    // element-wise converted copy, e.g. complex<double> to complex<float>;
+    // a sparse tensor stays sparse
+    template <typename U>
+    BasicTensor<U> cast() const {
+        BasicTensor<U> out;
+        out.indices = indices;
+        out.dimensions = dimensions;
+        if (sparse) {
+            out.sparse = std::make_shared<const typename BasicTensor<U>::SparseMatrix>(sparse->template cast<U>());
+        } else {
+            out.data = data.template cast<U>();
+        }
+        return out;
+    }
+
+    // view the buffer as a matrix whose rows are the first `row_rank` indices
+    // and whose columns are the rest; no copy is made
+    MatrixView matrix_view(int row_rank = 1) {
+        return MatrixView(data.data(), view_rows(row_rank), data.size() / view_rows(row_rank));
+    }
+    ConstMatrixView matrix_view(int row_rank = 1) const {
+        return ConstMatrixView(data.data(), view_rows(row_rank), data.size() / view_rows(row_rank));
+    }
+
+    // all elements in storage order
+    VectorView vector_view() { return VectorView(data.data(), data.size()); }
+    ConstVectorView vector_view() const { return ConstVectorView(data.data(), data.size()); }
+
+    // Eigen::TensorMap over the buffer (column-major, like TensorData)
+    template <int Rank>
+    Eigen::TensorMap<Eigen::Tensor<Scalar, Rank>> tensor_view() {
+        return Eigen::TensorMap<Eigen::Tensor<Scalar, Rank>>(data.data(), view_dims<Rank>());
+    }
+    template <int Rank>
+    Eigen::TensorMap<const Eigen::Tensor<Scalar, Rank>> tensor_view() const {
+        return Eigen::TensorMap<const Eigen::Tensor<Scalar, Rank>>(data.data(), view_dims<Rank>());
+    }
+
+    // helper function to convert tensor to matrix (a copy; prefer matrix_view)
+    Matrix to_matrix() const {
+        if (rank() != 2) {
+            throw std::runtime_error("only rank-2 tensors can be converted to a matrix");
         }
-        return mat;
+        ScopedTimer timer(Phase::copy);
+        if (sparse) return Matrix(*sparse);
+        return matrix_view();
     }
 
-    // helper function to convert tensor to vector
-    Eigen::VectorXd to_vector() const {
-        if (data.dimension(1) != 1) {
+    // helper function to convert tensor to vector (a copy; prefer vector_view)
+    Vector to_vector() const {
+        if (rank() != 2 || data.dimension(1) != 1) {
             throw std::runtime_error("tensor must have second dimension of 1 to convert to vector");
         }
-        Eigen::VectorXd vec(data.dimension(0));
-        for (int i = 0; i < data.dimension(0); ++i) {
-            vec(i) = data(i, 0);
+        ScopedTimer timer(Phase::copy);
+        return vector_view();
+    }
+
+    // element-wise complex conjugate (the bra of a state tensor)
+    BasicTensor conj() const {
+        BasicTensor result = *this;
+        if (sparse) {
+            result.sparse = std::make_shared<const SparseMatrix>(sparse->conjugate());
+            return result;
         }
-        return vec;
+        Scalar* p = result.data.data();
+        for (Eigen::Index i = 0; i < result.data.size(); ++i) p[i] = std::conj(p[i]);
+        return result;
     }
 
     int rank() const { return indices.size(); }
+
+    // position of an index label, or -1 if the tensor does not carry it
+    int index_position(IndexId idx) const {
+        for (size_t k = 0; k < indices.size(); ++k) {
+            if (indices[k] == idx) return static_cast<int>(k);
+        }
+        return -1;
+    }
+
+    // index labels as strings, for logging and the string API
+    std::vector<std::string> index_names() const {
+        std::vector<std::string> names;
+        for (IndexId idx : indices) names.push_back(idx.name());
+        return names;
+    }
+
+private:
+    template <int Rank>
+    Eigen::array<Eigen::Index, Rank> view_dims() const {
+        if (Rank != rank()) {
+            throw std::runtime_error("tensor view rank does not match the tensor");
+        }
+        Eigen::array<Eigen::Index, Rank> dims;
+        for (int k = 0; k < Rank; ++k) dims[k] = dimensions[k];
+        return dims;
+    }
+
+    Eigen::Index view_rows(int row_rank) const {
+        if (sparse) {
+            throw std::runtime_error("a sparse tensor has no dense view; use to_dense()");
+        }
+        if (row_rank < 0 || row_rank > rank()) {
+            throw std::runtime_error("matrix view splits the indices out of range");
+        }
+        Eigen::Index rows = 1;
+        for (int k = 0; k < row_rank; ++k) rows *= dimensions[k];
+        return rows;
+    }
 };
 
-// tensor network with tensors and operations
+extern template struct BasicTensor<std::complex<float>>;
+extern template struct BasicTensor<std::complex<double>>;
+
+using Tensor = BasicTensor<std::complex<double>>;
+
+// a tensor in complex<double>: the tensor itself, or a widened copy of a
+// single-precision one
+inline const Tensor& widen(const Tensor& t) { return t; }
+inline Tensor widen(Tensor&& t) { return std::move(t); }
+inline Tensor widen(const BasicTensor<std::complex<float>>& t) { return t.cast<Tensor::Scalar>(); }
+
+class ExecutionContext;
+
+// reorder the indices of a tensor: result index k is source index order[k].
+// a sparse tensor stays sparse
+template <typename T>
+BasicTensor<T> permute(const BasicTensor<T>& tensor, const std::vector<int>& order);
+template <typename T>
+BasicTensor<T> permute(const BasicTensor<T>& tensor, const std::vector<int>& order, const ExecutionContext& ctx);
+
+// contract two tensors over the given (t1 position, t2 position) pairs.
+// the result carries the free indices of t1 followed by those of t2, and is
+// evaluated as a single permute + GEMM (zgemm for complex<double>, cgemm for
+// complex<float>). a sparse operand is multiplied through its nonzeros
+// instead, so the cost scales with nnz; the result is dense unless both
+// operands are sparse
+template <typename T>
+BasicTensor<T> contract_tensors(const BasicTensor<T>& t1, const BasicTensor<T>& t2,
+                                const std::vector<std::pair<int, int>>& index_pairs);
+// the same, with the permutation and gemm spread as `ctx` allows
+template <typename T>
+BasicTensor<T> contract_tensors(const BasicTensor<T>& t1, const BasicTensor<T>& t2,
+                                const std::vector<std::pair<int, int>>& index_pairs,
+                                const ExecutionContext& ctx);
+
+extern template BasicTensor<std::complex<float>> permute(const BasicTensor<std::complex<float>>&,
+                                                         const std::vector<int>&);
+extern template BasicTensor<std::complex<double>> permute(const BasicTensor<std::complex<double>>&,
+                                                          const std::vector<int>&);
+extern template BasicTensor<std::complex<float>> permute(const BasicTensor<std::complex<float>>&,
+                                                         const std::vector<int>&, const ExecutionContext&);
+extern template BasicTensor<std::complex<double>> permute(const BasicTensor<std::complex<double>>&,
+                                                          const std::vector<int>&, const ExecutionContext&);
+extern template BasicTensor<std::complex<float>> contract_tensors(
+    const BasicTensor<std::complex<float>>&, const BasicTensor<std::complex<float>>&,
+    const std::vector<std::pair<int, int>>&);
+extern template BasicTensor<std::complex<double>> contract_tensors(
+    const BasicTensor<std::complex<double>>&, const BasicTensor<std::complex<double>>&,
+    const std::vector<std::pair<int, int>>&);
+extern template BasicTensor<std::complex<float>> contract_tensors(
+    const BasicTensor<std::complex<float>>&, const BasicTensor<std::complex<float>>&,
+    const std::vector<std::pair<int, int>>&, const ExecutionContext&);
+extern template BasicTensor<std::complex<double>> contract_tensors(
+    const BasicTensor<std::complex<double>>&, const BasicTensor<std::complex<double>>&,
+    const std::vector<std::pair<int, int>>&, const ExecutionContext&);
+
+// tr(op * m) for a rank-2 operator: O(d^2) dense, O(nnz) sparse
+Tensor::Scalar trace_product(const Tensor& op, const Eigen::Ref<const Eigen::MatrixXcd>& m);
+
+// contraction order for a multi-tensor network. inputs are numbered
+// 0..n-1 and step k produces tensor n+k, so each step names its operands
+// independently of how earlier steps were stored
+enum class PathMethod { automatic, greedy, exhaustive };
+
+struct ContractionStep {
+    int lhs;
+    int rhs;
+};
+
+struct ContractionPlan {
+    std::vector<ContractionStep> steps;
+    double flops = 0.0;          // multiply-adds summed over all steps
+    double peak_elements = 0.0;  // largest intermediate
+};
+
+struct TensorShape {
+    std::vector<IndexId> indices;
+    std::vector<int> dimensions;
+};
+
+// find a low-cost pairwise order. an index shared by two inputs is summed
+// over; an index carried by one input must be listed in `output`. the cost of
+// a step is its multiply-adds plus the elements it writes. exhaustive search
+// is exact and used by `automatic` for up to 8 inputs, greedy otherwise
+ContractionPlan plan_contraction(const std::vector<TensorShape>& inputs,
+                                 const std::vector<IndexId>& output,
+                                 PathMethod method = PathMethod::automatic);
+
+// lightweight reference to a tensor stored in a TensorNetwork. the
+// generation detects handles that outlived a released tensor
+struct TensorHandle {
+    int slot = -1;
+    int generation = 0;
+
+    bool valid() const { return slot >= 0; }
+    bool operator==(TensorHandle other) const {
+        return slot == other.slot && generation == other.generation;
+    }
+    bool operator!=(TensorHandle other) const { return !(*this == other); }
+};
+
+// tensor network with tensors and operations.
+// tensors live in slots addressed by handles; names are only resolved by the
+// string API, which is a thin layer over the handle-based one. a tensor lives
+// until it is released or replaced, and released slots are reused, so a loop
+// that updates its state in place runs at a constant memory footprint
 class TensorNetwork {
 public:
     TensorNetwork() = default;
     ~TensorNetwork() = default;
 
-    void add_tensor(const Tensor& tensor, const std::string& name);
+    // insert a new tensor; throws if the name is taken
+    TensorHandle add_tensor(const Tensor& tensor, const std::string& name);
+    TensorHandle add_tensor(Tensor&& tensor, const std::string& name);
+    // insert, or replace the tensor already registered under this name
+    TensorHandle set_tensor(const std::string& name, Tensor tensor);
+    // replace the contents of a live tensor in place
+    void update_tensor(TensorHandle handle, Tensor tensor);
+    // free a tensor and its name; the handle becomes stale
+    void release(TensorHandle handle);
+    void release(const std::string& name);
+    bool contains(const std::string& name) const { return names_.count(name) != 0; }
+
+    const Tensor& get_tensor(TensorHandle handle) const;
+    Tensor contract(TensorHandle tensor1, TensorHandle tensor2,
+                   const std::vector<IndexId>& indices_to_contract) const;
+
+    // string compatibility layer
+    TensorHandle handle(const std::string& name) const;
     Tensor contract(const std::string& tensor1_name,
                    const std::string& tensor2_name,
                    const std::vector<std::string>& indices_to_contract);
     const Tensor& get_tensor(const std::string& name) const;
 
+    // contract a whole sub-network down to one tensor with indices `output`
+    // (in that order). the order is planned once per network shape and reused;
+    // the plan cache is locked, so const calls may run concurrently
+    Tensor contract_all(const std::vector<TensorHandle>& tensors,
+                       const std::vector<IndexId>& output,
+                       PathMethod method = PathMethod::automatic) const;
+    Tensor contract_all(const std::vector<std::string>& names,
+                       const std::vector<std::string>& output);
+    size_t cached_plans() const {
+        std::lock_guard<std::mutex> lock(plan_mutex_);
+        return plan_cache_.size();
+    }
+
+    // threading for every contraction the network performs; serial until
+    // set. a context may be shared between networks
+    void set_execution_context(std::shared_ptr<const ExecutionContext> ctx) { execution_ = std::move(ctx); }
+    const ExecutionContext& execution_context() const;
+
+    // memory accounting for tensor data held by the network
+    size_t num_tensors() const { return names_.size(); }
+    size_t bytes_in_use() const { return bytes_in_use_; }
+    size_t peak_bytes() const { return peak_bytes_; }
+    void reset_peak() { peak_bytes_ = bytes_in_use_; }
+
 private:
-    std::unordered_map<std::string, Tensor> tensors_;
+    struct Slot {
+        Tensor tensor;
+        std::string name;
+        int generation = 0;
+        bool live = false;
+    };
+
+    Slot& checked_slot(TensorHandle handle);
+    const Slot& checked_slot(TensorHandle handle) const;
+    static size_t tensor_bytes(const Tensor& t) {
+        size_t bytes = t.data.size() * sizeof(Tensor::Scalar);
+        if (t.sparse) {
+            bytes += t.sparse->nonZeros() * (sizeof(Tensor::Scalar) + sizeof(Tensor::SparseMatrix::StorageIndex)) +
+                     (t.sparse->outerSize() + 1) * sizeof(Tensor::SparseMatrix::StorageIndex);
+        }
+        return bytes;
+    }
+    void account(size_t added, size_t removed);
+
+    std::deque<Slot> slots_;  // deque keeps references stable on insert
+    std::vector<int> free_slots_;
+    std::unordered_map<std::string, int> names_;
+    // keyed by the encoded shapes, output labels and method
+    mutable std::map<std::vector<int>, ContractionPlan> plan_cache_;
+    mutable std::mutex plan_mutex_;
+    std::shared_ptr<const ExecutionContext> execution_;
+    size_t bytes_in_use_ = 0;
+    size_t peak_bytes_ = 0;
 };
 
 } // namespace qps
 
+namespace std {
+template <>
+struct hash<qps::IndexId> {
+    size_t operator()(qps::IndexId idx) const noexcept { return std::hash<int>()(idx.value); }
+};
+} // namespace std
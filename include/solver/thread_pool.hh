@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qps {
+
+// fixed-size work-stealing pool. every worker owns a task deque: it pops its
+// own work from the back and, when that runs dry, steals from the front of
+// the others, so uneven jobs still keep all workers busy
+class ThreadPool {
+public:
+    // 0 means one worker per hardware thread
+    explicit ThreadPool(size_t num_threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return threads_.size(); }
+
+    // tasks submitted from a worker go to its own deque, others are dealt
+    // round robin
+    void submit(std::function<void()> task);
+    // block until every submitted task has finished; rethrows the first
+    // exception a task threw
+    void wait();
+
+    // index of the calling worker in its pool, or -1 off the pool
+    static int current_worker();
+    // tasks taken from another worker's deque so far
+    size_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(size_t id);
+    bool try_pop(size_t id, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;   // tasks queued or stopping
+    std::condition_variable idle_;   // pending_ reached zero
+    std::atomic<size_t> queued_{0};  // tasks sitting in deques
+    size_t pending_ = 0;             // tasks submitted but not finished
+    std::atomic<size_t> next_{0};
+    std::atomic<size_t> steals_{0};
+    std::exception_ptr error_;
+    bool stop_ = false;
+};
+
+} // namespace qps
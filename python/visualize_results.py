@@ -1,6 +1,8 @@
 #!/usr/bin/env python3
 
 import json
+import struct
+import zlib
 import numpy as np
 import matplotlib.pyplot as plt
 from pathlib import Path
@@ -14,6 +16,52 @@ plt.rcParams.update({
     "text.latex.preamble": r"\usepackage{amsmath}"
 })
 
+# binary checkpoint layout, see include/solver/checkpoint.hh
+_FILE_MAGIC = b"QPSCKPT\0"
+_RECORD_MAGIC = 0x43455251
+_RECORD = struct.Struct("<IIQQqdIIIIII")  # fixed 64-byte record header
+
+def load_checkpoint(path):
+    """Index a binary checkpoint file (states.qpsc).
+
+    Returns one dict per record with name, step, time, index_names, params
+    and data. Uncompressed payloads are np.memmap views of the file (Fortran
+    order, matching the column-major C++ layout); zlib records are decoded.
+    """
+    path = Path(path)
+    size = path.stat().st_size
+    records = []
+    with open(path, 'rb') as f:
+        if f.read(16)[:8] != _FILE_MAGIC:
+            raise ValueError(f"{path} is not a checkpoint file")
+        offset = 16
+        while offset + _RECORD.size <= size:
+            f.seek(offset)
+            (magic, header_bytes, payload_bytes, raw_bytes, step, time, dtype,
+             compression, rank, name_len, indices_len, params_len) = _RECORD.unpack(f.read(_RECORD.size))
+            # a record cut short by a crash ends the file
+            if magic != _RECORD_MAGIC or offset + header_bytes + payload_bytes > size:
+                break
+            dims = struct.unpack(f"<{rank}q", f.read(8 * rank))
+            name = f.read(name_len).decode()
+            index_names = f.read(indices_len).decode().split("\n") if rank else []
+            params = json.loads(f.read(params_len) or b"{}")
+            payload_offset = offset + header_bytes
+            shape = dims if rank else (1,)
+            if compression == 0:
+                data = np.memmap(path, dtype=np.complex128, mode='r',
+                                 offset=payload_offset, shape=shape, order='F')
+            else:
+                f.seek(payload_offset)
+                raw = zlib.decompress(f.read(payload_bytes))
+                data = np.frombuffer(raw, dtype=np.complex128).reshape(shape, order='F')
+            records.append({
+                'name': name, 'step': step, 'time': time, 'dims': dims,
+                'index_names': index_names, 'params': params, 'data': data,
+            })
+            offset = payload_offset + payload_bytes
+    return records
+
 def load_solver_data(checkpoint_dir):
     """Load solver data from JSON file."""
     data_file = Path(checkpoint_dir) / "solver_data.json"
@@ -54,7 +102,10 @@ def plot_metrics(data, output_dir):
 
 def plot_site_metrics(data, output_dir):
     """Plot metrics for each site during forward and backward sweeps."""
-    steps = data['time_evolution']['steps']
+    # per-gate entries are absent below gate verbosity
+    steps = [s for s in data['time_evolution']['steps'] if s['forward_sweep']]
+    if not steps:
+        return
     num_sites = len(steps[0]['forward_sweep'])
     
     # Create figure for forward sweep
@@ -101,6 +152,27 @@ def plot_site_metrics(data, output_dir):
     plt.savefig(Path(output_dir) / 'backward_sweep_metrics.png')
     plt.close()
 
+def plot_bond_dimensions(records, output_dir):
+    """Plot the largest MPS bond dimension per step from checkpoint shapes."""
+    by_time = {}
+    for r in records:
+        if r['name'].startswith('site_') and len(r['dims']) == 3:
+            by_time[r['time']] = max(by_time.get(r['time'], 1), r['dims'][2])
+    if not by_time:
+        return
+    times = sorted(by_time)
+
+    fig, ax = plt.subplots(figsize=(10, 4))
+    ax.step(times, [by_time[t] for t in times], 'g-', where='post', label='Max Bond Dimension')
+    ax.set_xlabel('Time')
+    ax.set_ylabel(r'$\chi$')
+    ax.set_title('Bond Dimension Growth')
+    ax.grid(True)
+    ax.legend()
+    plt.tight_layout()
+    plt.savefig(Path(output_dir) / 'bond_dims.png')
+    plt.close()
+
 def main():
     parser = argparse.ArgumentParser(description='Visualize quantum solver results')
     parser.add_argument('checkpoint_dir', help='Directory containing solver output files')
@@ -116,6 +188,10 @@ def main():
     # Generate plots
     plot_metrics(data, output_dir)
     plot_site_metrics(data, output_dir)
+
+    states_file = Path(args.checkpoint_dir) / 'states.qpsc'
+    if states_file.exists():
+        plot_bond_dimensions(load_checkpoint(states_file), output_dir)
     
     print(f"Plots saved to {output_dir}")
 
@@ -0,0 +1,391 @@
+#include "solver/block_tensor.hh"
+#include "solver/profiler.hh"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace qps {
+
+namespace {
+
+// calls f(key) for every choice of one sector per index, first index fastest
+template <typename F>
+void for_each_key(const std::vector<QnIndex>& indices, F f) {
+    for (const QnIndex& idx : indices) {
+        if (idx.sectors.empty()) return;
+    }
+    BlockTensor::Key key(indices.size(), 0);
+    for (;;) {
+        f(key);
+        size_t k = 0;
+        while (k < key.size() && ++key[k] == static_cast<int>(indices[k].sectors.size())) key[k++] = 0;
+        if (k == key.size()) return;
+    }
+}
+
+// calls f(dense offset, block offset, length) for each contiguous run of
+// the region a block occupies in the dense layout
+template <typename F>
+void for_each_run(const std::vector<int>& dense_dims, const std::vector<int>& block_dims,
+                  const std::vector<int>& offsets, F f) {
+    const int r = static_cast<int>(block_dims.size());
+    if (r == 0) {
+        f(0, 0, 1);
+        return;
+    }
+    std::vector<Eigen::Index> strides(r, 1);
+    for (int k = 1; k < r; ++k) strides[k] = strides[k - 1] * dense_dims[k - 1];
+    const Eigen::Index run = block_dims[0];
+    std::vector<int> coord(r, 0);
+    Eigen::Index src = 0;
+    for (;;) {
+        Eigen::Index off = offsets[0];
+        for (int k = 1; k < r; ++k) off += (offsets[k] + coord[k]) * strides[k];
+        f(off, src, run);
+        src += run;
+        int k = 1;
+        while (k < r && ++coord[k] == block_dims[k]) coord[k++] = 0;
+        if (k == r) return;
+    }
+}
+
+std::vector<int> block_offsets(const std::vector<QnIndex>& indices, const BlockTensor::Key& key) {
+    std::vector<int> offsets(key.size());
+    for (size_t k = 0; k < key.size(); ++k) offsets[k] = indices[k].offset(key[k]);
+    return offsets;
+}
+
+// sectors of the row (or column) indices of an svd, grouped by their fused
+// charge; each key gets a row range in the matrix of its charge
+struct SvdGroup {
+    std::map<BlockTensor::Key, Eigen::Index> row_offsets;
+    std::map<BlockTensor::Key, Eigen::Index> col_offsets;
+    Eigen::Index rows = 0;
+    Eigen::Index cols = 0;
+};
+
+Eigen::Index block_extent(const std::vector<QnIndex>& indices, const BlockTensor::Key& key, size_t first) {
+    Eigen::Index n = 1;
+    for (size_t k = 0; k < key.size(); ++k) n *= indices[first + k].sectors[key[k]].dim;
+    return n;
+}
+
+} // namespace
+
+BlockTensor::BlockTensor(Symmetry symmetry, std::vector<QnIndex> indices, int charge)
+    : symmetry_(symmetry), indices_(std::move(indices)), charge_(normalize_charge(symmetry, charge)) {
+    for (QnIndex& idx : indices_) {
+        if (idx.flow != 1 && idx.flow != -1) {
+            throw std::runtime_error("index flow must be +1 or -1");
+        }
+        for (size_t a = 0; a < idx.sectors.size(); ++a) {
+            idx.sectors[a].charge = normalize_charge(symmetry, idx.sectors[a].charge);
+            if (idx.sectors[a].dim <= 0) {
+                throw std::runtime_error("sector dimensions must be positive");
+            }
+            for (size_t b = 0; b < a; ++b) {
+                if (idx.sectors[a].charge == idx.sectors[b].charge) {
+                    throw std::runtime_error("an index lists the same charge twice");
+                }
+            }
+        }
+    }
+}
+
+BlockTensor BlockTensor::zeros(Symmetry symmetry, std::vector<QnIndex> indices, int charge) {
+    BlockTensor t(symmetry, std::move(indices), charge);
+    for_each_key(t.indices_, [&](const Key& key) {
+        if (t.allowed(key)) t.blocks_.emplace(key, t.make_block(key));
+    });
+    return t;
+}
+
+BlockTensor BlockTensor::random(Symmetry symmetry, std::vector<QnIndex> indices, int charge) {
+    BlockTensor t = zeros(symmetry, std::move(indices), charge);
+    for (auto& entry : t.blocks_) entry.second.vector_view().setRandom();
+    return t;
+}
+
+BlockTensor BlockTensor::from_dense(const Tensor& dense, Symmetry symmetry, std::vector<QnIndex> indices,
+                                    int charge, double tolerance) {
+    if (dense.is_sparse()) return from_dense(dense.to_dense(), symmetry, std::move(indices), charge, tolerance);
+    BlockTensor t(symmetry, std::move(indices), charge);
+    if (dense.rank() != t.rank()) {
+        throw std::runtime_error("dense tensor rank does not match the block indices");
+    }
+    for (int k = 0; k < t.rank(); ++k) {
+        if (dense.dimensions[k] != t.indices_[k].dimension()) {
+            throw std::runtime_error("dense tensor dimensions do not match the block sectors");
+        }
+    }
+    double kept = 0.0;
+    for_each_key(t.indices_, [&](const Key& key) {
+        if (!t.allowed(key)) return;
+        Tensor b = t.make_block(key);
+        const Tensor::Scalar* src = dense.data.data();
+        Tensor::Scalar* dst = b.data.data();
+        for_each_run(dense.dimensions, b.dimensions, block_offsets(t.indices_, key),
+                     [&](Eigen::Index d, Eigen::Index k, Eigen::Index n) { std::copy(src + d, src + d + n, dst + k); });
+        kept += b.vector_view().squaredNorm();
+        t.blocks_.emplace(key, std::move(b));
+    });
+    // whatever the blocks did not take is forbidden by the symmetry
+    const double forbidden = dense.vector_view().squaredNorm() - kept;
+    if (forbidden > tolerance * tolerance) {
+        Tensor rest = t.to_dense();
+        rest.vector_view() -= dense.vector_view();
+        if (rest.vector_view().cwiseAbs().maxCoeff() > tolerance) {
+            throw std::runtime_error("dense tensor does not conserve the block charge");
+        }
+    }
+    return t;
+}
+
+Tensor BlockTensor::to_dense() const {
+    std::vector<int> dims;
+    std::vector<IndexId> labels;
+    for (const QnIndex& idx : indices_) {
+        dims.push_back(idx.dimension());
+        labels.push_back(idx.label);
+    }
+    Tensor dense(dims, labels);
+    for (const auto& entry : blocks_) {
+        const Tensor::Scalar* src = entry.second.data.data();
+        Tensor::Scalar* dst = dense.data.data();
+        for_each_run(dims, entry.second.dimensions, block_offsets(indices_, entry.first),
+                     [&](Eigen::Index d, Eigen::Index k, Eigen::Index n) { std::copy(src + k, src + k + n, dst + d); });
+    }
+    return dense;
+}
+
+bool BlockTensor::allowed(const Key& key) const {
+    if (key.size() != indices_.size()) return false;
+    int q = 0;
+    for (size_t k = 0; k < key.size(); ++k) {
+        if (key[k] < 0 || key[k] >= static_cast<int>(indices_[k].sectors.size())) return false;
+        q += indices_[k].flow * indices_[k].sectors[key[k]].charge;
+    }
+    return normalize_charge(symmetry_, q) == charge_;
+}
+
+Tensor BlockTensor::make_block(const Key& key) const {
+    std::vector<int> dims;
+    std::vector<IndexId> labels;
+    for (size_t k = 0; k < key.size(); ++k) {
+        dims.push_back(indices_[k].sectors[key[k]].dim);
+        labels.push_back(indices_[k].label);
+    }
+    return Tensor(dims, labels);
+}
+
+Tensor& BlockTensor::block(const Key& key) {
+    auto it = blocks_.find(key);
+    if (it != blocks_.end()) return it->second;
+    if (!allowed(key)) {
+        throw std::runtime_error("block is forbidden by the symmetry");
+    }
+    return blocks_.emplace(key, make_block(key)).first->second;
+}
+
+const Tensor* BlockTensor::find_block(const Key& key) const {
+    auto it = blocks_.find(key);
+    return it == blocks_.end() ? nullptr : &it->second;
+}
+
+void BlockTensor::accumulate(const Key& key, Tensor&& t) {
+    auto it = blocks_.find(key);
+    if (it == blocks_.end()) {
+        if (!allowed(key)) {
+            throw std::runtime_error("block is forbidden by the symmetry");
+        }
+        blocks_.emplace(key, std::move(t));
+        return;
+    }
+    if (it->second.dimensions != t.dimensions) {
+        throw std::runtime_error("accumulated block does not match the sector dimensions");
+    }
+    it->second.vector_view() += t.vector_view();
+}
+
+Eigen::Index BlockTensor::nonzeros() const {
+    Eigen::Index n = 0;
+    for (const auto& entry : blocks_) n += entry.second.data.size();
+    return n;
+}
+
+double BlockTensor::norm() const {
+    double sum = 0.0;
+    for (const auto& entry : blocks_) sum += entry.second.vector_view().squaredNorm();
+    return std::sqrt(sum);
+}
+
+BlockTensor BlockTensor::conj() const {
+    BlockTensor result = *this;
+    for (QnIndex& idx : result.indices_) idx.flow = -idx.flow;
+    result.charge_ = normalize_charge(symmetry_, -charge_);
+    for (auto& entry : result.blocks_) entry.second = entry.second.conj();
+    return result;
+}
+
+BlockTensor permute(const BlockTensor& tensor, const std::vector<int>& order) {
+    if (static_cast<int>(order.size()) != tensor.rank()) {
+        throw std::runtime_error("permutation does not match the tensor rank");
+    }
+    std::vector<QnIndex> indices;
+    for (int k : order) indices.push_back(tensor.indices()[k]);
+    BlockTensor result(tensor.symmetry(), std::move(indices), tensor.charge());
+    for (const auto& entry : tensor.blocks()) {
+        BlockTensor::Key key;
+        for (int k : order) key.push_back(entry.first[k]);
+        result.accumulate(key, permute(entry.second, order));
+    }
+    return result;
+}
+
+BlockTensor contract_tensors(const BlockTensor& t1, const BlockTensor& t2,
+                             const std::vector<std::pair<int, int>>& index_pairs) {
+    if (t1.symmetry() != t2.symmetry()) {
+        throw std::runtime_error("contracted block tensors have different symmetries");
+    }
+    std::vector<bool> contracted1(t1.rank(), false), contracted2(t2.rank(), false);
+    for (const auto& p : index_pairs) {
+        if (p.first < 0 || p.first >= t1.rank() || p.second < 0 || p.second >= t2.rank()) {
+            throw std::runtime_error("contracted index out of range");
+        }
+        const QnIndex& a = t1.indices()[p.first];
+        const QnIndex& b = t2.indices()[p.second];
+        if (a.flow != -b.flow || a.sectors != b.sectors) {
+            throw std::runtime_error("contracted block indices need the same sectors and opposite flows");
+        }
+        contracted1[p.first] = contracted2[p.second] = true;
+    }
+
+    std::vector<QnIndex> indices;
+    for (int k = 0; k < t1.rank(); ++k)
+        if (!contracted1[k]) indices.push_back(t1.indices()[k]);
+    for (int k = 0; k < t2.rank(); ++k)
+        if (!contracted2[k]) indices.push_back(t2.indices()[k]);
+    BlockTensor result(t1.symmetry(), std::move(indices), fuse_charges(t1.symmetry(), t1.charge(), t2.charge()));
+
+    // blocks of t2 by their sectors on the contracted indices (in pair order)
+    std::map<BlockTensor::Key, std::vector<const std::pair<const BlockTensor::Key, Tensor>*>> by_contracted;
+    for (const auto& entry : t2.blocks()) {
+        BlockTensor::Key c;
+        for (const auto& p : index_pairs) c.push_back(entry.first[p.second]);
+        by_contracted[c].push_back(&entry);
+    }
+
+    for (const auto& lhs : t1.blocks()) {
+        BlockTensor::Key c;
+        for (const auto& p : index_pairs) c.push_back(lhs.first[p.first]);
+        auto match = by_contracted.find(c);
+        if (match == by_contracted.end()) continue;
+        for (const auto* rhs : match->second) {
+            BlockTensor::Key key;
+            for (int k = 0; k < t1.rank(); ++k)
+                if (!contracted1[k]) key.push_back(lhs.first[k]);
+            for (int k = 0; k < t2.rank(); ++k)
+                if (!contracted2[k]) key.push_back(rhs->first[k]);
+            result.accumulate(key, contract_tensors(lhs.second, rhs->second, index_pairs));
+        }
+    }
+    return result;
+}
+
+BlockSvd svd(const BlockTensor& tensor, int row_rank, IndexId bond, const TruncationParams& truncation) {
+    const int rank = tensor.rank();
+    if (row_rank < 1 || row_rank >= rank) {
+        throw std::runtime_error("svd needs at least one row and one column index");
+    }
+    const Symmetry sym = tensor.symmetry();
+    const std::vector<QnIndex>& indices = tensor.indices();
+
+    // group the blocks by the fused charge of their row sectors
+    std::map<int, SvdGroup> groups;
+    for (const auto& entry : tensor.blocks()) {
+        BlockTensor::Key row(entry.first.begin(), entry.first.begin() + row_rank);
+        BlockTensor::Key col(entry.first.begin() + row_rank, entry.first.end());
+        int q = 0;
+        for (int k = 0; k < row_rank; ++k) q += indices[k].flow * indices[k].sectors[row[k]].charge;
+        SvdGroup& g = groups[normalize_charge(sym, q)];
+        if (g.row_offsets.emplace(row, g.rows).second) g.rows += block_extent(indices, row, 0);
+        if (g.col_offsets.emplace(col, g.cols).second) g.cols += block_extent(indices, col, row_rank);
+    }
+
+    // one svd per charge
+    struct Factor {
+        Eigen::MatrixXcd u;
+        Eigen::VectorXd s;
+        Eigen::MatrixXcd vh;
+    };
+    std::map<int, Factor> factors;
+    std::vector<std::pair<double, int>> spectrum;  // (value, charge)
+    for (const auto& entry : groups) {
+        const SvdGroup& g = entry.second;
+        Eigen::MatrixXcd m = Eigen::MatrixXcd::Zero(g.rows, g.cols);
+        for (const auto& blk : tensor.blocks()) {
+            BlockTensor::Key row(blk.first.begin(), blk.first.begin() + row_rank);
+            BlockTensor::Key col(blk.first.begin() + row_rank, blk.first.end());
+            auto r = g.row_offsets.find(row);
+            auto c = g.col_offsets.find(col);
+            if (r == g.row_offsets.end() || c == g.col_offsets.end()) continue;
+            Tensor::ConstMatrixView view = blk.second.matrix_view(row_rank);
+            m.block(r->second, c->second, view.rows(), view.cols()) = view;
+        }
+        Eigen::BDCSVD<Eigen::MatrixXcd> dec;
+        {
+            ScopedTimer timer(Phase::svd);
+            dec.compute(m, Eigen::ComputeThinU | Eigen::ComputeThinV);
+        }
+        Factor& f = factors[entry.first];
+        f.u = dec.matrixU();
+        f.s = dec.singularValues();
+        f.vh = dec.matrixV().adjoint();
+        for (Eigen::Index k = 0; k < f.s.size(); ++k) spectrum.emplace_back(f.s(k), entry.first);
+    }
+
+    // keep the largest singular values over all charges
+    std::stable_sort(spectrum.begin(), spectrum.end(),
+                     [](const std::pair<double, int>& a, const std::pair<double, int>& b) { return a.first > b.first; });
+    Eigen::VectorXd all(spectrum.size());
+    for (size_t k = 0; k < spectrum.size(); ++k) all(k) = spectrum[k].first;
+    BlockSvd out;
+    const int keep = spectrum.empty() ? 0 : truncation_rank(all, truncation, out.discarded);
+    std::map<int, int> kept;
+    for (int k = 0; k < keep; ++k) ++kept[spectrum[k].second];
+
+    QnIndex bond_index{bond, {}, -1};
+    for (const auto& entry : kept) bond_index.sectors.push_back({entry.first, entry.second});
+
+    std::vector<QnIndex> u_indices(indices.begin(), indices.begin() + row_rank);
+    u_indices.push_back(bond_index);
+    std::vector<QnIndex> vh_indices{bond_index.dual()};
+    vh_indices.insert(vh_indices.end(), indices.begin() + row_rank, indices.end());
+    out.u = BlockTensor(sym, std::move(u_indices), 0);
+    out.vh = BlockTensor(sym, std::move(vh_indices), tensor.charge());
+
+    int sector = 0;
+    for (const auto& entry : kept) {
+        const int q = entry.first;
+        const int n = entry.second;
+        const Factor& f = factors[q];
+        const SvdGroup& g = groups[q];
+        out.singular_values[q] = f.s.head(n);
+        for (const auto& row : g.row_offsets) {
+            BlockTensor::Key key = row.first;
+            key.push_back(sector);
+            Tensor& b = out.u.block(key);
+            b.matrix_view(row_rank) = f.u.block(row.second, 0, b.matrix_view(row_rank).rows(), n);
+        }
+        for (const auto& col : g.col_offsets) {
+            BlockTensor::Key key{sector};
+            key.insert(key.end(), col.first.begin(), col.first.end());
+            Tensor& b = out.vh.block(key);
+            b.matrix_view(1) = f.vh.block(0, col.second, n, b.matrix_view(1).cols());
+        }
+        ++sector;
+    }
+    return out;
+}
+
+} // namespace qps
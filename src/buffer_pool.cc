@@ -0,0 +1,135 @@
+#include "solver/buffer_pool.hh"
+#include "solver/profiler.hh"
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+namespace qps {
+
+namespace {
+
+std::atomic<size_t> pool_capacity{size_t(256) << 20};  // all threads together
+std::atomic<uint64_t> pool_hits{0};
+std::atomic<uint64_t> pool_misses{0};
+std::atomic<uint64_t> pool_releases{0};
+std::atomic<uint64_t> pool_dropped{0};
+std::atomic<uint64_t> pool_cached_bytes{0};
+
+// the free lists of one thread for one scalar type
+template <typename T>
+struct Cache {
+    std::unordered_map<Eigen::Index, std::vector<PoolBuffer<T>>> free;
+    size_t bytes = 0;
+
+    // tensors destroyed after the thread's cache (e.g. statics at exit)
+    // must not touch it; 0: not built yet, 1: alive, 2: destroyed
+    static thread_local int state;
+
+    Cache() { state = 1; }
+    ~Cache() {
+        clear();
+        state = 2;
+    }
+    void clear() {
+        pool_cached_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        free.clear();
+        bytes = 0;
+    }
+};
+
+template <typename T>
+thread_local int Cache<T>::state = 0;
+
+template <typename T>
+Cache<T>* local_cache() {
+    if (Cache<T>::state == 2) return nullptr;
+    thread_local Cache<T> cache;
+    return &cache;
+}
+
+} // namespace
+
+BufferPoolStats BufferPool::stats() {
+    BufferPoolStats s;
+    s.hits = pool_hits.load(std::memory_order_relaxed);
+    s.misses = pool_misses.load(std::memory_order_relaxed);
+    s.releases = pool_releases.load(std::memory_order_relaxed);
+    s.dropped = pool_dropped.load(std::memory_order_relaxed);
+    s.cached_bytes = pool_cached_bytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+void BufferPool::reset_stats() {
+    pool_hits.store(0, std::memory_order_relaxed);
+    pool_misses.store(0, std::memory_order_relaxed);
+    pool_releases.store(0, std::memory_order_relaxed);
+    pool_dropped.store(0, std::memory_order_relaxed);
+}
+
+void BufferPool::set_capacity(size_t bytes) {
+    pool_capacity.store(bytes, std::memory_order_relaxed);
+    if (bytes == 0) clear();
+}
+
+size_t BufferPool::capacity() {
+    return pool_capacity.load(std::memory_order_relaxed);
+}
+
+void BufferPool::clear() {
+    if (Cache<float>* c = local_cache<float>()) c->clear();
+    if (Cache<double>* c = local_cache<double>()) c->clear();
+    if (Cache<std::complex<float>>* c = local_cache<std::complex<float>>()) c->clear();
+    if (Cache<std::complex<double>>* c = local_cache<std::complex<double>>()) c->clear();
+}
+
+template <typename T>
+PoolBuffer<T> acquire_buffer(Eigen::Index size) {
+    if (Cache<T>* cache = local_cache<T>()) {
+        auto it = cache->free.find(size);
+        if (it != cache->free.end() && !it->second.empty()) {
+            PoolBuffer<T> buffer = std::move(it->second.back());
+            it->second.pop_back();
+            const size_t bytes = static_cast<size_t>(size) * sizeof(T);
+            cache->bytes -= bytes;
+            pool_cached_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+            pool_hits.fetch_add(1, std::memory_order_relaxed);
+            return buffer;
+        }
+    }
+    pool_misses.fetch_add(1, std::memory_order_relaxed);
+    profile::count_allocation(static_cast<uint64_t>(size) * sizeof(T));
+    return PoolBuffer<T>(size, 1);
+}
+
+template <typename T>
+void release_buffer(PoolBuffer<T>&& buffer) {
+    if (buffer.size() == 0) return;
+    // taken over here, so a buffer that is not cached is freed on return
+    PoolBuffer<T> owned = std::move(buffer);
+    Cache<T>* cache = local_cache<T>();
+    const size_t bytes = static_cast<size_t>(owned.size()) * sizeof(T);
+    // the capacity bounds all threads together, so the bytes are reserved
+    // in the shared count before the buffer is kept
+    uint64_t cached = pool_cached_bytes.load(std::memory_order_relaxed);
+    do {
+        if (!cache || cached + bytes > BufferPool::capacity()) {
+            pool_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    } while (!pool_cached_bytes.compare_exchange_weak(cached, cached + bytes, std::memory_order_relaxed));
+    owned.resize(owned.size(), 1);  // same size: keeps the allocation
+    cache->free[owned.size()].push_back(std::move(owned));
+    cache->bytes += bytes;
+    pool_releases.fetch_add(1, std::memory_order_relaxed);
+}
+
+template PoolBuffer<float> acquire_buffer<float>(Eigen::Index);
+template PoolBuffer<double> acquire_buffer<double>(Eigen::Index);
+template PoolBuffer<std::complex<float>> acquire_buffer<std::complex<float>>(Eigen::Index);
+template PoolBuffer<std::complex<double>> acquire_buffer<std::complex<double>>(Eigen::Index);
+template void release_buffer<float>(PoolBuffer<float>&&);
+template void release_buffer<double>(PoolBuffer<double>&&);
+template void release_buffer<std::complex<float>>(PoolBuffer<std::complex<float>>&&);
+template void release_buffer<std::complex<double>>(PoolBuffer<std::complex<double>>&&);
+
+} // namespace qps
@@ -0,0 +1,298 @@
+#include "solver/checkpoint.hh"
+#include "solver/profiler.hh"
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef QPS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace qps {
+
+namespace {
+
+const char kFileMagic[8] = {'Q', 'P', 'S', 'C', 'K', 'P', 'T', '\0'};
+const uint32_t kVersion = 1;
+const uint32_t kRecordMagic = 0x43455251;  // "QREC" read as little endian
+const uint64_t kAlign = 64;
+const uint64_t kFileHeaderBytes = 16;
+
+struct FixedHeader {
+    uint32_t magic;
+    uint32_t header_bytes;
+    uint64_t payload_bytes;
+    uint64_t raw_bytes;
+    int64_t step;
+    double time;
+    uint32_t dtype;
+    uint32_t compression;
+    uint32_t rank;
+    uint32_t name_len;
+    uint32_t indices_len;
+    uint32_t params_len;
+};
+static_assert(sizeof(FixedHeader) == 64, "checkpoint record header must be 64 bytes");
+
+bool little_endian() {
+    const uint32_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+std::string join_names(const std::vector<IndexId>& indices) {
+    std::string out;
+    for (size_t k = 0; k < indices.size(); ++k) {
+        if (k) out += '\n';
+        out += indices[k].name();
+    }
+    return out;
+}
+
+std::vector<std::string> split_names(const std::string& joined, size_t rank) {
+    std::vector<std::string> names;
+    if (rank == 0) return names;
+    size_t start = 0;
+    for (;;) {
+        size_t end = joined.find('\n', start);
+        names.push_back(joined.substr(start, end == std::string::npos ? std::string::npos : end - start));
+        if (end == std::string::npos) break;
+        start = end + 1;
+    }
+    return names;
+}
+
+void write_all(std::FILE* f, const void* p, size_t n) {
+    if (n && std::fwrite(p, 1, n, f) != n) {
+        throw std::runtime_error("failed to write checkpoint");
+    }
+}
+
+} // namespace
+
+CheckpointWriter::CheckpointWriter(const std::string& path, Compression compression, bool append)
+    : compression_(compression) {
+    if (!little_endian()) {
+        throw std::runtime_error("checkpoint format requires a little-endian host");
+    }
+#ifndef QPS_HAVE_ZLIB
+    if (compression == Compression::zlib) {
+        throw std::runtime_error("checkpoint compression needs zlib, which this build lacks");
+    }
+#endif
+    if (append && ::access(path.c_str(), F_OK) == 0) {
+        // drop a trailing record cut short by a crash, then continue after
+        // the last complete one
+        uint64_t end = kFileHeaderBytes;
+        {
+            // records after the last commit belong to an unfinished snapshot
+            CheckpointReader reader(path);
+            const int commit = reader.last_commit();
+            if (commit >= 0) {
+                const CheckpointRecord& last = reader.records()[commit];
+                end = last.payload_offset + last.payload_bytes;
+            } else if (!reader.records().empty()) {
+                const CheckpointRecord& last = reader.records().back();
+                end = last.payload_offset + last.payload_bytes;
+            }
+        }
+        if (::truncate(path.c_str(), static_cast<off_t>(end)) != 0 ||
+            !(file_ = std::fopen(path.c_str(), "r+b"))) {
+            throw std::runtime_error("cannot open checkpoint file '" + path + "'");
+        }
+        std::fseek(file_, 0, SEEK_END);
+        offset_ = end;
+        return;
+    }
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        throw std::runtime_error("cannot open checkpoint file '" + path + "'");
+    }
+    const uint32_t reserved = 0;
+    write_all(file_, kFileMagic, 8);
+    write_all(file_, &kVersion, 4);
+    write_all(file_, &reserved, 4);
+    offset_ = kFileHeaderBytes;
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    if (file_) std::fclose(file_);
+}
+
+void CheckpointWriter::flush() {
+    std::fflush(file_);
+}
+
+void CheckpointWriter::commit(int64_t step, double time) {
+    write(CheckpointReader::kCommitRecord, Tensor({}, {}), step, time);
+    ScopedTimer timer(Phase::io);
+    if (std::fflush(file_) != 0 || ::fsync(::fileno(file_)) != 0) {
+        throw std::runtime_error("failed to sync checkpoint");
+    }
+}
+
+void CheckpointWriter::write(const std::string& name, const Tensor& tensor, int64_t step, double time) {
+    if (tensor.is_sparse()) {
+        write(name, tensor.to_dense(), step, time);
+        return;
+    }
+    ScopedTimer timer(Phase::io);
+    const std::string indices = join_names(tensor.indices);
+    const uint64_t raw_bytes = static_cast<uint64_t>(tensor.data.size()) * sizeof(Tensor::Scalar);
+
+    const unsigned char* payload = reinterpret_cast<const unsigned char*>(tensor.data.data());
+    uint64_t payload_bytes = raw_bytes;
+    std::vector<unsigned char> compressed;
+#ifdef QPS_HAVE_ZLIB
+    if (compression_ == Compression::zlib) {
+        uLongf size = compressBound(static_cast<uLong>(raw_bytes));
+        compressed.resize(size);
+        if (compress2(compressed.data(), &size, payload, static_cast<uLong>(raw_bytes), Z_BEST_SPEED) != Z_OK) {
+            throw std::runtime_error("checkpoint compression failed");
+        }
+        payload = compressed.data();
+        payload_bytes = size;
+    }
+#endif
+
+    FixedHeader h{};
+    h.magic = kRecordMagic;
+    h.payload_bytes = payload_bytes;
+    h.raw_bytes = raw_bytes;
+    h.step = step;
+    h.time = time;
+    h.dtype = static_cast<uint32_t>(CheckpointDtype::complex128);
+    h.compression = static_cast<uint32_t>(compression_);
+    h.rank = static_cast<uint32_t>(tensor.rank());
+    h.name_len = static_cast<uint32_t>(name.size());
+    h.indices_len = static_cast<uint32_t>(indices.size());
+    h.params_len = static_cast<uint32_t>(params_.size());
+
+    // pad the header so the payload starts on an aligned file offset
+    const uint64_t unpadded = sizeof(FixedHeader) + 8 * h.rank + name.size() + indices.size() + params_.size();
+    const uint64_t payload_offset = (offset_ + unpadded + kAlign - 1) / kAlign * kAlign;
+    h.header_bytes = static_cast<uint32_t>(payload_offset - offset_);
+
+    std::vector<int64_t> dims(tensor.dimensions.begin(), tensor.dimensions.end());
+    const char zeros[kAlign] = {};
+    write_all(file_, &h, sizeof(h));
+    write_all(file_, dims.data(), dims.size() * sizeof(int64_t));
+    write_all(file_, name.data(), name.size());
+    write_all(file_, indices.data(), indices.size());
+    write_all(file_, params_.data(), params_.size());
+    write_all(file_, zeros, h.header_bytes - unpadded);
+    write_all(file_, payload, payload_bytes);
+    profile::count_written(payload_offset + payload_bytes - offset_);
+    offset_ = payload_offset + payload_bytes;
+}
+
+CheckpointReader::CheckpointReader(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open checkpoint file '" + path + "'");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(kFileHeaderBytes)) {
+        ::close(fd);
+        throw std::runtime_error("'" + path + "' is not a checkpoint file");
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // the mapping keeps the file alive
+    if (map == MAP_FAILED) {
+        throw std::runtime_error("cannot map checkpoint file '" + path + "'");
+    }
+    map_ = static_cast<const unsigned char*>(map);
+    if (std::memcmp(map_, kFileMagic, 8) != 0) {
+        ::munmap(const_cast<unsigned char*>(map_), size_);
+        throw std::runtime_error("'" + path + "' is not a checkpoint file");
+    }
+
+    // a record cut short by a crash ends the index instead of failing it
+    uint64_t offset = kFileHeaderBytes;
+    while (offset + sizeof(FixedHeader) <= size_) {
+        FixedHeader h;
+        std::memcpy(&h, map_ + offset, sizeof(h));
+        if (h.magic != kRecordMagic || offset + h.header_bytes + h.payload_bytes > size_) break;
+
+        CheckpointRecord r;
+        const unsigned char* p = map_ + offset + sizeof(FixedHeader);
+        r.dims.resize(h.rank);
+        std::memcpy(r.dims.data(), p, 8 * h.rank);
+        p += 8 * h.rank;
+        r.name.assign(reinterpret_cast<const char*>(p), h.name_len);
+        p += h.name_len;
+        r.index_names = split_names(std::string(reinterpret_cast<const char*>(p), h.indices_len), h.rank);
+        p += h.indices_len;
+        r.params.assign(reinterpret_cast<const char*>(p), h.params_len);
+        r.step = h.step;
+        r.time = h.time;
+        r.dtype = static_cast<CheckpointDtype>(h.dtype);
+        r.compression = static_cast<Compression>(h.compression);
+        r.payload_offset = offset + h.header_bytes;
+        r.payload_bytes = h.payload_bytes;
+        r.raw_bytes = h.raw_bytes;
+        records_.push_back(std::move(r));
+        offset += h.header_bytes + h.payload_bytes;
+    }
+}
+
+CheckpointReader::~CheckpointReader() {
+    if (map_) ::munmap(const_cast<unsigned char*>(map_), size_);
+}
+
+int CheckpointReader::find(const std::string& name, int64_t step) const {
+    for (int i = static_cast<int>(records_.size()) - 1; i >= 0; --i) {
+        if (records_[i].name == name && (step < 0 || records_[i].step == step)) return i;
+    }
+    return -1;
+}
+
+const std::complex<double>* CheckpointReader::data(const CheckpointRecord& record) const {
+    if (record.compression != Compression::none) {
+        throw std::runtime_error("compressed checkpoint records have no zero-copy view");
+    }
+    return reinterpret_cast<const std::complex<double>*>(map_ + record.payload_offset);
+}
+
+Tensor CheckpointReader::read(const CheckpointRecord& record) const {
+    std::vector<int> dims(record.dims.begin(), record.dims.end());
+    Tensor t(dims, record.index_names);
+    if (record.raw_bytes != static_cast<uint64_t>(t.data.size()) * sizeof(Tensor::Scalar)) {
+        throw std::runtime_error("checkpoint record '" + record.name + "' has a corrupt size");
+    }
+    const unsigned char* payload = map_ + record.payload_offset;
+    if (record.compression == Compression::none) {
+        std::memcpy(t.data.data(), payload, record.raw_bytes);
+        return t;
+    }
+#ifdef QPS_HAVE_ZLIB
+    uLongf size = static_cast<uLongf>(record.raw_bytes);
+    if (uncompress(reinterpret_cast<Bytef*>(t.data.data()), &size, payload,
+                   static_cast<uLong>(record.payload_bytes)) != Z_OK || size != record.raw_bytes) {
+        throw std::runtime_error("checkpoint record '" + record.name + "' failed to decompress");
+    }
+    return t;
+#else
+    throw std::runtime_error("checkpoint compression needs zlib, which this build lacks");
+#endif
+}
+
+CheckpointSchedule::CheckpointSchedule(const CheckpointPolicy& policy)
+    : policy_(policy), last_(std::chrono::steady_clock::now()) {}
+
+bool CheckpointSchedule::due(int step, bool last) {
+    const auto now = std::chrono::steady_clock::now();
+    bool due = last || (policy_.every_steps > 0 && (step + 1) % policy_.every_steps == 0);
+    if (policy_.every_seconds > 0.0 &&
+        std::chrono::duration<double>(now - last_).count() >= policy_.every_seconds) {
+        due = true;
+    }
+    if (due) last_ = now;
+    return due;
+}
+
+} // namespace qps
@@ -0,0 +1,230 @@
+#include "solver/tensor.hh"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+namespace qps {
+
+namespace {
+
+// the network as a graph: every distinct index is an edge with a dimension,
+// and each node carries the sorted list of edges it touches
+struct PathProblem {
+    std::vector<double> edge_dims;
+    std::vector<std::vector<int>> legs;
+};
+
+PathProblem build_problem(const std::vector<TensorShape>& inputs,
+                          const std::vector<IndexId>& output) {
+    PathProblem problem;
+    std::unordered_map<IndexId, int> edge_of;
+    std::vector<int> endpoints;
+    for (const auto& shape : inputs) {
+        if (shape.indices.size() != shape.dimensions.size()) {
+            throw std::runtime_error("number of dimensions must match number of indices");
+        }
+        std::vector<int> legs;
+        for (size_t k = 0; k < shape.indices.size(); ++k) {
+            auto it = edge_of.find(shape.indices[k]);
+            int e;
+            if (it == edge_of.end()) {
+                e = static_cast<int>(problem.edge_dims.size());
+                edge_of.emplace(shape.indices[k], e);
+                problem.edge_dims.push_back(shape.dimensions[k]);
+                endpoints.push_back(0);
+            } else {
+                e = it->second;
+                if (problem.edge_dims[e] != shape.dimensions[k]) {
+                    throw std::runtime_error("dimension mismatch in contraction for index '" +
+                                           shape.indices[k].name() + "'");
+                }
+            }
+            ++endpoints[e];
+            legs.push_back(e);
+        }
+        std::sort(legs.begin(), legs.end());
+        if (std::adjacent_find(legs.begin(), legs.end()) != legs.end()) {
+            throw std::runtime_error("repeated index within one tensor");
+        }
+        problem.legs.push_back(legs);
+    }
+
+    // output indices are open edges: one endpoint, never summed
+    std::vector<bool> is_output(endpoints.size(), false);
+    for (IndexId idx : output) {
+        auto it = edge_of.find(idx);
+        if (it == edge_of.end()) {
+            throw std::runtime_error("output index '" + idx.name() + "' not found in the network");
+        }
+        if (is_output[it->second]) {
+            throw std::runtime_error("output index '" + idx.name() + "' listed twice");
+        }
+        is_output[it->second] = true;
+    }
+    for (const auto& entry : edge_of) {
+        const int e = entry.second;
+        if (is_output[e] ? endpoints[e] != 1 : endpoints[e] != 2) {
+            throw std::runtime_error("index '" + entry.first.name() +
+                                   "' must appear in two tensors, or in one and the output");
+        }
+    }
+    return problem;
+}
+
+// legs of a merged node: shared edges are summed, the rest stay open
+std::vector<int> merged_legs(const std::vector<int>& a, const std::vector<int>& b) {
+    std::vector<int> out;
+    std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+    return out;
+}
+
+double legs_size(const std::vector<int>& legs, const std::vector<double>& dims) {
+    double size = 1.0;
+    for (int e : legs) size *= dims[e];
+    return size;
+}
+
+// multiply-adds of a pairwise contraction: product over every edge involved
+double pair_flops(const std::vector<int>& a, const std::vector<int>& b,
+                  const std::vector<double>& dims) {
+    std::vector<int> all;
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(all));
+    return legs_size(all, dims);
+}
+
+ContractionPlan greedy_plan(const PathProblem& problem) {
+    ContractionPlan plan;
+    const int n = static_cast<int>(problem.legs.size());
+    std::vector<int> ids(n);
+    std::vector<std::vector<int>> legs = problem.legs;
+    for (int i = 0; i < n; ++i) ids[i] = i;
+    int next_id = n;
+
+    while (ids.size() > 1) {
+        // prefer connected pairs; among them the one that shrinks the
+        // network most, then the cheaper one. with no connected pair left,
+        // take the outer product of the two smallest tensors
+        int best_i = -1, best_j = -1;
+        bool best_connected = false;
+        double best_score = 0.0, best_flops = 0.0;
+        for (size_t i = 0; i < ids.size(); ++i) {
+            for (size_t j = i + 1; j < ids.size(); ++j) {
+                std::vector<int> out = merged_legs(legs[i], legs[j]);
+                const bool connected = out.size() < legs[i].size() + legs[j].size();
+                const double si = legs_size(legs[i], problem.edge_dims);
+                const double sj = legs_size(legs[j], problem.edge_dims);
+                const double score = connected ? legs_size(out, problem.edge_dims) - si - sj
+                                               : si + sj;
+                const double flops = pair_flops(legs[i], legs[j], problem.edge_dims);
+                bool better = best_i < 0 || (connected && !best_connected) ||
+                              (connected == best_connected &&
+                               (score < best_score || (score == best_score && flops < best_flops)));
+                if (better) {
+                    best_i = static_cast<int>(i);
+                    best_j = static_cast<int>(j);
+                    best_connected = connected;
+                    best_score = score;
+                    best_flops = flops;
+                }
+            }
+        }
+
+        std::vector<int> out = merged_legs(legs[best_i], legs[best_j]);
+        plan.flops += best_flops;
+        plan.peak_elements = std::max(plan.peak_elements, legs_size(out, problem.edge_dims));
+        plan.steps.push_back({ids[best_i], ids[best_j]});
+
+        // best_j > best_i, so erasing j first keeps i valid
+        ids.erase(ids.begin() + best_j);
+        legs.erase(legs.begin() + best_j);
+        ids[best_i] = next_id++;
+        legs[best_i] = std::move(out);
+    }
+    return plan;
+}
+
+// optimal order by dynamic programming over subsets of the inputs.
+// legs are 64-bit edge masks; the open legs of a subset are the xor of its
+// members' legs because every summed edge has exactly two endpoints
+ContractionPlan exhaustive_plan(const PathProblem& problem) {
+    const int n = static_cast<int>(problem.legs.size());
+    const uint32_t full = (1u << n) - 1;
+    const double inf = std::numeric_limits<double>::infinity();
+
+    std::vector<uint64_t> legs(full + 1, 0);
+    for (uint32_t s = 1; s <= full; ++s) {
+        int low = __builtin_ctz(s);
+        uint64_t own = 0;
+        for (int e : problem.legs[low]) own |= uint64_t(1) << e;
+        legs[s] = legs[s & (s - 1)] ^ own;
+    }
+    auto mask_size = [&](uint64_t mask) {
+        double size = 1.0;
+        for (; mask; mask &= mask - 1) size *= problem.edge_dims[__builtin_ctzll(mask)];
+        return size;
+    };
+
+    std::vector<double> cost(full + 1, inf), flops(full + 1, 0.0), peak(full + 1, 0.0);
+    std::vector<uint32_t> split(full + 1, 0);
+    for (int i = 0; i < n; ++i) cost[1u << i] = 0.0;
+
+    for (uint32_t s = 1; s <= full; ++s) {
+        if ((s & (s - 1)) == 0) continue;
+        const double out_size = mask_size(legs[s]);
+        // enumerate each unordered split once: the part holding the lowest bit
+        const uint32_t low = s & (~s + 1);
+        for (uint32_t a = (s - 1) & s; a; a = (a - 1) & s) {
+            if (!(a & low)) continue;
+            const uint32_t b = s ^ a;
+            if (cost[a] == inf || cost[b] == inf) continue;
+            const double step = mask_size(legs[a] | legs[b]);
+            const double c = cost[a] + cost[b] + step + out_size;
+            if (c < cost[s]) {
+                cost[s] = c;
+                split[s] = a;
+                flops[s] = flops[a] + flops[b] + step;
+                peak[s] = std::max({peak[a], peak[b], out_size});
+            }
+        }
+    }
+
+    // replay the split tree bottom-up to number the intermediates
+    ContractionPlan plan;
+    plan.flops = flops[full];
+    plan.peak_elements = peak[full];
+    int next_id = n;
+    auto emit = [&](auto&& self, uint32_t s) -> int {
+        if ((s & (s - 1)) == 0) return __builtin_ctz(s);
+        const int lhs = self(self, split[s]);
+        const int rhs = self(self, s ^ split[s]);
+        plan.steps.push_back({lhs, rhs});
+        return next_id++;
+    };
+    emit(emit, full);
+    return plan;
+}
+
+} // namespace
+
+ContractionPlan plan_contraction(const std::vector<TensorShape>& inputs,
+                                 const std::vector<IndexId>& output,
+                                 PathMethod method) {
+    if (inputs.empty()) {
+        throw std::runtime_error("contraction needs at least one tensor");
+    }
+    PathProblem problem = build_problem(inputs, output);
+
+    const int n = static_cast<int>(inputs.size());
+    const bool fits_masks = problem.edge_dims.size() <= 64 && n <= 16;
+    if (method == PathMethod::exhaustive && !fits_masks) {
+        throw std::runtime_error("network too large for exhaustive path search");
+    }
+    if (method == PathMethod::exhaustive || (method == PathMethod::automatic && n <= 8 && fits_masks)) {
+        return n == 1 ? ContractionPlan() : exhaustive_plan(problem);
+    }
+    return greedy_plan(problem);
+}
+
+} // namespace qps
@@ -0,0 +1,78 @@
+#include "solver/ensemble.hh"
+#include "solver/execution.hh"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace qps {
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+EnsembleRunner::EnsembleRunner(SolverFactory factory, size_t num_threads)
+    : factory_(std::move(factory)), pool_(num_threads) {
+    if (!factory_) {
+        throw std::runtime_error("ensemble runner needs a solver factory");
+    }
+}
+
+std::vector<EnsembleResult> EnsembleRunner::run(const std::vector<EnsembleJob>& jobs) {
+    std::vector<EnsembleResult> results(jobs.size());
+    const size_t steals_before = pool_.steals();
+    const auto start = std::chrono::steady_clock::now();
+    // one job per worker; threaded BLAS inside the jobs would oversubscribe
+    BlasThreads blas(1);
+
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        pool_.submit([this, &jobs, &results, j] {
+            EnsembleResult& result = results[j];
+            result.job = j;
+            result.worker = ThreadPool::current_worker();
+            const auto job_start = std::chrono::steady_clock::now();
+            try {
+                std::unique_ptr<Solver> solver = factory_(jobs[j].params);
+                if (!solver) throw std::runtime_error("solver factory returned no solver");
+                solver->set_propagator_cache(*propagators_);
+                solver->initialize_state(jobs[j].initial_state);
+                solver->build_network(jobs[j].params);
+                result.value = solver->compute_quantity_of_interest();
+            } catch (const std::exception& e) {
+                result.error = e.what();
+            }
+            result.seconds = seconds_since(job_start);
+        });
+    }
+    pool_.wait();
+
+    summary_ = EnsembleSummary();
+    summary_.jobs = jobs.size();
+    summary_.wall_seconds = seconds_since(start);
+    summary_.steals = pool_.steals() - steals_before;
+    double sum = 0.0, sum_sq = 0.0;
+    size_t ok = 0;
+    for (const auto& r : results) {
+        summary_.job_seconds += r.seconds;
+        if (!r.ok()) {
+            ++summary_.failed;
+            continue;
+        }
+        summary_.min = ok ? std::min(summary_.min, r.value) : r.value;
+        summary_.max = ok ? std::max(summary_.max, r.value) : r.value;
+        sum += r.value;
+        sum_sq += r.value * r.value;
+        ++ok;
+    }
+    if (ok) {
+        summary_.mean = sum / ok;
+        summary_.stddev = std::sqrt(std::max(0.0, sum_sq / ok - summary_.mean * summary_.mean));
+    }
+    return results;
+}
+
+} // namespace qps
@@ -0,0 +1,76 @@
+#include "solver/execution.hh"
+#include "solver/thread_pool.hh"
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+// from OpenBLAS, which libqps always links
+extern "C" {
+void openblas_set_num_threads(int num_threads);
+int openblas_get_num_threads(void);
+}
+
+namespace qps {
+
+ExecutionContext::ExecutionContext(const ExecutionConfig& config) : config_(config) {
+    if (config_.num_threads == 0) {
+        config_.num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (config_.num_threads > 1) pool_ = std::make_unique<ThreadPool>(config_.num_threads);
+}
+
+ExecutionContext::~ExecutionContext() = default;
+
+const ExecutionContext& ExecutionContext::serial() {
+    static const ExecutionContext context;
+    return context;
+}
+
+namespace {
+
+// open BlasThreads scopes and the setting from before the first of them
+struct BlasScopes {
+    std::mutex mutex;
+    int open = 0;
+    int original = 1;
+};
+
+BlasScopes& blas_scopes() {
+    static BlasScopes scopes;
+    return scopes;
+}
+
+} // namespace
+
+BlasThreads::BlasThreads(int num_threads) {
+    BlasScopes& scopes = blas_scopes();
+    std::lock_guard<std::mutex> lock(scopes.mutex);
+    const int current = get();
+    if (scopes.open++ == 0) scopes.original = current;
+    if (num_threads != current) set(num_threads);
+}
+
+BlasThreads::~BlasThreads() {
+    BlasScopes& scopes = blas_scopes();
+    std::lock_guard<std::mutex> lock(scopes.mutex);
+    if (--scopes.open == 0 && get() != scopes.original) set(scopes.original);
+}
+
+ExecutionScope::ExecutionScope(const ExecutionContext& ctx) {
+    if (ctx.num_threads() > 1) {
+        const bool on_worker = ThreadPool::current_worker() >= 0;
+        blas_ = std::make_unique<BlasThreads>(on_worker ? 1 : static_cast<int>(ctx.num_threads()));
+    }
+}
+
+ExecutionScope::~ExecutionScope() = default;
+
+int BlasThreads::get() {
+    return openblas_get_num_threads();
+}
+
+void BlasThreads::set(int num_threads) {
+    openblas_set_num_threads(std::max(1, num_threads));
+}
+
+} // namespace qps
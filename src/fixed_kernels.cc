@@ -0,0 +1,110 @@
+#include "solver/fixed_kernels.hh"
+#include <unsupported/Eigen/MatrixFunctions>
+#include <complex>
+#include <stdexcept>
+
+namespace qps {
+
+namespace {
+
+using Complex = std::complex<double>;
+
+// x_(l, :, r) = g x_(l, :, r) for every bond pair (l, r) of a (dl, D, dr)
+// block; the physical index runs with stride dl
+template <int D>
+void apply_rows(const Eigen::Matrix<Complex, D, D>& g, Complex* data, Eigen::Index dl, Eigen::Index dr) {
+    using Column = Eigen::Matrix<Complex, D, 1>;
+    using Strided = Eigen::Map<Column, 0, Eigen::InnerStride<>>;
+    for (Eigen::Index r = 0; r < dr; ++r) {
+        Complex* block = data + r * dl * D;
+        for (Eigen::Index l = 0; l < dl; ++l) {
+            Strided x(block + l, Eigen::InnerStride<>(dl));
+            const Column y = g * x;
+            x = y;
+        }
+    }
+}
+
+// a one-site gate when d1 == 0; otherwise a two-site gate in kronecker order
+// s1 * d2 + s2, permuted to the block's order s1 + d1 s2 in a fixed-size
+// matrix, so neither case touches the heap
+template <int D>
+void apply_fixed(const Eigen::MatrixXcd& gate, int d1, Complex* data, Eigen::Index dl, Eigen::Index dr) {
+    Eigen::Matrix<Complex, D, D> g;
+    if (d1 == 0) {
+        g = gate;
+    } else {
+        const int d2 = D / d1;
+        for (int a1 = 0; a1 < d1; ++a1)
+            for (int a2 = 0; a2 < d2; ++a2)
+                for (int b1 = 0; b1 < d1; ++b1)
+                    for (int b2 = 0; b2 < d2; ++b2)
+                        g(a1 + d1 * a2, b1 + d1 * b2) = gate(a1 * d2 + a2, b1 * d2 + b2);
+    }
+    apply_rows<D>(g, data, dl, dr);
+}
+
+bool dispatch(const Eigen::MatrixXcd& gate, int d1, Complex* data, Eigen::Index dl, Eigen::Index dr) {
+    switch (gate.rows()) {
+        case 2: apply_fixed<2>(gate, d1, data, dl, dr); return true;
+        case 3: apply_fixed<3>(gate, d1, data, dl, dr); return true;
+        case 4: apply_fixed<4>(gate, d1, data, dl, dr); return true;
+        case 6: apply_fixed<6>(gate, d1, data, dl, dr); return true;
+        case 9: apply_fixed<9>(gate, d1, data, dl, dr); return true;
+        default: return false;
+    }
+}
+
+// a = m 1 + b with b traceless, so b^2 = delta^2 1 and
+// exp(a) = e^m (cosh(delta) 1 + sinh(delta) / delta b)
+Eigen::Matrix2cd expm2(const Eigen::Matrix2cd& a) {
+    const Complex m = 0.5 * (a(0, 0) + a(1, 1));
+    Eigen::Matrix2cd b = a;
+    b.diagonal().array() -= m;
+    const Complex delta = std::sqrt(b(0, 0) * b(0, 0) + b(0, 1) * b(1, 0));
+    const Complex delta2 = delta * delta;
+    const Complex sinhc = std::abs(delta) < 1e-4 ? 1.0 + delta2 / 6.0 + delta2 * delta2 / 120.0
+                                                 : std::sinh(delta) / delta;
+    return std::exp(m) * (std::cosh(delta) * Eigen::Matrix2cd::Identity() + sinhc * b);
+}
+
+template <int D>
+Eigen::MatrixXcd expm_fixed(const Eigen::MatrixXcd& a) {
+    const Eigen::Matrix<Complex, D, D> f = a;
+    return Eigen::Matrix<Complex, D, D>(f.exp());
+}
+
+} // namespace
+
+bool has_fixed_gate_kernel(int dim) {
+    return dim == 2 || dim == 3 || dim == 4 || dim == 6 || dim == 9;
+}
+
+Eigen::MatrixXcd matrix_exponential(const Eigen::MatrixXcd& a) {
+    if (a.rows() != a.cols()) {
+        throw std::runtime_error("matrix exponential needs a square matrix");
+    }
+    switch (a.rows()) {
+        case 2: return expm2(a);
+        case 3: return expm_fixed<3>(a);
+        case 4: return expm_fixed<4>(a);
+        case 6: return expm_fixed<6>(a);
+        case 9: return expm_fixed<9>(a);
+        default: return a.exp();
+    }
+}
+
+bool apply_fixed_gate(const Eigen::MatrixXcd& gate, Tensor& t) {
+    if (t.is_sparse() || !has_fixed_gate_kernel(static_cast<int>(gate.rows()))) return false;
+    if (t.rank() == 3) {
+        if (gate.rows() != t.dimensions[1] || gate.cols() != t.dimensions[1]) return false;
+        return dispatch(gate, 0, t.data.data(), t.dimensions[0], t.dimensions[2]);
+    }
+    if (t.rank() != 4) return false;
+    const int d1 = t.dimensions[1], d2 = t.dimensions[2];
+    const Eigen::Index dd = static_cast<Eigen::Index>(d1) * d2;
+    if (gate.rows() != dd || gate.cols() != dd) return false;
+    return dispatch(gate, d1, t.data.data(), t.dimensions[0], t.dimensions[3]);
+}
+
+} // namespace qps
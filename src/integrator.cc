@@ -0,0 +1,85 @@
+#include "solver/integrator.hh"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace qps {
+
+namespace {
+
+// a symmetric composition of strang steps S(c_1 h) ... S(c_m h), each of
+// which is a forward and a backward sweep of c_j h / 2
+std::vector<double> strang_composition(const std::vector<double>& c) {
+    std::vector<double> weights;
+    for (double cj : c) {
+        weights.push_back(cj / 2.0);
+        weights.push_back(cj / 2.0);
+    }
+    return weights;
+}
+
+} // namespace
+
+const char* integrator_name(Integrator integrator) {
+    switch (integrator) {
+        case Integrator::second_order: return "second_order";
+        case Integrator::forest_ruth: return "forest_ruth";
+        case Integrator::suzuki: return "suzuki";
+        case Integrator::omelyan: return "omelyan";
+    }
+    return "unknown";
+}
+
+int integrator_order(Integrator integrator) {
+    return integrator == Integrator::second_order ? 2 : 4;
+}
+
+std::vector<double> sweep_weights(Integrator integrator) {
+    switch (integrator) {
+        case Integrator::second_order:
+            return {0.5, 0.5};
+        case Integrator::forest_ruth: {
+            const double theta = 1.0 / (2.0 - std::cbrt(2.0));
+            return strang_composition({theta, 1.0 - 2.0 * theta, theta});
+        }
+        case Integrator::suzuki: {
+            const double p = 1.0 / (4.0 - std::cbrt(4.0));
+            return strang_composition({p, p, 1.0 - 4.0 * p, p, p});
+        }
+        case Integrator::omelyan: {
+            // the splitting e^{xi A} e^{(1-2 lambda)/2 B} e^{chi A} e^{lambda B}
+            // e^{(1-2(chi+xi)) A} e^{lambda B} e^{chi A} e^{(1-2 lambda)/2 B} e^{xi A}
+            // (Omelyan, Mryglod, Folk, Comput. Phys. Commun. 146 (2002) 188),
+            // rewritten as F(a1) B(b1) ... F(a4) B(b4): consecutive sweeps
+            // share their end term, so A and B stages are sums of neighbours
+            const double xi = 0.1786178958448091;
+            const double lambda = -0.2123418310626054;
+            const double chi = -0.06626458266981849;
+            const double b_outer = (1.0 - 2.0 * lambda) / 2.0;
+            std::vector<double> w(8);
+            w[0] = xi;
+            w[1] = b_outer - w[0];
+            w[2] = chi - w[1];
+            w[3] = lambda - w[2];
+            w[4] = 1.0 - 2.0 * (chi + xi) - w[3];
+            w[5] = lambda - w[4];
+            w[6] = chi - w[5];
+            w[7] = b_outer - w[6];
+            return w;
+        }
+    }
+    throw std::runtime_error("unknown integrator");
+}
+
+double adapt_step(const AdaptiveParams& params, int order, double h, double error) {
+    double factor = params.max_factor;
+    if (error > 0.0) {
+        factor = params.safety * std::pow(params.tolerance / error, 1.0 / (order + 1));
+    }
+    factor = std::clamp(factor, params.min_factor, params.max_factor);
+    double next = h * factor;
+    if (params.max_step > 0.0) next = std::min(next, params.max_step);
+    return std::max(next, params.min_step);
+}
+
+} // namespace qps
@@ -0,0 +1,180 @@
+#include "solver/krylov.hh"
+#include "solver/profiler.hh"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace qps {
+
+namespace {
+
+// one lanczos attempt for exp(scale * H) v. returns false if the error
+// estimate is still above the tolerance at max_dim
+bool lanczos_step(const LinearMap& H, std::complex<double> scale, const Eigen::MatrixXcd& v,
+                  const KrylovParams& params, Eigen::MatrixXcd& result, int& dim_used,
+                  double& error_estimate) {
+    const double beta0 = v.norm();
+    if (beta0 == 0.0) {
+        result = v;
+        dim_used = 0;
+        error_estimate = 0.0;
+        return true;
+    }
+
+    const int max_dim = std::max(1, params.max_dim);
+    std::vector<Eigen::MatrixXcd> basis;
+    basis.reserve(max_dim + 1);
+    basis.push_back(v / beta0);
+    std::vector<double> alpha, beta;
+    Eigen::MatrixXcd w;
+    Eigen::VectorXcd coeffs;
+
+    for (int j = 0; j < max_dim; ++j) {
+        H(basis[j], w);
+        // hermitian H gives a real tridiagonal projection
+        const double a = basis[j].conjugate().cwiseProduct(w).sum().real();
+        alpha.push_back(a);
+        w -= a * basis[j];
+        if (j > 0) w -= beta[j - 1] * basis[j - 1];
+        // full reorthogonalization; the spaces are small
+        for (const auto& q : basis) w -= q.conjugate().cwiseProduct(w).sum() * q;
+        const double b = w.norm();
+
+        // exp(scale * T) e_1 through the eigendecomposition of T
+        const int m = j + 1;
+        Eigen::MatrixXd T = Eigen::MatrixXd::Zero(m, m);
+        for (int k = 0; k < m; ++k) T(k, k) = alpha[k];
+        for (int k = 0; k + 1 < m; ++k) T(k, k + 1) = T(k + 1, k) = beta[k];
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(T);
+        const Eigen::MatrixXd& Q = eig.eigenvectors();
+        Eigen::VectorXcd phase = (scale * eig.eigenvalues().cast<std::complex<double>>()).array().exp();
+        coeffs = Q.cast<std::complex<double>>() * phase.cwiseProduct(Q.row(0).transpose().cast<std::complex<double>>());
+
+        // the residual of the projected exponential is |b * e_m^T exp(scale T) e_1|
+        const double breakdown = 1e-14 * std::max(1.0, std::abs(a));
+        error_estimate = b * std::abs(coeffs(m - 1));
+        dim_used = m;
+        if (b < breakdown || error_estimate <= params.tolerance) {
+            result = Eigen::MatrixXcd::Zero(v.rows(), v.cols());
+            for (int k = 0; k < m; ++k) result += (beta0 * coeffs(k)) * basis[k];
+            return true;
+        }
+        beta.push_back(b);
+        basis.push_back(w / b);
+    }
+    return false;
+}
+
+} // namespace
+
+Eigen::MatrixXcd expmv(const LinearMap& H, std::complex<double> scale,
+                       const Eigen::Ref<const Eigen::MatrixXcd>& v,
+                       const KrylovParams& params, KrylovStats* stats) {
+    ScopedTimer timer(Phase::krylov);
+    Eigen::MatrixXcd x = v;
+    double remaining = 1.0;
+    double fraction = 1.0;
+    int substeps = 0;
+    while (remaining > 0.0) {
+        // the last substep takes exactly what is left, so rounding in the
+        // running sum never adds a spurious tiny step
+        const double step = (fraction >= remaining * (1.0 - 1e-12)) ? remaining : fraction;
+        Eigen::MatrixXcd next;
+        int dim = 0;
+        double err = 0.0;
+        if (lanczos_step(H, step * scale, x, params, next, dim, err)) {
+            x = std::move(next);
+            remaining = (step == remaining) ? 0.0 : remaining - step;
+            ++substeps;
+            if (stats) {
+                stats->max_dim_used = std::max(stats->max_dim_used, dim);
+                stats->max_error_estimate = std::max(stats->max_error_estimate, err);
+            }
+        } else {
+            fraction = step / 2.0;
+            if (fraction < 1e-10) {
+                throw std::runtime_error("krylov expmv did not converge; increase max_dim");
+            }
+        }
+    }
+    if (stats) {
+        ++stats->calls;
+        stats->substeps += substeps;
+    }
+    return x;
+}
+
+Eigen::MatrixXcd expmv(const Eigen::MatrixXcd& H, std::complex<double> scale,
+                       const Eigen::Ref<const Eigen::MatrixXcd>& v,
+                       const KrylovParams& params, KrylovStats* stats) {
+    if (H.rows() != H.cols() || H.cols() != v.rows()) {
+        throw std::runtime_error("expmv operator does not match the vector");
+    }
+    return expmv([&H](const Eigen::MatrixXcd& x, Eigen::MatrixXcd& y) { y.noalias() = H * x; },
+                 scale, v, params, stats);
+}
+
+double lowest_eigenpair(const LinearMap& H, Eigen::MatrixXcd& v,
+                        const KrylovParams& params, KrylovStats* stats, int max_restarts) {
+    ScopedTimer timer(Phase::krylov);
+    const int max_dim = std::max(2, params.max_dim);
+    double energy = 0.0;
+    double residual = 0.0;
+    int substeps = 0;
+    for (int restart = 0; restart <= max_restarts; ++restart) {
+        const double beta0 = v.norm();
+        if (beta0 == 0.0) {
+            throw std::runtime_error("lanczos needs a nonzero start vector");
+        }
+        std::vector<Eigen::MatrixXcd> basis;
+        basis.reserve(max_dim);
+        basis.push_back(v / beta0);
+        std::vector<double> alpha, beta;
+        Eigen::MatrixXcd w;
+        Eigen::VectorXd ritz;
+        bool converged = false;
+
+        for (int j = 0; j < max_dim; ++j) {
+            H(basis[j], w);
+            const double a = basis[j].conjugate().cwiseProduct(w).sum().real();
+            alpha.push_back(a);
+            w -= a * basis[j];
+            if (j > 0) w -= beta[j - 1] * basis[j - 1];
+            for (const auto& q : basis) w -= q.conjugate().cwiseProduct(w).sum() * q;
+            const double b = w.norm();
+
+            const int m = j + 1;
+            Eigen::MatrixXd T = Eigen::MatrixXd::Zero(m, m);
+            for (int k = 0; k < m; ++k) T(k, k) = alpha[k];
+            for (int k = 0; k + 1 < m; ++k) T(k, k + 1) = T(k + 1, k) = beta[k];
+            Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(T);
+            energy = eig.eigenvalues()(0);
+            ritz = eig.eigenvectors().col(0);
+            // |H v - e v| of the ritz vector is |b * last component|
+            residual = b * std::abs(ritz(m - 1));
+            if (b < 1e-14 * std::max(1.0, std::abs(a)) || residual <= params.tolerance) {
+                converged = true;
+                break;
+            }
+            if (m == max_dim) break;
+            beta.push_back(b);
+            basis.push_back(w / b);
+        }
+
+        Eigen::MatrixXcd x = Eigen::MatrixXcd::Zero(v.rows(), v.cols());
+        for (Eigen::Index k = 0; k < ritz.size(); ++k) x += ritz(k) * basis[k];
+        v = x / x.norm();
+        ++substeps;
+        if (stats) stats->max_dim_used = std::max(stats->max_dim_used, static_cast<int>(ritz.size()));
+        if (converged) break;
+    }
+    if (stats) {
+        ++stats->calls;
+        stats->substeps += substeps;
+        stats->max_error_estimate = std::max(stats->max_error_estimate, residual);
+    }
+    return energy;
+}
+
+} // namespace qps
@@ -3,27 +3,38 @@
 #include <iostream>
 
 int main() {
-    // Simple 2x2 hamiltonian (single qubit)
-    Eigen::Matrix2d H;
-    H << 1, 0,
+    // transverse-field ising chain: H = -sum Z_i Z_{i+1} + g sum X_i
+    const int n_sites = 4;
+    const double g = 0.5;
+
+    Eigen::Matrix2d X, Z;
+    X << 0, 1,
+         1, 0;
+    Z << 1, 0,
          0, -1;
+    Eigen::Matrix4d ZZ;
+    ZZ << -1, 0, 0, 0,
+          0, 1, 0, 0,
+          0, 0, 1, 0,
+          0, 0, 0, -1;
 
-    // initial state |0⟩
-    Eigen::Vector2d psi0;
-    psi0 << 1, 0;
+    std::vector<qps::Tensor> onsite(n_sites, qps::Tensor::from_matrix(Eigen::Matrix2d(g * X)));
+    std::vector<qps::Tensor> bonds(n_sites - 1, qps::Tensor::from_matrix(ZZ));
 
-    // use density matrix as initial state
-    Eigen::Matrix2d rho0 = psi0 * psi0.transpose();
-    qps::Tensor H_tensor = qps::Tensor::from_matrix(H, {"site_0", "site_0"});
-    qps::Tensor rho0_tensor = qps::Tensor::from_matrix(rho0, {"site_0", "site_0"});
+    // initial state |0000⟩
+    Eigen::Vector2d up;
+    up << 1, 0;
+    std::vector<Eigen::VectorXcd> sites(n_sites, up.cast<std::complex<double>>());
 
-    qps::TimeEvolutionSolver solver(1.0, 10, {H_tensor});
+    qps::TimeEvolutionSolver solver(1.0, 10, onsite);
+    solver.set_bond_operators(bonds);
     solver.set_checkpoint_dir("checkpoints");
-    solver.initialize_state(rho0_tensor);
+    solver.initialize_state(qps::MatrixProductState::product_state(sites));
     solver.build_network({});
 
     double norm = solver.compute_quantity_of_interest();
     std::cout << "Final state norm: " << norm << std::endl;
+    std::cout << "Final energy: " << solver.energy() << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,123 @@
+#include "solver/metrics.hh"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+namespace qps {
+
+MetricsSink::MetricsSink(const std::string& dir, const std::string& params_json,
+                         const MetricsConfig& config)
+    : config_(config), queue_(config.queue_capacity) {
+    if (config_.sample_every < 1) {
+        throw std::runtime_error("metrics sampling interval must be at least 1");
+    }
+    config_.verbosity = static_cast<Verbosity>(
+        std::min(static_cast<int>(config_.verbosity), QPS_MAX_VERBOSITY));
+
+    // headers are written once up front, before the hot loop starts
+    log_.open(dir + "/debug.log");
+    log_ << "# Debug log for time evolution\n";
+    log_ << "# Format: [step] [gate] [sites] [bond_dim] [discarded_weight]\n\n";
+
+    json_.open(dir + "/solver_data.json");
+    json_ << "{\n";
+    json_ << "  \"time_evolution\": {\n";
+    json_ << "    \"parameters\": {\n";
+    json_ << params_json;
+    json_ << "    },\n";
+    json_ << "    \"steps\": [\n";
+
+    writer_ = std::thread(&MetricsSink::run, this);
+}
+
+MetricsSink::~MetricsSink() {
+    close();
+}
+
+void MetricsSink::push(const MetricRecord& record) {
+    if (queue_.try_push(record)) return;
+    if (config_.backpressure == Backpressure::drop) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    while (!queue_.try_push(record)) std::this_thread::yield();
+}
+
+void MetricsSink::close() {
+    if (closed_) return;
+    closed_ = true;
+    done_.store(true, std::memory_order_release);
+    writer_.join();
+
+    json_ << "\n    ],\n";
+    json_ << "    \"dropped_records\": " << dropped() << "\n";
+    json_ << "  }\n";
+    json_ << "}\n";
+    json_.close();
+    log_.close();
+}
+
+void MetricsSink::run() {
+    MetricRecord record;
+    for (;;) {
+        // read the flag before draining, so records pushed before close()
+        // are always written
+        const bool finishing = done_.load(std::memory_order_acquire);
+        bool any = false;
+        while (queue_.try_pop(record)) {
+            write(record);
+            any = true;
+        }
+        if (finishing) break;
+        if (!any) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+void MetricsSink::write_gate_json(std::string& out, const MetricRecord& r) {
+    std::ostringstream entry;
+    entry << (out.empty() ? "" : ",\n");
+    entry << "          {\n";
+    entry << "            \"site\": " << r.site << ",\n";
+    entry << "            \"energy\": " << r.energy << ",\n";
+    entry << "            \"state_norm\": " << r.norm << ",\n";
+    entry << "            \"bond_dim\": " << r.bond_dim << "\n";
+    entry << "          }";
+    out += entry.str();
+}
+
+void MetricsSink::write(const MetricRecord& r) {
+    switch (r.kind) {
+    case MetricRecord::Kind::init:
+        log_ << "[init] exp_op_" << r.site << " dim " << r.bond_dim << "\n";
+        break;
+    case MetricRecord::Kind::gate:
+        log_ << "[" << r.step << "] " << (r.forward ? "forward" : "backward")
+             << " exp_op_" << r.site << " sites " << r.site;
+        if (r.span == 2) log_ << "," << r.site + 1;
+        log_ << " bond_dim " << r.bond_dim << " discarded " << r.discarded << "\n";
+        if (r.measured) write_gate_json(r.forward ? forward_ : backward_, r);
+        break;
+    case MetricRecord::Kind::step:
+        json_ << (first_step_ ? "" : ",\n");
+        first_step_ = false;
+        json_ << "      {\n";
+        json_ << "        \"step\": " << r.step << ",\n";
+        json_ << "        \"time\": " << r.time << ",\n";
+        json_ << "        \"forward_sweep\": [\n" << forward_ << (forward_.empty() ? "" : "\n");
+        json_ << "        ],\n";
+        json_ << "        \"backward_sweep\": [\n" << backward_ << (backward_.empty() ? "" : "\n");
+        json_ << "        ],\n";
+        json_ << "        \"total_energy\": " << r.energy << ",\n";
+        json_ << "        \"state_norm\": " << r.norm << ",\n";
+        json_ << "        \"max_bond_dim\": " << r.bond_dim << ",\n";
+        json_ << "        \"truncation_error\": " << r.truncation_error << ",\n";
+        json_ << "        \"state_file\": \"states.qpsc\"\n";
+        json_ << "      }";
+        forward_.clear();
+        backward_.clear();
+        break;
+    }
+}
+
+} // namespace qps
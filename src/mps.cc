@@ -0,0 +1,608 @@
+#include "solver/mps.hh"
+#include "solver/execution.hh"
+#include "solver/fixed_kernels.hh"
+#include "solver/profiler.hh"
+#include "solver/thread_pool.hh"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+
+namespace qps {
+
+namespace {
+
+using Complex = std::complex<double>;
+using Matrix = Eigen::MatrixXcd;
+using MatrixMap = Eigen::Map<Matrix>;
+using ConstMatrixMap = Eigen::Map<const Matrix>;
+
+IndexId bond_label(int b) { return IndexId("b_" + std::to_string(b)); }
+IndexId phys_label(int i) { return IndexId("s_" + std::to_string(i)); }
+
+// view a tensor's buffer as a rows x cols column-major matrix. reads that
+// feed double-precision work go through .cast<Complex>(), writes of their
+// results through .cast<T>(); both are no-ops for a complex<double> state
+template <typename T>
+Eigen::Map<typename BasicTensor<T>::Matrix> as_matrix(BasicTensor<T>& t, Eigen::Index rows, Eigen::Index cols) {
+    return Eigen::Map<typename BasicTensor<T>::Matrix>(t.data.data(), rows, cols);
+}
+template <typename T>
+Eigen::Map<const typename BasicTensor<T>::Matrix> as_matrix(const BasicTensor<T>& t, Eigen::Index rows,
+                                                             Eigen::Index cols) {
+    return Eigen::Map<const typename BasicTensor<T>::Matrix>(t.data.data(), rows, cols);
+}
+
+} // namespace
+
+int truncation_rank(const Eigen::VectorXd& s, const TruncationParams& truncation,
+                    double& discarded) {
+    const int n = static_cast<int>(s.size());
+    const double total = s.squaredNorm();
+    discarded = 0.0;
+    if (total <= 0.0) return 1;
+
+    int keep = n;
+    double tail = 0.0;
+    while (keep > 1) {
+        double next = tail + s(keep - 1) * s(keep - 1);
+        if (next > truncation.max_discarded_weight * total) break;
+        tail = next;
+        --keep;
+    }
+    keep = std::max(1, std::min(keep, truncation.max_bond_dim));
+    discarded = s.tail(n - keep).squaredNorm() / total;
+    return keep;
+}
+
+template <typename T>
+BasicMatrixProductState<T> BasicMatrixProductState<T>::product_state(
+    const std::vector<Eigen::VectorXcd>& site_states) {
+    if (site_states.empty()) {
+        throw std::runtime_error("product state needs at least one site");
+    }
+    BasicMatrixProductState mps;
+    const int n = static_cast<int>(site_states.size());
+    mps.init_labels(n);
+    double scale = 1.0;
+    for (int i = 0; i < n; ++i) {
+        const Eigen::VectorXcd& v = site_states[i];
+        double nrm = v.norm();
+        if (nrm == 0.0) {
+            throw std::runtime_error("product state site vector must be nonzero");
+        }
+        Site t = mps.site_tensor(i, 1, static_cast<int>(v.size()), 1);
+        as_matrix(t, v.size(), 1) = (v / nrm).template cast<T>();
+        scale *= nrm;
+        mps.sites_.push_back(std::move(t));
+    }
+    // every site is orthonormal on its own; the overall scale sits on the center
+    as_matrix(mps.sites_[0], mps.sites_[0].data.size(), 1) *= static_cast<typename T::value_type>(scale);
+    mps.bond_spectra_.assign(n + 1, Eigen::VectorXd::Ones(1));
+    mps.center_ = 0;
+    return mps;
+}
+
+template <typename T>
+BasicMatrixProductState<T> BasicMatrixProductState<T>::from_dense(const Eigen::VectorXcd& psi,
+                                                                  const std::vector<int>& physical_dims,
+                                                                  const TruncationParams& truncation) {
+    const int n = static_cast<int>(physical_dims.size());
+    if (n == 0) {
+        throw std::runtime_error("from_dense needs at least one site");
+    }
+    Eigen::Index total = 1;
+    for (int d : physical_dims) total *= d;
+    if (total != psi.size()) {
+        throw std::runtime_error("state dimension does not match the product of physical dimensions");
+    }
+
+    // the dense vector has site 0 slowest; as a column-major tensor that is
+    // (s_{N-1}, ..., s_0), so flip it to (s_0, ..., s_{N-1})
+    std::vector<int> rev_dims(physical_dims.rbegin(), physical_dims.rend());
+    std::vector<IndexId> rev_idx;
+    for (int i = n - 1; i >= 0; --i) rev_idx.push_back(phys_label(i));
+    Tensor dense(rev_dims, rev_idx);
+    as_matrix(dense, total, 1) = psi;
+    std::vector<int> flip(n);
+    for (int k = 0; k < n; ++k) flip[k] = n - 1 - k;
+    Tensor rest = permute(dense, flip);
+
+    BasicMatrixProductState mps;
+    mps.init_labels(n);
+    mps.bond_spectra_.assign(n + 1, Eigen::VectorXd::Ones(1));
+    int dl = 1;
+    Eigen::Index cols = total;
+    Matrix remainder = as_matrix(rest, total, 1);
+    for (int i = 0; i < n - 1; ++i) {
+        const int d = physical_dims[i];
+        cols /= d;
+        ConstMatrixMap m(remainder.data(), static_cast<Eigen::Index>(dl) * d, cols);
+        Eigen::BDCSVD<Matrix> svd;
+        {
+            ScopedTimer timer(Phase::svd);
+            svd.compute(m, Eigen::ComputeThinU | Eigen::ComputeThinV);
+        }
+        double discarded = 0.0;
+        int keep = truncation_rank(svd.singularValues(), truncation, discarded);
+        mps.discarded_weight_ += discarded;
+
+        Site a = mps.site_tensor(i, dl, d, keep);
+        as_matrix(a, static_cast<Eigen::Index>(dl) * d, keep) = svd.matrixU().leftCols(keep).template cast<T>();
+        mps.sites_.push_back(std::move(a));
+
+        Eigen::VectorXd s = svd.singularValues().head(keep);
+        mps.bond_spectra_[i + 1] = s / s.norm();
+        remainder = s.cast<Complex>().asDiagonal() * svd.matrixV().leftCols(keep).adjoint();
+        dl = keep;
+    }
+    Site last = mps.site_tensor(n - 1, dl, physical_dims[n - 1], 1);
+    as_matrix(last, remainder.rows(), remainder.cols()) = remainder.template cast<T>();
+    mps.sites_.push_back(std::move(last));
+    mps.center_ = n - 1;
+    return mps;
+}
+
+template <typename T>
+BasicMatrixProductState<T> BasicMatrixProductState<T>::from_sites(std::vector<Site> sites, int center,
+                                                                  double truncation_error) {
+    const int n = static_cast<int>(sites.size());
+    if (n == 0) {
+        throw std::runtime_error("from_sites needs at least one site");
+    }
+    if (center < -1 || center >= n) {
+        throw std::runtime_error("orthogonality center out of range");
+    }
+    BasicMatrixProductState mps;
+    mps.init_labels(n);
+    for (int i = 0; i < n; ++i) {
+        Site& t = sites[i];
+        if (t.rank() != 3) {
+            throw std::runtime_error("mps site tensors must have rank 3");
+        }
+        const int dl = t.dimensions[0], dr = t.dimensions[2];
+        if ((i == 0 && dl != 1) || (i + 1 == n && dr != 1) ||
+            (i > 0 && dl != sites[i - 1].dimensions[2])) {
+            throw std::runtime_error("mps bond dimensions do not match");
+        }
+        t.indices = {mps.bond_labels_[i], mps.phys_labels_[i], mps.bond_labels_[i + 1]};
+    }
+    mps.sites_ = std::move(sites);
+    // spectra of inner bonds are unknown until the next svd on them
+    mps.bond_spectra_.assign(n + 1, Eigen::VectorXd());
+    mps.bond_spectra_.front() = mps.bond_spectra_.back() = Eigen::VectorXd::Ones(1);
+    mps.center_ = center;
+    mps.discarded_weight_ = truncation_error;
+    return mps;
+}
+
+template <typename T>
+const ExecutionContext& BasicMatrixProductState<T>::execution_context() const {
+    return execution_ ? *execution_ : ExecutionContext::serial();
+}
+
+template <typename T>
+void BasicMatrixProductState<T>::init_labels(int n) {
+    bond_labels_.clear();
+    phys_labels_.clear();
+    for (int b = 0; b <= n; ++b) bond_labels_.push_back(bond_label(b));
+    for (int i = 0; i < n; ++i) phys_labels_.push_back(phys_label(i));
+}
+
+template <typename T>
+typename BasicMatrixProductState<T>::Site BasicMatrixProductState<T>::site_tensor(int site, int dl, int d,
+                                                                                  int dr) const {
+    return Site({dl, d, dr}, {bond_labels_[site], phys_labels_[site], bond_labels_[site + 1]});
+}
+
+template <typename T>
+int BasicMatrixProductState<T>::bond_dim(int bond) const {
+    if (bond == num_sites()) return sites_.back().dimensions[2];
+    return sites_[bond].dimensions[0];
+}
+
+template <typename T>
+int BasicMatrixProductState<T>::max_bond_dim() const {
+    int chi = 1;
+    for (const auto& t : sites_) chi = std::max(chi, t.dimensions[2]);
+    return chi;
+}
+
+template <typename T>
+void BasicMatrixProductState<T>::move_center_right(int site) {
+    right_canonical_ = false;
+    Site& a = sites_[site];
+    const int dl = a.dimensions[0], d = a.dimensions[1], dr = a.dimensions[2];
+    const Eigen::Index rows = static_cast<Eigen::Index>(dl) * d;
+    Eigen::HouseholderQR<Matrix> qr(as_matrix(a, rows, dr).template cast<Complex>());
+    const int k = static_cast<int>(std::min<Eigen::Index>(rows, dr));
+    Matrix q = qr.householderQ() * Matrix::Identity(rows, k);
+    Matrix r = qr.matrixQR().topRows(k).triangularView<Eigen::Upper>();
+
+    Site new_a = site_tensor(site, dl, d, k);
+    as_matrix(new_a, rows, k) = q.template cast<T>();
+    a = std::move(new_a);
+
+    Site& b = sites_[site + 1];
+    const int d2 = b.dimensions[1], dr2 = b.dimensions[2];
+    Site new_b = site_tensor(site + 1, k, d2, dr2);
+    as_matrix(new_b, k, static_cast<Eigen::Index>(d2) * dr2).noalias() =
+        r.template cast<T>() * as_matrix(b, dr, static_cast<Eigen::Index>(d2) * dr2);
+    b = std::move(new_b);
+}
+
+template <typename T>
+void BasicMatrixProductState<T>::move_center_left(int site) {
+    right_canonical_ = false;
+    Site& a = sites_[site];
+    const int dl = a.dimensions[0], d = a.dimensions[1], dr = a.dimensions[2];
+    const Eigen::Index cols = static_cast<Eigen::Index>(d) * dr;
+    // a = r^dagger q^dagger from the qr of a^dagger
+    Eigen::HouseholderQR<Matrix> qr(as_matrix(a, dl, cols).template cast<Complex>().adjoint());
+    const int k = static_cast<int>(std::min<Eigen::Index>(dl, cols));
+    Matrix q = qr.householderQ() * Matrix::Identity(cols, k);
+    Matrix r = qr.matrixQR().topRows(k).triangularView<Eigen::Upper>();
+
+    Site new_a = site_tensor(site, k, d, dr);
+    as_matrix(new_a, k, cols) = q.adjoint().template cast<T>();
+    a = std::move(new_a);
+
+    Site& b = sites_[site - 1];
+    const int dl0 = b.dimensions[0], d0 = b.dimensions[1];
+    const Eigen::Index rows = static_cast<Eigen::Index>(dl0) * d0;
+    Site new_b = site_tensor(site - 1, dl0, d0, k);
+    as_matrix(new_b, rows, k).noalias() = as_matrix(b, rows, dl) * r.adjoint().template cast<T>();
+    b = std::move(new_b);
+}
+
+template <typename T>
+void BasicMatrixProductState<T>::canonicalize() {
+    for (int i = 0; i + 1 < num_sites(); ++i) move_center_right(i);
+    center_ = num_sites() - 1;
+}
+
+template <typename T>
+void BasicMatrixProductState<T>::move_center(int site) {
+    if (site < 0 || site >= num_sites()) {
+        throw std::runtime_error("orthogonality center out of range");
+    }
+    if (center_ < 0) canonicalize();
+    while (center_ < site) move_center_right(center_++);
+    while (center_ > site) move_center_left(center_--);
+}
+
+template <typename T>
+void BasicMatrixProductState<T>::apply_one_site_gate(const Eigen::MatrixXcd& gate, int site) {
+    if (site < 0 || site >= num_sites()) {
+        throw std::runtime_error("orthogonality center out of range");
+    }
+    const int d = physical_dim(site);
+    if (gate.rows() != d || gate.cols() != d) {
+        throw std::runtime_error("one-site gate does not match the physical dimension");
+    }
+    move_center(site);
+    right_canonical_ = false;
+    update_site(site, LocalUpdate(), &gate);
+}
+
+template <typename T>
+void BasicMatrixProductState<T>::apply_one_site(const LocalUpdate& update, int site) {
+    move_center(site);
+    right_canonical_ = false;
+    update_site(site, update, nullptr);
+}
+
+template <typename T>
+void BasicMatrixProductState<T>::update_site(int site, const LocalUpdate& update, const Eigen::MatrixXcd* gate) {
+    if constexpr (std::is_same<T, Complex>::value) {
+        update_block(sites_[site], update, gate);
+    } else {
+        Tensor t = widen(sites_[site]);
+        update_block(t, update, gate);
+        sites_[site] = t.template cast<T>();
+    }
+}
+
+template <typename T>
+void BasicMatrixProductState<T>::update_block(Tensor& t, const LocalUpdate& update,
+                                              const Eigen::MatrixXcd* gate) {
+    if (gate && apply_fixed_gate(*gate, t)) return;
+    // permuted to (s, b_l, b_r), resp. (s2, s1, b_l, b_r), the leading
+    // indices form the kronecker row index of the gate
+    const std::vector<int> order = t.rank() == 3 ? std::vector<int>{1, 0, 2} : std::vector<int>{2, 1, 0, 3};
+    const Eigen::Index rows = t.rank() == 3 ? t.dimensions[1]
+                                            : static_cast<Eigen::Index>(t.dimensions[1]) * t.dimensions[2];
+    const Eigen::Index cols = t.data.size() / rows;
+    Tensor p = permute(t, order);
+    Matrix out = gate ? Matrix(*gate * as_matrix(p, rows, cols)) : update(as_matrix(p, rows, cols));
+    if (out.rows() != rows || out.cols() != cols) {
+        throw std::runtime_error("local update changed the block shape");
+    }
+    p.data.adopt(std::move(out), p.dimensions);
+    t = permute(p, order);
+}
+
+template <typename T>
+Tensor BasicMatrixProductState<T>::two_site_theta(int site) const {
+    return widen(contract_tensors(sites_[site], sites_[site + 1], {{2, 0}}, execution_context()));
+}
+
+template <typename T>
+double BasicMatrixProductState<T>::apply_two_site_gate(const Eigen::MatrixXcd& gate, int site,
+                                               const TruncationParams& truncation,
+                                               bool sweep_right) {
+    if (site < 0 || site + 1 >= num_sites()) {
+        throw std::runtime_error("two-site gate position out of range");
+    }
+    const Eigen::Index dd = static_cast<Eigen::Index>(physical_dim(site)) * physical_dim(site + 1);
+    if (gate.rows() != dd || gate.cols() != dd) {
+        throw std::runtime_error("two-site gate does not match the physical dimensions");
+    }
+    return update_two_site(LocalUpdate(), &gate, site, truncation, sweep_right);
+}
+
+template <typename T>
+double BasicMatrixProductState<T>::apply_two_site(const LocalUpdate& update, int site,
+                                                  const TruncationParams& truncation, bool sweep_right) {
+    return update_two_site(update, nullptr, site, truncation, sweep_right);
+}
+
+template <typename T>
+double BasicMatrixProductState<T>::update_two_site(const LocalUpdate& update, const Eigen::MatrixXcd* gate,
+                                                   int site, const TruncationParams& truncation,
+                                                   bool sweep_right) {
+    if (site < 0 || site + 1 >= num_sites()) {
+        throw std::runtime_error("two-site gate position out of range");
+    }
+    if (center_ != site && center_ != site + 1) move_center(site);
+    right_canonical_ = false;
+
+    // theta (b_l, s1, s2, b_r)
+    Tensor theta = two_site_theta(site);
+    const int dl = theta.dimensions[0], d1 = theta.dimensions[1];
+    const int d2 = theta.dimensions[2], dr = theta.dimensions[3];
+    update_block(theta, update, gate);
+
+    const Eigen::Index rows = static_cast<Eigen::Index>(dl) * d1;
+    const Eigen::Index cols = static_cast<Eigen::Index>(d2) * dr;
+    Eigen::BDCSVD<Matrix> svd;
+    {
+        ScopedTimer timer(Phase::svd);
+        svd.compute(as_matrix(theta, rows, cols), Eigen::ComputeThinU | Eigen::ComputeThinV);
+    }
+    double discarded = 0.0;
+    const int keep = truncation_rank(svd.singularValues(), truncation, discarded);
+    discarded_weight_ += discarded;
+
+    // rescale the kept spectrum so truncation does not shrink the norm
+    Eigen::VectorXd s = svd.singularValues().head(keep);
+    const double kept = s.norm();
+    if (kept > 0.0) {
+        bond_spectra_[site + 1] = s / kept;
+        s *= svd.singularValues().norm() / kept;
+    }
+    const Eigen::VectorXcd sc = s.cast<Complex>();
+
+    Site a = site_tensor(site, dl, d1, keep);
+    Site b = site_tensor(site + 1, keep, d2, dr);
+    if (sweep_right) {
+        as_matrix(a, rows, keep) = svd.matrixU().leftCols(keep).template cast<T>();
+        as_matrix(b, keep, cols) = (sc.asDiagonal() * svd.matrixV().leftCols(keep).adjoint()).template cast<T>();
+        center_ = site + 1;
+    } else {
+        as_matrix(a, rows, keep) = (svd.matrixU().leftCols(keep) * sc.asDiagonal()).template cast<T>();
+        as_matrix(b, keep, cols) = svd.matrixV().leftCols(keep).adjoint().template cast<T>();
+        center_ = site;
+    }
+    sites_[site] = std::move(a);
+    sites_[site + 1] = std::move(b);
+    return discarded;
+}
+
+template <typename T>
+void BasicMatrixProductState<T>::right_canonicalize() {
+    for (int i = num_sites() - 1; i >= 1; --i) {
+        Site& a = sites_[i];
+        const int dl = a.dimensions[0], d = a.dimensions[1], dr = a.dimensions[2];
+        const Eigen::Index cols = static_cast<Eigen::Index>(d) * dr;
+        Eigen::BDCSVD<Matrix> svd;
+        {
+            ScopedTimer timer(Phase::svd);
+            svd.compute(as_matrix(a, dl, cols).template cast<Complex>(), Eigen::ComputeThinU | Eigen::ComputeThinV);
+        }
+        const Eigen::VectorXd& s = svd.singularValues();
+        const int k = static_cast<int>(s.size());
+
+        Site new_a = site_tensor(i, k, d, dr);
+        as_matrix(new_a, k, cols) = svd.matrixV().adjoint().template cast<T>();
+        a = std::move(new_a);
+
+        Site& b = sites_[i - 1];
+        const int dl0 = b.dimensions[0], d0 = b.dimensions[1];
+        const Eigen::Index rows = static_cast<Eigen::Index>(dl0) * d0;
+        Site new_b = site_tensor(i - 1, dl0, d0, k);
+        const Matrix us = svd.matrixU() * s.cast<Complex>().asDiagonal();
+        as_matrix(new_b, rows, k).noalias() = as_matrix(b, rows, dl) * us.template cast<T>();
+        b = std::move(new_b);
+
+        const double nrm = s.norm();
+        bond_spectra_[i] = nrm > 0.0 ? Eigen::VectorXd(s / nrm) : s;
+    }
+    center_ = 0;
+    right_canonical_ = true;
+}
+
+template <typename T>
+double BasicMatrixProductState<T>::update_bond(const LocalUpdate& update, const Eigen::MatrixXcd* gate, int site,
+                                               const TruncationParams& truncation) {
+    // with right-orthonormal B's, theta = diag(s_site) B_site B_site+1 is the
+    // normalized two-site wavefunction. after the svd G theta = X Y Z^dag the
+    // new tensors are B_site+1 = Z^dag and B_site = (G B_site B_site+1) Z,
+    // which needs no division by small singular values
+    Tensor c = two_site_theta(site);
+    const int dl = c.dimensions[0], d1 = c.dimensions[1];
+    const int d2 = c.dimensions[2], dr = c.dimensions[3];
+    update_block(c, update, gate);
+
+    const Eigen::Index rows = static_cast<Eigen::Index>(dl) * d1;
+    const Eigen::Index cols = static_cast<Eigen::Index>(d2) * dr;
+    // b_l is the fastest index, so scaling the rows of a dl-row view scales it
+    Matrix theta = bond_spectra_[site].cast<Complex>().asDiagonal() *
+                   as_matrix(c, dl, static_cast<Eigen::Index>(d1) * cols);
+    Eigen::BDCSVD<Matrix> svd;
+    {
+        ScopedTimer timer(Phase::svd);
+        svd.compute(MatrixMap(theta.data(), rows, cols), Eigen::ComputeThinV);
+    }
+    double discarded = 0.0;
+    const int keep = truncation_rank(svd.singularValues(), truncation, discarded);
+
+    Eigen::VectorXd s = svd.singularValues().head(keep);
+    const double kept = s.norm();
+    const double total = svd.singularValues().norm();
+
+    Site a = site_tensor(site, dl, d1, keep);
+    Site b = site_tensor(site + 1, keep, d2, dr);
+    auto z = svd.matrixV().leftCols(keep);
+    as_matrix(b, keep, cols) = z.adjoint().template cast<T>();
+    // rescale so truncation does not shrink the norm
+    const double rescale = kept > 0.0 ? total / kept : 1.0;
+    if (kept > 0.0) bond_spectra_[site + 1] = s / kept;
+    as_matrix(a, rows, keep).noalias() = (rescale * (as_matrix(c, rows, cols) * z)).template cast<T>();
+    sites_[site] = std::move(a);
+    sites_[site + 1] = std::move(b);
+    return discarded;
+}
+
+template <typename T>
+double BasicMatrixProductState<T>::apply_layer(const std::vector<LayerGate>& gates,
+                                               const TruncationParams& truncation, ThreadPool* pool) {
+    std::vector<int> bonds;
+    for (const auto& g : gates) {
+        if (g.site < 0 || g.site + 1 >= num_sites()) {
+            throw std::runtime_error("two-site gate position out of range");
+        }
+        bonds.push_back(g.site);
+    }
+    std::sort(bonds.begin(), bonds.end());
+    for (size_t k = 1; k < bonds.size(); ++k) {
+        if (bonds[k] - bonds[k - 1] < 2) {
+            throw std::runtime_error("gates of a layer must act on disjoint bonds");
+        }
+    }
+    if (!right_canonical_) right_canonicalize();
+
+    // each gate writes only its own slot, and the sum runs in gate order
+    std::vector<double> discarded(gates.size(), 0.0);
+    if (pool && gates.size() > 1) {
+        for (size_t g = 0; g < gates.size(); ++g) {
+            pool->submit([&, g] { discarded[g] = update_bond(gates[g].update, gates[g].gate, gates[g].site, truncation); });
+        }
+        pool->wait();
+    } else {
+        for (size_t g = 0; g < gates.size(); ++g) {
+            discarded[g] = update_bond(gates[g].update, gates[g].gate, gates[g].site, truncation);
+        }
+    }
+    double total = 0.0;
+    for (double w : discarded) total += w;
+    discarded_weight_ += total;
+    return total;
+}
+
+template <typename T>
+void BasicMatrixProductState<T>::scale_by_spectrum(Tensor& t, int site) const {
+    const Eigen::VectorXcd s = bond_spectra_[site].cast<Complex>();
+    as_matrix(t, s.size(), t.data.size() / s.size()).array().colwise() *= s.array();
+}
+
+template <typename T>
+std::complex<double> BasicMatrixProductState<T>::expectation_one_site(const Eigen::MatrixXcd& op, int site) {
+    // in the right-canonical form of apply_layer, diag(s) B is the site in
+    // the mixed gauge; the center stays put and the next layer needs no sweep
+    Tensor scaled;
+    if (right_canonical_) {
+        scaled = widen(sites_[site]);
+        scale_by_spectrum(scaled, site);
+    } else {
+        move_center(site);
+    }
+    const Tensor& a = right_canonical_ ? scaled : widen(sites_[site]);
+    const int dl = a.dimensions[0], d = a.dimensions[1], dr = a.dimensions[2];
+    const Tensor p = permute(a, {1, 0, 2});
+    ConstMatrixMap m = as_matrix(p, d, static_cast<Eigen::Index>(dl) * dr);
+    const double nrm2 = m.squaredNorm();
+    return m.conjugate().cwiseProduct(op * m).sum() / nrm2;
+}
+
+template <typename T>
+std::complex<double> BasicMatrixProductState<T>::expectation_two_site(const Eigen::MatrixXcd& op, int site) {
+    if (!right_canonical_ && center_ != site && center_ != site + 1) move_center(site);
+    Tensor theta = two_site_theta(site);
+    if (right_canonical_) scale_by_spectrum(theta, site);
+    const int dl = theta.dimensions[0], dr = theta.dimensions[3];
+    const Eigen::Index dd = static_cast<Eigen::Index>(theta.dimensions[1]) * theta.dimensions[2];
+    const Tensor p = permute(theta, {2, 1, 0, 3});
+    ConstMatrixMap m = as_matrix(p, dd, static_cast<Eigen::Index>(dl) * dr);
+    const double nrm2 = m.squaredNorm();
+    return m.conjugate().cwiseProduct(op * m).sum() / nrm2;
+}
+
+template <typename T>
+std::complex<double> BasicMatrixProductState<T>::overlap(const BasicMatrixProductState& other) const {
+    if (other.num_sites() != num_sites()) {
+        throw std::runtime_error("overlap needs states on the same number of sites");
+    }
+    // transfer environment (bra bond, ket bond), absorbed left to right
+    Tensor env({1, 1}, {"bra", "ket"});
+    env.data(0) = 1.0;
+    for (int i = 0; i < num_sites(); ++i) {
+        Tensor tmp = contract_tensors(env, widen(other.sites_[i]), {{1, 0}});  // (bra, s, ket')
+        env = contract_tensors(widen(sites_[i]).conj(), tmp, {{0, 0}, {1, 1}});  // (bra', ket')
+    }
+    return env.data(0);
+}
+
+template <typename T>
+double BasicMatrixProductState<T>::norm() const {
+    if (center_ >= 0) {
+        return as_matrix(sites_[center_], sites_[center_].data.size(), 1).template cast<Complex>().norm();
+    }
+    return std::sqrt(std::abs(overlap(*this)));
+}
+
+template <typename T>
+void BasicMatrixProductState<T>::normalize() {
+    if (center_ < 0) canonicalize();
+    auto m = as_matrix(sites_[center_], sites_[center_].data.size(), 1);
+    double nrm = m.template cast<Complex>().norm();
+    if (nrm > 0.0) m /= static_cast<typename T::value_type>(nrm);
+}
+
+template <typename T>
+Eigen::VectorXcd BasicMatrixProductState<T>::to_dense() const {
+    const int n = num_sites();
+    Tensor psi = widen(sites_[0]);
+    for (int i = 1; i < n; ++i) {
+        psi = contract_tensors(psi, widen(sites_[i]), {{psi.rank() - 1, 0}});
+    }
+    // (b_0, s_0, ..., s_{N-1}, b_N) -> (s_{N-1}, ..., s_0, b_0, b_N) puts site 0 slowest
+    std::vector<int> order;
+    for (int i = n; i >= 1; --i) order.push_back(i);
+    order.push_back(0);
+    order.push_back(n + 1);
+    Tensor flat = permute(psi, order);
+    return as_matrix(flat, flat.data.size(), 1);
+}
+
+template <typename T>
+std::size_t BasicMatrixProductState<T>::memory_bytes() const {
+    std::size_t bytes = 0;
+    for (const auto& t : sites_) bytes += t.data.size() * sizeof(T);
+    return bytes;
+}
+
+template class BasicMatrixProductState<std::complex<float>>;
+template class BasicMatrixProductState<std::complex<double>>;
+
+} // namespace qps
@@ -0,0 +1,127 @@
+#include "solver/observables.hh"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace qps {
+
+int ObservableBatch::intern_operator(const Eigen::MatrixXcd& op) {
+    for (size_t k = 0; k < operators_.size(); ++k) {
+        if (operators_[k].rows() == op.rows() && operators_[k].cols() == op.cols() && operators_[k] == op) {
+            return static_cast<int>(k);
+        }
+    }
+    operators_.push_back(op);
+    return static_cast<int>(operators_.size()) - 1;
+}
+
+size_t ObservableBatch::add(const std::string& name, std::vector<Factor> factors) {
+    if (factors.empty()) {
+        throw std::runtime_error("an observable needs at least one factor");
+    }
+    std::sort(factors.begin(), factors.end(),
+              [](const Factor& a, const Factor& b) { return a.first < b.first; });
+    for (size_t k = 0; k < factors.size(); ++k) {
+        if (factors[k].first < 0) {
+            throw std::runtime_error("observable site out of range");
+        }
+        if (factors[k].second.rows() != factors[k].second.cols()) {
+            throw std::runtime_error("observable factors must be square");
+        }
+        if (k > 0 && factors[k].first == factors[k - 1].first) {
+            throw std::runtime_error("observable factors must be on distinct sites");
+        }
+    }
+
+    int node = 0;
+    for (const Factor& f : factors) {
+        const int op = intern_operator(f.second);
+        int next = -1;
+        for (int c : nodes_[node].children) {
+            if (nodes_[c].site == f.first && nodes_[c].op == op) next = c;
+        }
+        if (next < 0) {
+            next = static_cast<int>(nodes_.size());
+            Node child;
+            child.site = f.first;
+            child.op = op;
+            nodes_.push_back(std::move(child));
+            std::vector<int>& siblings = nodes_[node].children;
+            auto pos = std::upper_bound(siblings.begin(), siblings.end(), f.first,
+                                        [this](int site, int c) { return site < nodes_[c].site; });
+            siblings.insert(pos, next);
+        }
+        node = next;
+    }
+    nodes_[node].ends.push_back(names_.size());
+    names_.push_back(name);
+    return names_.size() - 1;
+}
+
+std::vector<std::complex<double>> ObservableBatch::measure(const MatrixProductState& state) const {
+    const int n = state.num_sites();
+    for (size_t k = 1; k < nodes_.size(); ++k) {
+        const Node& node = nodes_[k];
+        if (node.site >= n) {
+            throw std::runtime_error("observable site out of range");
+        }
+        if (operators_[node.op].rows() != state.physical_dim(node.site)) {
+            throw std::runtime_error("observable does not match the physical dimension");
+        }
+    }
+
+    // environments are (bra bond, ket bond) matrices
+    std::vector<Tensor> bra;
+    for (int i = 0; i < n; ++i) bra.push_back(state.site(i).conj());
+    std::vector<Tensor> ops;
+    for (const auto& op : operators_) ops.push_back(Tensor::from_matrix(op, {"out", "in"}));
+
+    // absorb site i into a left environment, with an operator on it or not
+    auto extend = [&](const Tensor& env, int i, const Tensor* op) {
+        Tensor tmp = contract_tensors(env, state.site(i), {{1, 0}});      // (bra, s, ket')
+        if (!op) return contract_tensors(bra[i], tmp, {{0, 0}, {1, 1}});  // (bra', ket')
+        tmp = contract_tensors(tmp, *op, {{1, 1}});                       // (bra, ket', s')
+        return contract_tensors(bra[i], tmp, {{0, 0}, {1, 2}});
+    };
+
+    // left[i] holds sites < i, right[i] sites >= i
+    std::vector<Tensor> left(n + 1), right(n + 1);
+    left[0] = Tensor({1, 1}, {"bra", "ket"});
+    left[0].data(0) = 1.0;
+    right[n] = left[0];
+    for (int i = 0; i < n; ++i) left[i + 1] = extend(left[i], i, nullptr);
+    for (int i = n - 1; i >= 0; --i) {
+        Tensor tmp = contract_tensors(state.site(i), right[i + 1], {{2, 1}});  // (ket, s, bra')
+        right[i] = contract_tensors(bra[i], tmp, {{1, 1}, {2, 2}});            // (bra, ket)
+    }
+    const std::complex<double> norm2 = left[n].data(0);
+    if (norm2 == 0.0) {
+        throw std::runtime_error("cannot measure a zero state");
+    }
+
+    std::vector<std::complex<double>> values(names_.size());
+    // env holds every site up to and including node.site
+    std::function<void(int, const Tensor&)> visit = [&](int k, const Tensor& env) {
+        const Node& node = nodes_[k];
+        if (!node.ends.empty()) {
+            const Tensor& r = right[node.site + 1];
+            const std::complex<double> v = env.vector_view().cwiseProduct(r.vector_view()).sum() / norm2;
+            for (size_t end : node.ends) values[end] = v;
+        }
+        // identity transfers between the factors are shared by all children
+        Tensor open = env;
+        int site = node.site + 1;
+        for (int c : node.children) {
+            const Node& child = nodes_[c];
+            for (; site < child.site; ++site) open = extend(open, site, nullptr);
+            visit(c, extend(open, child.site, &ops[child.op]));
+        }
+    };
+    for (int c : nodes_[0].children) {
+        const Node& child = nodes_[c];
+        visit(c, extend(left[child.site], child.site, &ops[child.op]));
+    }
+    return values;
+}
+
+} // namespace qps
@@ -0,0 +1,121 @@
+#include "solver/profiler.hh"
+#include <sstream>
+
+namespace qps {
+
+namespace detail {
+std::atomic<bool> profiler_enabled{false};
+thread_local Profiler* current_profiler = nullptr;
+}
+
+namespace {
+
+size_t bucket(uint64_t nanoseconds) {
+    size_t b = 0;
+    while (nanoseconds > 1 && b + 1 < kHistogramBuckets) {
+        nanoseconds >>= 1;
+        ++b;
+    }
+    return b;
+}
+
+} // namespace
+
+const char* phase_name(Phase phase) {
+    switch (phase) {
+        case Phase::step: return "step";
+        case Phase::contract: return "contract";
+        case Phase::permute: return "permute";
+        case Phase::expm: return "expm";
+        case Phase::krylov: return "krylov";
+        case Phase::svd: return "svd";
+        case Phase::copy: return "copy";
+        case Phase::io: return "io";
+        case Phase::count: break;
+    }
+    return "unknown";
+}
+
+Profiler& Profiler::global() {
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::record(Phase phase, uint64_t nanoseconds) {
+    PhaseCounters& p = phases_[static_cast<size_t>(phase)];
+    p.calls.fetch_add(1, std::memory_order_relaxed);
+    p.nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    p.histogram[bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+}
+
+ProfileSnapshot Profiler::snapshot() const {
+    ProfileSnapshot s;
+    for (size_t k = 0; k < kNumPhases; ++k) {
+        s.phases[k].calls = phases_[k].calls.load(std::memory_order_relaxed);
+        s.phases[k].nanoseconds = phases_[k].nanoseconds.load(std::memory_order_relaxed);
+        for (size_t b = 0; b < kHistogramBuckets; ++b) {
+            s.phases[k].histogram[b] = phases_[k].histogram[b].load(std::memory_order_relaxed);
+        }
+    }
+    s.contractions = contractions_.load(std::memory_order_relaxed);
+    s.flops = flops_.load(std::memory_order_relaxed);
+    s.bytes_allocated = bytes_allocated_.load(std::memory_order_relaxed);
+    s.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void Profiler::reset() {
+    for (auto& p : phases_) {
+        p.calls.store(0, std::memory_order_relaxed);
+        p.nanoseconds.store(0, std::memory_order_relaxed);
+        for (auto& h : p.histogram) h.store(0, std::memory_order_relaxed);
+    }
+    contractions_.store(0, std::memory_order_relaxed);
+    flops_.store(0, std::memory_order_relaxed);
+    bytes_allocated_.store(0, std::memory_order_relaxed);
+    bytes_written_.store(0, std::memory_order_relaxed);
+}
+
+ProfileSnapshot ProfileSnapshot::operator-(const ProfileSnapshot& earlier) const {
+    ProfileSnapshot d;
+    for (size_t k = 0; k < kNumPhases; ++k) {
+        d.phases[k].calls = phases[k].calls - earlier.phases[k].calls;
+        d.phases[k].nanoseconds = phases[k].nanoseconds - earlier.phases[k].nanoseconds;
+        for (size_t b = 0; b < kHistogramBuckets; ++b) {
+            d.phases[k].histogram[b] = phases[k].histogram[b] - earlier.phases[k].histogram[b];
+        }
+    }
+    d.contractions = contractions - earlier.contractions;
+    d.flops = flops - earlier.flops;
+    d.bytes_allocated = bytes_allocated - earlier.bytes_allocated;
+    d.bytes_written = bytes_written - earlier.bytes_written;
+    return d;
+}
+
+std::string ProfileSnapshot::to_json(int indent) const {
+    const std::string pad(indent, ' ');
+    std::ostringstream out;
+    out << "{\n";
+    out << pad << "  \"counters\": {\"contractions\": " << contractions << ", \"flops\": " << flops
+        << ", \"bytes_allocated\": " << bytes_allocated << ", \"bytes_written\": " << bytes_written << "},\n";
+    out << pad << "  \"phases\": {";
+    bool first = true;
+    for (size_t k = 0; k < kNumPhases; ++k) {
+        const PhaseStats& p = phases[k];
+        if (p.calls == 0) continue;
+        // the histogram stops at its last non-empty bucket
+        size_t used = kHistogramBuckets;
+        while (used > 0 && p.histogram[used - 1] == 0) --used;
+        out << (first ? "\n" : ",\n") << pad << "    \"" << phase_name(static_cast<Phase>(k))
+            << "\": {\"calls\": " << p.calls << ", \"seconds\": " << p.nanoseconds * 1e-9
+            << ", \"histogram_log2_ns\": [";
+        for (size_t b = 0; b < used; ++b) out << (b ? ", " : "") << p.histogram[b];
+        out << "]}";
+        first = false;
+    }
+    out << (first ? "}\n" : "\n" + pad + "  }\n");
+    out << pad << "}";
+    return out.str();
+}
+
+} // namespace qps
@@ -0,0 +1,126 @@
+#include "solver/propagator_cache.hh"
+#include "solver/fixed_kernels.hh"
+#include "solver/profiler.hh"
+#include <complex>
+#include <cstring>
+#include <stdexcept>
+
+namespace qps {
+
+PropagatorCache& PropagatorCache::shared() {
+    static PropagatorCache cache;
+    return cache;
+}
+
+uint64_t PropagatorCache::content_hash(const Matrix& op, double dt, TimeKind kind) {
+    // fnv-1a over the shape, the step and the raw element bytes
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](const void* p, size_t n) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(p);
+        for (size_t i = 0; i < n; ++i) {
+            h ^= bytes[i];
+            h *= 1099511628211ull;
+        }
+    };
+    const Eigen::Index rows = op.rows(), cols = op.cols();
+    const int k = static_cast<int>(kind);
+    mix(&rows, sizeof(rows));
+    mix(&cols, sizeof(cols));
+    mix(&dt, sizeof(dt));
+    mix(&k, sizeof(k));
+    mix(op.data(), op.size() * sizeof(Matrix::Scalar));
+    return h;
+}
+
+std::shared_ptr<const PropagatorCache::Matrix> PropagatorCache::get(const Matrix& op, double dt,
+                                                                    TimeKind kind) {
+    if (op.rows() != op.cols()) {
+        throw std::runtime_error("propagator needs a square operator");
+    }
+    const uint64_t h = content_hash(op, dt, kind);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(h);
+        if (it != entries_.end()) {
+            // the hash only narrows the search; equal content is required
+            for (const Entry& e : it->second) {
+                if (e.dt == dt && e.kind == kind && e.op.rows() == op.rows() &&
+                    std::memcmp(e.op.data(), op.data(), op.size() * sizeof(Matrix::Scalar)) == 0) {
+                    ++hits_;
+                    return e.propagator;
+                }
+            }
+        }
+    }
+
+    // expm runs outside the lock; a concurrent miss on the same key just
+    // computes the same matrix twice (and counts as two misses)
+    const std::complex<double> scale = (kind == TimeKind::real) ? std::complex<double>(0, -dt)
+                                                                : std::complex<double>(-dt, 0);
+    std::shared_ptr<const Matrix> propagator;
+    {
+        ScopedTimer timer(Phase::expm);
+        propagator = std::make_shared<const Matrix>(matrix_exponential(scale * op));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++misses_;
+    if (capacity_ == 0) return propagator;
+    // another thread may have stored the same key meanwhile; keep one entry
+    // so concurrent solvers end up sharing a single matrix
+    std::vector<Entry>& bucket = entries_[h];
+    for (const Entry& e : bucket) {
+        if (e.dt == dt && e.kind == kind && e.op.rows() == op.rows() &&
+            std::memcmp(e.op.data(), op.data(), op.size() * sizeof(Matrix::Scalar)) == 0) {
+            return e.propagator;
+        }
+    }
+    bucket.push_back(Entry{op, dt, kind, propagator});
+    insertion_order_.push_back(h);
+    ++size_;
+    evict();
+    return propagator;
+}
+
+void PropagatorCache::evict() {
+    while (size_ > capacity_ && !insertion_order_.empty()) {
+        auto it = entries_.find(insertion_order_.front());
+        insertion_order_.pop_front();
+        if (it == entries_.end() || it->second.empty()) continue;
+        it->second.erase(it->second.begin());
+        if (it->second.empty()) entries_.erase(it);
+        --size_;
+    }
+}
+
+size_t PropagatorCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+size_t PropagatorCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+size_t PropagatorCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+void PropagatorCache::set_capacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    evict();
+}
+
+void PropagatorCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    insertion_order_.clear();
+    size_ = 0;
+    hits_ = 0;
+    misses_ = 0;
+}
+
+} // namespace qps
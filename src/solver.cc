@@ -1,22 +1,63 @@
 #include "solver/solver.hh"
+#include "solver/thread_pool.hh"
 #include <cmath>
 #include <stdexcept>
 #include <unsupported/Eigen/MatrixFunctions>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
-#include <iostream>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <sstream>
 
 namespace qps {
 
-// helper for debugging
-static void print_tensor_indices(const std::string& name, const Tensor& t) {
-    std::cout << "[DEBUG] Tensor '" << name << "' indices: ";
-    for (const auto& idx : t.indices) std::cout << idx << " ";
-    std::cout << std::endl;
+// the record `name` of the snapshot sealed by commit record `commit`
+static Tensor read_snapshot(const CheckpointReader& reader, int commit, const std::string& name) {
+    const auto& records = reader.records();
+    for (int k = commit - 1; k >= 0 && records[k].name != CheckpointReader::kCommitRecord; --k) {
+        if (records[k].name == name) return reader.read(records[k]);
+    }
+    throw std::runtime_error("checkpoint snapshot is missing '" + name + "'");
+}
+
+// y = op x for a rank-2 operator; a sparse one is applied through its nonzeros
+static LinearMap operator_map(const Tensor& op) {
+    if (op.is_sparse()) {
+        std::shared_ptr<const Tensor::SparseMatrix> s = op.sparse;
+        return [s](const Eigen::MatrixXcd& x, Eigen::MatrixXcd& y) { y.noalias() = *s * x; };
+    }
+    auto m = std::make_shared<const Eigen::MatrixXcd>(op.to_matrix());
+    return [m](const Eigen::MatrixXcd& x, Eigen::MatrixXcd& y) { y.noalias() = *m * x; };
+}
+
+// <dir>/profile.json: what the run recorded into its own profiler
+static void write_profile(const std::string& dir, const std::string& solver, const Profiler& run,
+                          std::chrono::steady_clock::time_point start) {
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::ofstream out(dir + "/profile.json");
+    out << "{\n  \"solver\": \"" << solver << "\",\n  \"wall_seconds\": " << wall
+        << ",\n  \"profile\": " << run.snapshot().to_json(2) << "\n}\n";
 }
 
 void TimeEvolutionSolver::initialize_state(const Tensor& initial_state) {
-    network_.add_tensor(initial_state, "psi_0");
+    if (initial_state.rank() == 2 && initial_state.dimensions[1] != 1) {
+        throw std::runtime_error("time evolution needs a pure state (a column vector)");
+    }
+    std::vector<int> dims;
+    for (const auto& op : local_operators_) dims.push_back(op.dimensions[0]);
+    state_ = MatrixProductState::from_dense(initial_state.to_dense().vector_view(), dims, truncation_);
+    peak_state_bytes_ = state_.memory_bytes();
+}
+
+void TimeEvolutionSolver::initialize_state(const MatrixProductState& initial_state) {
+    if (initial_state.num_sites() != static_cast<int>(local_operators_.size())) {
+        throw std::runtime_error("initial state must have one site per local operator");
+    }
+    state_ = initial_state;
+    peak_state_bytes_ = state_.memory_bytes();
 }
 
 void TimeEvolutionSolver::build_network(const std::vector<double>& params) {
@@ -24,164 +65,390 @@ void TimeEvolutionSolver::build_network(const std::vector<double>& params) {
 }
 
 double TimeEvolutionSolver::compute_quantity_of_interest() {
-    auto final_state = network_.get_tensor("psi_final");
-    return final_state.to_matrix().norm();
+    return state_.norm();
+}
+
+Eigen::MatrixXcd TimeEvolutionSolver::local_term(size_t i) const {
+    Tensor::ConstMatrixView h = local_operators_[i].matrix_view();
+    if (i + 1 == local_operators_.size()) return h;
+
+    // on-site term of site i embedded in the (i, i+1) two-site space
+    const Eigen::Index d2 = local_operators_[i + 1].dimensions[0];
+    Eigen::MatrixXcd term = Eigen::MatrixXcd::Zero(h.rows() * d2, h.cols() * d2);
+    for (Eigen::Index r = 0; r < h.rows(); ++r)
+        for (Eigen::Index c = 0; c < h.cols(); ++c)
+            term.block(r * d2, c * d2, d2, d2).diagonal().setConstant(h(r, c));
+    if (i < bond_operators_.size()) term += bond_operators_[i].matrix_view();
+    return term;
+}
+
+double TimeEvolutionSolver::energy() {
+    return energy(state_);
+}
+
+template <typename T>
+double TimeEvolutionSolver::energy(BasicMatrixProductState<T>& state) const {
+    double e = 0.0;
+    const size_t n_sites = local_operators_.size();
+    for (size_t i = 0; i < n_sites; ++i) {
+        Eigen::MatrixXcd term = local_term(i);
+        e += (i + 1 == n_sites) ? state.expectation_one_site(term, i).real()
+                                : state.expectation_two_site(term, i).real();
+    }
+    return e;
 }
 
 void TimeEvolutionSolver::build_trotter_decomposition() {
-    double dt = time_step_ / num_steps_;
-    size_t n_sites = local_operators_.size();
-    
-    // Setup debug log file
-    std::ofstream debug_log;
-    if (!checkpoint_dir_.empty()) {
-        debug_log.open(checkpoint_dir_ + "/debug.log");
-        debug_log << "# Debug log for time evolution\n";
-        debug_log << "# Format: [step] [tensor_name] [indices]\n\n";
+    if (state_.num_sites() != static_cast<int>(local_operators_.size())) {
+        throw std::runtime_error("initialize_state must be called before build_network");
     }
-    
-    // Setup solver data file
-    std::ofstream solver_data;
+    state_.set_execution_context(execution_);
+    if (network_.execution_context().precision() != Precision::mixed) {
+        evolve(state_);
+        return;
+    }
+    // mixed precision keeps the state in complex<float> for the run, so its
+    // contractions are single-precision gemms and it takes half the memory;
+    // gates, svds and measurements stay in double (see mps.hh). the peak
+    // counts the state as the run holds it
+    BasicMatrixProductState<std::complex<float>> single = state_.cast<std::complex<float>>();
+    state_ = MatrixProductState();
+    peak_state_bytes_ = single.memory_bytes();
+    try {
+        evolve(single);
+    } catch (...) {
+        state_ = widen(single);
+        throw;
+    }
+    state_ = widen(single);
+}
+
+template <typename T>
+void TimeEvolutionSolver::evolve(BasicMatrixProductState<T>& state) {
+    using State = BasicMatrixProductState<T>;
+    const double dt = time_step_ / num_steps_;
+    const size_t n_sites = local_operators_.size();
+
+    // solver_data.json and debug.log are written by a background thread;
+    // the loop below only pushes records
+    std::unique_ptr<MetricsSink> metrics;
+    if (!checkpoint_dir_.empty() && metrics_.verbosity != Verbosity::off) {
+        std::ostringstream params;
+        params << "      \"time_step\": " << time_step_ << ",\n";
+        params << "      \"num_steps\": " << num_steps_ << ",\n";
+        params << "      \"dt\": " << dt << ",\n";
+        params << "      \"max_bond_dim\": " << truncation_.max_bond_dim << ",\n";
+        params << "      \"max_discarded_weight\": " << truncation_.max_discarded_weight << ",\n";
+        params << "      \"sample_every\": " << metrics_.sample_every << "\n";
+        metrics = std::make_unique<MetricsSink>(checkpoint_dir_, params.str(), metrics_);
+    }
+
+    // snapshots of the site tensors go into one binary checkpoint per run;
+    // a resumed run appends to it
+    std::unique_ptr<CheckpointWriter> states;
     if (!checkpoint_dir_.empty()) {
-        solver_data.open(checkpoint_dir_ + "/solver_data.json");
-        solver_data << "{\n";
-        solver_data << "  \"time_evolution\": {\n";
-        solver_data << "    \"parameters\": {\n";
-        solver_data << "      \"time_step\": " << time_step_ << ",\n";
-        solver_data << "      \"num_steps\": " << num_steps_ << ",\n";
-        solver_data << "      \"dt\": " << dt << "\n";
-        solver_data << "    },\n";
-        solver_data << "    \"steps\": [\n";
+        states = std::make_unique<CheckpointWriter>(checkpoint_dir_ + "/states.qpsc", checkpoint_compression_,
+                                                    start_step_ > 0);
+        states->set_params(checkpoint_params());
     }
+    CheckpointSchedule schedule(checkpoint_policy_);
     
-    // precompute and add exp_op tensors once
-    for (size_t i = 0; i < n_sites; ++i) {
-        Eigen::MatrixXd H = local_operators_[i].to_matrix();
-        Eigen::MatrixXcd exp_op = (-std::complex<double>(0,1) * (dt/2.0) * H).exp();
-        Tensor exp_tensor = Tensor::from_matrix(exp_op.real(), {"site_" + std::to_string(i), "site_" + std::to_string((i+1)%n_sites)});
-        network_.add_tensor(exp_tensor, "exp_op_" + std::to_string(i));
-        if (debug_log.is_open()) {
-            debug_log << "[init] exp_op_" << i << " indices: ";
-            for (const auto& idx : exp_tensor.indices) debug_log << idx << " ";
-            debug_log << "\n";
+    // profile.json is written next to solver_data.json when profiling is on.
+    // the run records into its own profiler so concurrent runs stay separate
+    const bool profiling = Profiler::enabled() && !checkpoint_dir_.empty();
+    std::unique_ptr<Profiler> run_profile = profiling ? std::make_unique<Profiler>() : nullptr;
+    ProfileScope profile_scope(run_profile.get());
+    const auto run_start = std::chrono::steady_clock::now();
+    // BLAS threading is set once for the run, not per contraction
+    ExecutionScope execution(network_.execution_context());
+
+    // gate i acts on sites (i, i+1) except the last one, which is a one-site
+    // gate. in even/odd order there is one term per bond instead
+    const bool layered = sweep_order_ == SweepOrder::even_odd && n_sites >= 2;
+    const size_t n_gates = layered ? n_sites - 1 : n_sites;
+    std::vector<Eigen::MatrixXcd> terms;
+    for (size_t i = 0; i < n_gates; ++i) {
+        terms.push_back(layered ? bond_term(i) : local_term(i));
+        if (metrics && metrics->wants(Verbosity::step) && propagation_ == PropagationMode::dense) {
+            MetricRecord r;
+            r.kind = MetricRecord::Kind::init;
+            r.site = static_cast<int>(i);
+            r.bond_dim = static_cast<int>(terms.back().rows());
+            metrics->push(r);
         }
     }
-    
-    // main Trotter loop
-    std::string prev_state = "psi_0";
-    for (int step = 0; step < num_steps_; ++step) {
-        double current_time = step * dt;
-        double state_norm = 0.0;
-        double energy = 0.0;
-        std::string current_state = prev_state;
-        
-        // Start JSON step entry
-        if (solver_data.is_open()) {
-            solver_data << "      {\n";
-            solver_data << "        \"step\": " << step << ",\n";
-            solver_data << "        \"time\": " << current_time << ",\n";
-            solver_data << "        \"forward_sweep\": [\n";
+
+    // the gates of a step size are computed once and come from the
+    // propagator cache, so identical terms share one expm
+    std::map<double, std::vector<std::shared_ptr<const Eigen::MatrixXcd>>> gate_sets;
+    auto gates_at = [&](double tau) -> const std::vector<std::shared_ptr<const Eigen::MatrixXcd>>& {
+        auto it = gate_sets.find(tau);
+        if (it == gate_sets.end()) {
+            std::vector<std::shared_ptr<const Eigen::MatrixXcd>> gates;
+            for (const auto& term : terms) gates.push_back(propagators_->get(term, tau, TimeKind::real));
+            it = gate_sets.emplace(tau, std::move(gates)).first;
         }
-        
-        // forward sweep
-        for (size_t i = 0; i < n_sites; ++i) {
-            std::string next_state = "psi_" + std::to_string(step) + "_" + std::to_string(i+1);
-            std::string idx_contract = "site_" + std::to_string(i);
-            if (debug_log.is_open()) {
-                debug_log << "[" << step << "] Before contraction: " << current_state << " indices: ";
-                for (const auto& idx : network_.get_tensor(current_state).indices) debug_log << idx << " ";
-                debug_log << "\n";
-            }
-            auto result = network_.contract(current_state, "exp_op_" + std::to_string(i), {idx_contract});
-            if (debug_log.is_open()) {
-                debug_log << "[" << step << "] After contraction: " << next_state << " indices: ";
-                for (const auto& idx : result.indices) debug_log << idx << " ";
-                debug_log << "\n";
-            }
-            network_.add_tensor(result, next_state);
-            Eigen::MatrixXd state_mat = result.to_matrix();
-            Eigen::MatrixXd H = local_operators_[i].to_matrix();
-            energy += (state_mat.transpose() * H * state_mat).trace();
-            // Log forward sweep data
-            if (solver_data.is_open()) {
-                solver_data << "          {\n";
-                solver_data << "            \"site\": " << i << ",\n";
-                solver_data << "            \"energy\": " << energy << ",\n";
-                solver_data << "            \"state_norm\": " << state_mat.norm() << "\n";
-                solver_data << "          }" << (i < n_sites - 1 ? "," : "") << "\n";
+        return it->second;
+    };
+
+    // a run that is itself a job on a pool (e.g. an EnsembleRunner worker)
+    // defaults to serial layers, since its siblings already fill the cores
+    const size_t sweep_threads = (sweep_threads_ == 0 && ThreadPool::current_worker() >= 0) ? 1 : sweep_threads_;
+    std::unique_ptr<ThreadPool> pool;
+    std::unique_ptr<BlasThreads> blas;
+    if (layered && sweep_threads != 1) {
+        pool = std::make_unique<ThreadPool>(sweep_threads);
+        // the gates of a layer are the parallelism; BLAS stays single threaded
+        blas = std::make_unique<BlasThreads>(1);
+    }
+
+    // advance every bond of one parity by tau, as one concurrent layer
+    auto apply_layer = [&](size_t parity, double tau) {
+        std::vector<typename State::LayerGate> layer;
+        std::vector<KrylovStats> stats(n_gates);
+        for (size_t i = parity; i < n_gates; i += 2) {
+            if (propagation_ == PropagationMode::krylov) {
+                layer.push_back({static_cast<int>(i), [&, i, tau](const Eigen::Ref<const Eigen::MatrixXcd>& block) {
+                    return expmv(terms[i], std::complex<double>(0, -tau), block, krylov_, &stats[i]);
+                }});
+            } else {
+                layer.push_back({static_cast<int>(i), typename State::LocalUpdate(), gates_at(tau)[i].get()});
             }
-            current_state = next_state;
         }
-        if (solver_data.is_open()) {
-            solver_data << "        ],\n";
-            solver_data << "        \"backward_sweep\": [\n";
+        state.apply_layer(layer, truncation_, pool.get());
+        // per-gate counters are merged in bond order, after the layer
+        for (const auto& st : stats) krylov_stats_.merge(st);
+        peak_state_bytes_ = std::max(peak_state_bytes_, state.memory_bytes());
+    };
+
+    // apply gate i for tau, sweeping right (forward) or left (backward)
+    auto apply_gate = [&](int step, size_t i, double tau, bool forward, bool log_gate) {
+        double discarded = 0.0;
+        if (propagation_ == PropagationMode::krylov) {
+            // exp(-i tau T_i) applied to the local block without forming it
+            auto update = [&](const Eigen::Ref<const Eigen::MatrixXcd>& block) {
+                return expmv(terms[i], std::complex<double>(0, -tau), block, krylov_, &krylov_stats_);
+            };
+            if (i + 1 == n_sites) {
+                state.apply_one_site(update, i);
+            } else {
+                discarded = state.apply_two_site(update, i, truncation_, forward);
+            }
+        } else if (i + 1 == n_sites) {
+            state.apply_one_site_gate(*gates_at(tau)[i], i);
+        } else {
+            discarded = state.apply_two_site_gate(*gates_at(tau)[i], i, truncation_, forward);
         }
-        // backward sweep
-        for (int i = n_sites - 1; i >= 0; --i) {
-            std::string next_state = (i == 0) ? "psi_" + std::to_string(step + 1) : "psi_" + std::to_string(step) + "_" + std::to_string(i);
-            std::string idx_contract = "site_" + std::to_string(i);
-            if (debug_log.is_open()) {
-                debug_log << "[" << step << "] Before backward contraction: " << current_state << " indices: ";
-                for (const auto& idx : network_.get_tensor(current_state).indices) debug_log << idx << " ";
-                debug_log << "\n";
+        peak_state_bytes_ = std::max(peak_state_bytes_, state.memory_bytes());
+        // per-gate measurements are only paid for when they are logged
+        if constexpr (verbosity_compiled_in<Verbosity::gate>) {
+            if (log_gate) {
+                MetricRecord r;
+                r.kind = MetricRecord::Kind::gate;
+                r.step = step;
+                r.site = static_cast<int>(i);
+                r.span = (i + 1 == n_sites) ? 1 : 2;
+                r.forward = forward;
+                r.measured = true;
+                r.energy = (i + 1 == n_sites)
+                    ? state.expectation_one_site(terms[i], i).real()
+                    : state.expectation_two_site(terms[i], i).real();
+                r.norm = state.norm();
+                r.bond_dim = state.max_bond_dim();
+                r.discarded = discarded;
+                metrics->push(r);
             }
-            auto result = network_.contract(current_state, "exp_op_" + std::to_string(i), {idx_contract});
-            if (debug_log.is_open()) {
-                debug_log << "[" << step << "] After backward contraction: " << next_state << " indices: ";
-                for (const auto& idx : result.indices) debug_log << idx << " ";
-                debug_log << "\n";
+        }
+    };
+
+    // one step is a sequence of sweeps F(w_0 h) B(w_1 h) F(w_2 h) ... (see
+    // integrator.hh). in even/odd order F is the even layer then the odd one
+    // and B the reverse; neighbouring layers of one parity are merged, so
+    // strang becomes even h/2, odd h, even h/2
+    const std::vector<double> weights = sweep_weights(integrator_);
+    std::vector<std::pair<size_t, double>> layers;
+    for (size_t k = 0; k < weights.size(); ++k) {
+        const size_t first = (k % 2 == 0) ? 0 : 1;
+        for (size_t parity : {first, 1 - first}) {
+            if (!layers.empty() && layers.back().first == parity) {
+                layers.back().second += weights[k];
+            } else {
+                layers.emplace_back(parity, weights[k]);
             }
-            network_.add_tensor(result, next_state);
-            Eigen::MatrixXd state_mat = result.to_matrix();
-            Eigen::MatrixXd H = local_operators_[i].to_matrix();
-            energy += (state_mat.transpose() * H * state_mat).trace();
-            // Log backward sweep data
-            if (solver_data.is_open()) {
-                solver_data << "          {\n";
-                solver_data << "            \"site\": " << i << ",\n";
-                solver_data << "            \"energy\": " << energy << ",\n";
-                solver_data << "            \"state_norm\": " << state_mat.norm() << "\n";
-                solver_data << "          }" << (i > 0 ? "," : "") << "\n";
+        }
+    }
+    auto advance = [&](int step, double h, bool log_gates) {
+        if (layered) {
+            for (const auto& layer : layers) apply_layer(layer.first, layer.second * h);
+            return;
+        }
+        for (size_t k = 0; k < weights.size(); ++k) {
+            const double tau = weights[k] * h;
+            if (k % 2 == 0) {
+                for (size_t i = 0; i < n_sites; ++i) apply_gate(step, i, tau, true, log_gates);
+            } else {
+                for (int i = n_sites - 1; i >= 0; --i) apply_gate(step, i, tau, false, log_gates);
             }
-            current_state = next_state;
         }
-        prev_state = current_state;
-        auto state = network_.get_tensor(prev_state);
-        state_norm = state.to_matrix().norm();
-        // Save state to file
-        if (!checkpoint_dir_.empty()) {
-            std::string state_file = checkpoint_dir_ + "/state_" + std::to_string(step + 1) + ".txt";
-            std::ofstream state_out(state_file);
-            if (state_out.is_open()) {
-                state_out << state.to_matrix();
-                state_out.close();
+    };
+
+    auto log_step_record = [&](int step, double time) {
+        MetricRecord r;
+        r.kind = MetricRecord::Kind::step;
+        r.step = step;
+        r.time = time;
+        r.measured = true;
+        r.energy = energy(state);
+        r.norm = state.norm();
+        r.bond_dim = state.max_bond_dim();
+        r.truncation_error = state.truncation_error();
+        metrics->push(r);
+    };
+    // Save state to the checkpoint, full precision. written after the
+    // measurements, so a resumed run continues in the same gauge
+    auto write_snapshot = [&](int step, double time, double next_h) {
+        for (int i = 0; i < state.num_sites(); ++i) {
+            states->write("site_" + std::to_string(i), widen(state.site(i)), step + 1, time);
+        }
+        // orthogonality center, accumulated truncation error and the next
+        // trial step of an adaptive run
+        Eigen::VectorXcd meta(3);
+        meta << static_cast<double>(state.center()), state.truncation_error(), next_h;
+        states->write("mps_meta", Tensor::from_vector(meta), step + 1, time);
+        states->commit(step + 1, time);
+    };
+
+    // the observables see the state after the step, like the snapshots
+    auto observe = [&](int step, double time, bool last) {
+        if (observables_.empty() || ((step + 1) % observe_every_ != 0 && !last)) return;
+        measurements_.push_back({step, time, observables_.measure(widen(state))});
+    };
+
+    step_sizes_.clear();
+    rejected_steps_ = 0;
+    measurements_.clear();
+    if (adaptive_.enabled) {
+        // step doubling: one step of h against two of h/2. the two half
+        // steps are kept, and their difference sets the next h
+        const int order = integrator_order(integrator_);
+        const double end = time_step_;
+        double t = start_time_;
+        double h = start_step_size_ > 0.0 ? start_step_size_ : dt;
+        for (int step = start_step_; t < end * (1.0 - 1e-12); ) {
+            h = std::min(h, end - t);
+            const bool last = t + h >= end * (1.0 - 1e-12);
+            ScopedTimer step_timer(Phase::step);
+            gate_sets.clear();  // each trial h has its own gates
+            State before = state;
+            advance(step, h, false);
+            State coarse = std::move(state);
+            state = before;
+            advance(step, h / 2.0, false);
+            advance(step, h / 2.0, false);
+            const double diff2 = coarse.norm() * coarse.norm() + state.norm() * state.norm()
+                               - 2.0 * state.overlap(coarse).real();
+            const double error = std::sqrt(std::max(0.0, diff2));
+            const double next_h = adapt_step(adaptive_, order, h, error);
+            if (error > adaptive_.tolerance && h > adaptive_.min_step) {
+                state = std::move(before);
+                ++rejected_steps_;
+                h = next_h;
+                continue;
             }
+            const bool log_step = metrics && ((metrics->wants(Verbosity::step) && metrics->sampled(step, last)) ||
+                                              (metrics->wants(Verbosity::summary) && last));
+            if (log_step) log_step_record(step, t);
+            t = last ? end : t + h;
+            step_sizes_.push_back(h);
+            observe(step, t, last);
+            if (states && schedule.due(step, last)) write_snapshot(step, t, next_h);
+            h = next_h;
+            ++step;
         }
-        // Complete JSON step entry
-        if (solver_data.is_open()) {
-            solver_data << "        ],\n";
-            solver_data << "        \"total_energy\": " << energy << ",\n";
-            solver_data << "        \"state_norm\": " << state_norm << ",\n";
-            solver_data << "        \"state_file\": \"state_" << step + 1 << ".txt\"\n";
-            solver_data << "      }" << (step < num_steps_ - 1 ? "," : "") << "\n";
+    } else {
+        // fixed steps; with the strang integrator the forward sweep followed
+        // by the mirrored backward sweep is a symmetric (second order)
+        // product of half-step gates
+        for (int step = start_step_; step < num_steps_; ++step) {
+            const bool last = step + 1 == num_steps_;
+            const bool log_step = metrics && ((metrics->wants(Verbosity::step) && metrics->sampled(step, last)) ||
+                                              (metrics->wants(Verbosity::summary) && last));
+            const bool log_gates = log_step && metrics->wants(Verbosity::gate) && !layered;
+            ScopedTimer step_timer(Phase::step);
+            advance(step, dt, log_gates);
+            step_sizes_.push_back(dt);
+            if (log_step) log_step_record(step, step * dt);
+            observe(step, (step + 1) * dt, last);
+            if (states && schedule.due(step, last)) write_snapshot(step, (step + 1) * dt, dt);
         }
     }
-    // rename the last state to psi_final
-    network_.add_tensor(network_.get_tensor(prev_state), "psi_final");
-    // Close JSON file
-    if (solver_data.is_open()) {
-        solver_data << "    ]\n";
-        solver_data << "  }\n";
-        solver_data << "}\n";
-        solver_data.close();
+    start_step_ = 0;
+    start_time_ = 0.0;
+    start_step_size_ = 0.0;
+    if (metrics) metrics->close();
+    if (profiling) write_profile(checkpoint_dir_, "tebd", *run_profile, run_start);
+}
+
+Eigen::MatrixXcd TimeEvolutionSolver::bond_term(size_t i) const {
+    Eigen::MatrixXcd term = local_term(i);
+    if (i + 2 == local_operators_.size()) {
+        // 1 (x) h_{N-1}: the last on-site term has no bond of its own
+        Tensor::ConstMatrixView h = local_operators_[i + 1].matrix_view();
+        const Eigen::Index d2 = h.rows();
+        for (Eigen::Index r = 0; r < term.rows() / d2; ++r) term.block(r * d2, r * d2, d2, d2) += h;
     }
-    if (debug_log.is_open()) {
-        debug_log.close();
+    return term;
+}
+
+std::string TimeEvolutionSolver::checkpoint_params() const {
+    std::ostringstream params;
+    params << std::setprecision(17) << "{\"solver\": \"tebd\", \"time_step\": " << time_step_
+           << ", \"num_steps\": " << num_steps_ << ", \"dt\": " << time_step_ / num_steps_
+           << ", \"max_bond_dim\": " << truncation_.max_bond_dim
+           << ", \"max_discarded_weight\": " << truncation_.max_discarded_weight
+           << ", \"integrator\": \"" << integrator_name(integrator_) << "\"";
+    if (adaptive_.enabled) params << ", \"adaptive_tolerance\": " << adaptive_.tolerance;
+    params << "}";
+    return params.str();
+}
+
+bool TimeEvolutionSolver::resume() {
+    const std::string path = checkpoint_dir_ + "/states.qpsc";
+    if (checkpoint_dir_.empty() || !std::filesystem::exists(path)) return false;
+    CheckpointReader reader(path);
+    const int commit = reader.last_commit();
+    if (commit < 0) return false;
+    const CheckpointRecord& marker = reader.records()[commit];
+    if (marker.params != checkpoint_params()) {
+        throw std::runtime_error("checkpoint was written with different solver parameters");
+    }
+
+    std::vector<Tensor> sites;
+    for (size_t i = 0; i < local_operators_.size(); ++i) {
+        sites.push_back(read_snapshot(reader, commit, "site_" + std::to_string(i)));
+        if (sites.back().dimensions[1] != local_operators_[i].dimensions[0]) {
+            throw std::runtime_error("checkpoint state does not match the local operators");
+        }
     }
+    Tensor meta = read_snapshot(reader, commit, "mps_meta");
+    state_ = MatrixProductState::from_sites(std::move(sites), static_cast<int>(meta.data(0).real()),
+                                            meta.data(1).real());
+    // an adaptive run continues from the committed time and trial step
+    start_time_ = marker.time;
+    start_step_size_ = meta.data.size() > 2 ? meta.data(2).real() : 0.0;
+    peak_state_bytes_ = state_.memory_bytes();
+    start_step_ = static_cast<int>(marker.step);
+    return true;
 }
 
 void ThermalSolver::initialize_state(const Tensor& initial_state) {
-    network_.add_tensor(initial_state, "rho_0");
+    if (initial_state.rank() != 2) {
+        throw std::runtime_error("thermal state must be a density matrix");
+    }
+    // rho is updated in place for the whole run
+    Tensor rho = initial_state.to_dense();
+    rho.indices = {"site", "col"};
+    network_.set_tensor("rho", std::move(rho));
 }
 
 void ThermalSolver::build_network(const std::vector<double>& params) {
@@ -189,62 +456,91 @@ void ThermalSolver::build_network(const std::vector<double>& params) {
 }
 
 double ThermalSolver::compute_quantity_of_interest() {
-    auto final_state = network_.get_tensor("rho_final");
-    return final_state.to_matrix().trace();
+    return network_.get_tensor("rho").matrix_view().trace().real();
 }
 
 void ThermalSolver::build_imaginary_time_evolution() {
     double dbeta = beta_ / num_steps_;
+    const IndexId site("site"), site_out("site_out"), col("col");
+    if (!network_.contains("rho")) {
+        throw std::runtime_error("initialize_state must be called before build_network");
+    }
+    TensorHandle rho = network_.handle("rho");
     
     // initialize logging
     std::ofstream log_file;
+    // a resumed run appends to the log and the checkpoint
+    const bool resumed = start_step_ > 0;
+    if (!checkpoint_dir_.empty()) {
+        log_file.open(checkpoint_dir_ + "/thermal_log.txt", resumed ? std::ios::app : std::ios::out);
+        if (!resumed) log_file << "# step beta trace energy state_file\n";
+    }
+    std::unique_ptr<CheckpointWriter> states;
     if (!checkpoint_dir_.empty()) {
-        log_file.open(checkpoint_dir_ + "/thermal_log.txt");
-        log_file << "# step beta trace energy state_file\n";
+        states = std::make_unique<CheckpointWriter>(checkpoint_dir_ + "/states.qpsc", checkpoint_compression_,
+                                                    resumed);
+        states->set_params(checkpoint_params());
+    }
+    CheckpointSchedule schedule(checkpoint_policy_);
+    const bool profiling = Profiler::enabled() && !checkpoint_dir_.empty();
+    std::unique_ptr<Profiler> run_profile = profiling ? std::make_unique<Profiler>() : nullptr;
+    ProfileScope profile_scope(run_profile.get());
+    const auto run_start = std::chrono::steady_clock::now();
+    ExecutionScope execution(network_.execution_context());
+
+    // e^{-dbeta H_i} does not depend on the step, so it is registered once
+    // (dense mode only; krylov mode applies it to rho directly)
+    // a sparse H_i is applied through its nonzeros
+    std::vector<TensorHandle> exp_ops;
+    std::vector<LinearMap> hamiltonians;
+    for (size_t i = 0; i < local_operators_.size(); ++i) {
+        if (propagation_ == PropagationMode::krylov) {
+            hamiltonians.push_back(operator_map(local_operators_[i]));
+            continue;
+        }
+        auto exp_op = propagators_->get(local_operators_[i].to_matrix(), dbeta, TimeKind::imaginary);
+        exp_ops.push_back(network_.set_tensor("exp_op_" + std::to_string(i),
+                                              Tensor::from_matrix(*exp_op, {site_out, site})));
     }
     
-    for (int step = 0; step < num_steps_; ++step) {
-        double current_beta = step * dbeta;
-        double trace = 0.0;
-        double energy = 0.0;
+    for (int step = start_step_; step < num_steps_; ++step) {
+        ScopedTimer step_timer(Phase::step);
+        double current_beta = (step + 1) * dbeta;
         
-        for (size_t i = 0; i < local_operators_.size(); ++i) {
-            // get matrix from tensor
-            Eigen::MatrixXd H = local_operators_[i].to_matrix();
-            
-            // compute e^{-betaH}
-            Eigen::MatrixXd exp_op = (-dbeta * H).exp();
-            
-            // convert back to tensor and add to network
-            Tensor exp_tensor = Tensor::from_matrix(exp_op,
-                {"site_" + std::to_string(i), "site_" + std::to_string(i+1)});
-            network_.add_tensor(exp_tensor, "exp_op_" + std::to_string(i));
-            
-            std::string current_state = (step == 0) ? "rho_0" : 
-                                      "rho_" + std::to_string(step);
-            std::string next_state = "rho_" + std::to_string(step + 1);
-            
-            auto result = network_.contract(current_state, "exp_op_" + std::to_string(i),
-                                         {"site_" + std::to_string(i)});
-            network_.add_tensor(result, next_state);
-            
-            // compute local energy contribution
-            Eigen::MatrixXd state_mat = result.to_matrix();
-            energy += (state_mat.transpose() * H * state_mat).trace();
+        double trace = 1.0;
+        const size_t n_ops = local_operators_.size();
+        for (size_t i = 0; i < n_ops; ++i) {
+            Tensor result;
+            if (propagation_ == PropagationMode::krylov) {
+                result = Tensor::from_matrix(expmv(hamiltonians[i], -dbeta,
+                                                  network_.get_tensor(rho).matrix_view(),
+                                                  krylov_, &krylov_stats_),
+                                            {site, col});
+            } else {
+                result = network_.contract(exp_ops[i], rho, {site});
+                result.indices[0] = site;
+            }
+            if (i + 1 == n_ops) {
+                // keep tr(rho) = 1 so long runs neither overflow nor underflow
+                Tensor::MatrixView m = result.matrix_view();
+                trace = m.trace().real();
+                m /= trace;
+            }
+            network_.update_tensor(rho, std::move(result));
         }
         
-        // compute state trace
-        auto state = network_.get_tensor("rho_" + std::to_string(step + 1));
-        trace = state.to_matrix().trace();
-        
         // log data
         if (!checkpoint_dir_.empty()) {
+            Tensor::ConstMatrixView state_mat = network_.get_tensor(rho).matrix_view();
+            double energy = 0.0;
+            for (const auto& op : local_operators_) {
+                energy += trace_product(op, state_mat).real();
+            }
+
             // save state
-            std::string state_file = checkpoint_dir_ + "/state_" + std::to_string(step + 1) + ".txt";
-            std::ofstream state_out(state_file);
-            if (state_out.is_open()) {
-                state_out << state.to_matrix();
-                state_out.close();
+            if (schedule.due(step, step + 1 == num_steps_)) {
+                states->write("rho", network_.get_tensor(rho), step + 1, current_beta);
+                states->commit(step + 1, current_beta);
             }
             
             // log metrics
@@ -253,17 +549,370 @@ void ThermalSolver::build_imaginary_time_evolution() {
                     << current_beta << " "
                     << trace << " "
                     << energy << " "
-                    << "state_" << step + 1 << ".txt\n";
+                    << "states.qpsc\n";
         }
     }
     
+    start_step_ = 0;
     if (!checkpoint_dir_.empty()) {
         log_file.close();
     }
+    if (profiling) write_profile(checkpoint_dir_, "thermal", *run_profile, run_start);
+}
+
+std::string ThermalSolver::checkpoint_params() const {
+    std::ostringstream params;
+    params << std::setprecision(17) << "{\"solver\": \"thermal\", \"beta\": " << beta_
+           << ", \"num_steps\": " << num_steps_ << ", \"dbeta\": " << beta_ / num_steps_ << "}";
+    return params.str();
+}
+
+bool ThermalSolver::resume() {
+    const std::string path = checkpoint_dir_ + "/states.qpsc";
+    if (checkpoint_dir_.empty() || !std::filesystem::exists(path)) return false;
+    CheckpointReader reader(path);
+    const int commit = reader.last_commit();
+    if (commit < 0) return false;
+    const CheckpointRecord& marker = reader.records()[commit];
+    if (marker.params != checkpoint_params()) {
+        throw std::runtime_error("checkpoint was written with different solver parameters");
+    }
+    Tensor rho = read_snapshot(reader, commit, "rho");
+    rho.indices = {"site", "col"};
+    network_.set_tensor("rho", std::move(rho));
+    start_step_ = static_cast<int>(marker.step);
+    return true;
+}
+
+// dmrg environments are rank-3 tensors (ket bond, mpo bond, bra bond); mpo
+// tensors are (left, right, out, in). the contractions run in the solver's
+// execution context, which may do their gemms in mixed precision
+static Tensor grow_left(const Tensor& env, const Tensor& site, const Tensor& w,
+                        const ExecutionContext& ctx) {
+    Tensor t = contract_tensors(env, site, {{0, 0}}, ctx);            // (w, b, s, k')
+    t = contract_tensors(t, w, {{0, 0}, {2, 3}}, ctx);                // (b, k', w', t)
+    return contract_tensors(t, site.conj(), {{0, 0}, {3, 1}}, ctx);   // (k', w', b')
+}
+
+static Tensor grow_right(const Tensor& env, const Tensor& site, const Tensor& w,
+                        const ExecutionContext& ctx) {
+    Tensor t = contract_tensors(site, env, {{2, 0}}, ctx);            // (k, s, w, b)
+    t = contract_tensors(t, w, {{1, 3}, {2, 1}}, ctx);                // (k, b, w', t)
+    return contract_tensors(t, site.conj(), {{1, 2}, {3, 1}}, ctx);   // (k, w', b')
+}
+
+// effective hamiltonian on a two-site block theta (l, s1, s2, r)
+static Tensor apply_two_site_heff(const Tensor& left, const Tensor& w1, const Tensor& w2,
+                                  const Tensor& right, const Tensor& theta,
+                                  const ExecutionContext& ctx) {
+    Tensor t = contract_tensors(left, theta, {{0, 0}}, ctx);          // (w, b, s1, s2, r)
+    t = contract_tensors(t, w1, {{0, 0}, {2, 3}}, ctx);               // (b, s2, r, w', t1)
+    t = contract_tensors(t, w2, {{3, 0}, {1, 3}}, ctx);               // (b, r, t1, w'', t2)
+    return contract_tensors(t, right, {{1, 0}, {3, 1}}, ctx);         // (b, t1, t2, b')
+}
+
+// effective hamiltonian on one site tensor theta (l, s, r)
+static Tensor apply_one_site_heff(const Tensor& left, const Tensor& w, const Tensor& right,
+                                  const Tensor& theta, const ExecutionContext& ctx) {
+    Tensor t = contract_tensors(left, theta, {{0, 0}}, ctx);          // (w, b, s, r)
+    t = contract_tensors(t, w, {{0, 0}, {2, 3}}, ctx);                // (b, r, w', t)
+    return contract_tensors(t, right, {{1, 0}, {2, 1}}, ctx);         // (b, t, b')
+}
+
+static size_t tensors_bytes(const std::vector<Tensor>& tensors) {
+    size_t bytes = 0;
+    for (const Tensor& t : tensors) bytes += t.data.size() * sizeof(Tensor::Scalar);
+    return bytes;
+}
+
+void DMRGSolver::initialize_state(const Tensor& initial_state) {
+    if (initial_state.rank() == 2 && initial_state.dimensions[1] != 1) {
+        throw std::runtime_error("dmrg needs a pure start state (a column vector)");
+    }
+    std::vector<int> dims;
+    for (const auto& op : local_operators_) dims.push_back(op.dimensions[0]);
+    state_ = MatrixProductState::from_dense(initial_state.to_dense().vector_view(), dims, truncation_);
+}
+
+void DMRGSolver::initialize_state(const MatrixProductState& initial_state) {
+    if (initial_state.num_sites() != static_cast<int>(local_operators_.size())) {
+        throw std::runtime_error("initial state must have one site per local operator");
+    }
+    state_ = initial_state;
+}
+
+void DMRGSolver::build_network(const std::vector<double>& params) {
+    run_sweeps();
+}
+
+void DMRGSolver::build_mpo() {
+    const int n = static_cast<int>(local_operators_.size());
+    auto dim = [&](int i) { return local_operators_[i].dimensions[0]; };
+
+    // each bond term as a sum of products sum_k a_k (x) b_k, from the svd of
+    // its elements regrouped as ((s1, t1), (s2, t2))
+    std::vector<std::vector<Eigen::MatrixXcd>> first(n), second(n);
+    for (int i = 0; i + 1 < n && i < static_cast<int>(bond_operators_.size()); ++i) {
+        const int d1 = dim(i), d2 = dim(i + 1);
+        const Tensor& op = bond_operators_[i];
+        Tensor::ConstMatrixView b = op.matrix_view();
+        if (b.rows() != d1 * d2 || b.cols() != d1 * d2) {
+            throw std::runtime_error("bond operator does not match the local dimensions");
+        }
+        Eigen::MatrixXcd m(d1 * d1, d2 * d2);
+        for (int s1 = 0; s1 < d1; ++s1)
+            for (int t1 = 0; t1 < d1; ++t1)
+                for (int s2 = 0; s2 < d2; ++s2)
+                    for (int t2 = 0; t2 < d2; ++t2)
+                        m(s1 + d1 * t1, s2 + d2 * t2) = b(s1 * d2 + s2, t1 * d2 + t2);
+        Eigen::BDCSVD<Eigen::MatrixXcd> svd(m, Eigen::ComputeThinU | Eigen::ComputeThinV);
+        const Eigen::VectorXd& sv = svd.singularValues();
+        for (Eigen::Index k = 0; k < sv.size() && sv(k) > 1e-13 * sv(0); ++k) {
+            const double root = std::sqrt(sv(k));
+            Eigen::VectorXcd u = root * svd.matrixU().col(k);
+            Eigen::VectorXcd v = root * svd.matrixV().col(k).conjugate();
+            first[i].push_back(Eigen::Map<Eigen::MatrixXcd>(u.data(), d1, d1));
+            second[i + 1].push_back(Eigen::Map<Eigen::MatrixXcd>(v.data(), d2, d2));
+        }
+    }
+
+    // mpo bond states: 0 before any term, 1..K inside bond term k, last after
+    mpo_.clear();
+    for (int i = 0; i < n; ++i) {
+        const int d = dim(i);
+        const int wl = 2 + static_cast<int>(second[i].size());
+        const int wr = 2 + static_cast<int>(first[i].size());
+        Tensor w({wl, wr, d, d}, {"w_l", "w_r", "out", "in"});
+        auto place = [&](int a, int b, const Eigen::Ref<const Eigen::MatrixXcd>& op) {
+            for (int out = 0; out < d; ++out)
+                for (int in = 0; in < d; ++in) w.data(a, b, out, in) = op(out, in);
+        };
+        const Eigen::MatrixXcd id = Eigen::MatrixXcd::Identity(d, d);
+        place(0, 0, id);
+        place(wl - 1, wr - 1, id);
+        place(0, wr - 1, local_operators_[i].matrix_view());
+        for (size_t k = 0; k < first[i].size(); ++k) place(0, 1 + k, first[i][k]);
+        for (size_t k = 0; k < second[i].size(); ++k) place(1 + k, wr - 1, second[i][k]);
+        mpo_.push_back(std::move(w));
+    }
+}
+
+double DMRGSolver::update_two_site(int i, bool sweep_right) {
+    const ExecutionContext& ctx = network_.execution_context();
+    Tensor theta = contract_tensors(sites_[i], sites_[i + 1], {{2, 0}});  // (l, s1, s2, r)
+    const LinearMap heff = [&](const Eigen::MatrixXcd& x, Eigen::MatrixXcd& y) {
+        theta.vector_view() = x;
+        y = apply_two_site_heff(left_[i], mpo_[i], mpo_[i + 1], right_[i + 1], theta, ctx).vector_view();
+    };
+    Eigen::MatrixXcd v = theta.vector_view();
+    energy_ = lowest_eigenpair(heff, v, params_.eigensolver, &krylov_stats_);
+    theta.vector_view() = v;
+
+    const int dl = theta.dimensions[0], d1 = theta.dimensions[1];
+    const int d2 = theta.dimensions[2], dr = theta.dimensions[3];
+    Eigen::BDCSVD<Eigen::MatrixXcd> svd;
+    {
+        ScopedTimer timer(Phase::svd);
+        svd.compute(theta.matrix_view(2), Eigen::ComputeThinU | Eigen::ComputeThinV);
+    }
+    double discarded = 0.0;
+    const int keep = truncation_rank(svd.singularValues(), truncation_, discarded);
+    Eigen::VectorXd s = svd.singularValues().head(keep);
+    s /= s.norm();
+    const auto weights = s.cast<std::complex<double>>().asDiagonal();
+
+    // the singular values go to the site the center moves onto
+    Tensor a({dl, d1, keep}, {"l", "s", "r"});
+    Tensor b({keep, d2, dr}, {"l", "s", "r"});
+    if (sweep_right) {
+        a.matrix_view(2) = svd.matrixU().leftCols(keep);
+        b.matrix_view(1) = weights * svd.matrixV().leftCols(keep).adjoint();
+    } else {
+        a.matrix_view(2) = svd.matrixU().leftCols(keep) * weights;
+        b.matrix_view(1) = svd.matrixV().leftCols(keep).adjoint();
+    }
+    sites_[i] = std::move(a);
+    sites_[i + 1] = std::move(b);
+    if (sweep_right) {
+        left_[i + 1] = grow_left(left_[i], sites_[i], mpo_[i], ctx);
+    } else {
+        right_[i] = grow_right(right_[i + 1], sites_[i + 1], mpo_[i + 1], ctx);
+    }
+    return discarded;
+}
+
+double DMRGSolver::update_one_site(int i, bool sweep_right) {
+    const ExecutionContext& ctx = network_.execution_context();
+    Tensor theta = sites_[i];  // (l, s, r)
+    const LinearMap heff = [&](const Eigen::MatrixXcd& x, Eigen::MatrixXcd& y) {
+        theta.vector_view() = x;
+        y = apply_one_site_heff(left_[i], mpo_[i], right_[i], theta, ctx).vector_view();
+    };
+    Eigen::MatrixXcd v = theta.vector_view();
+    energy_ = lowest_eigenpair(heff, v, params_.eigensolver, &krylov_stats_);
+    theta.vector_view() = v;
+
+    const int n = static_cast<int>(sites_.size());
+    if ((sweep_right && i + 1 == n) || (!sweep_right && i == 0)) {
+        sites_[i] = std::move(theta);
+        return 0.0;
+    }
+    // split off the center and move it onto the neighbour
+    const int dl = theta.dimensions[0], d = theta.dimensions[1], dr = theta.dimensions[2];
+    Eigen::BDCSVD<Eigen::MatrixXcd> svd;
+    {
+        ScopedTimer timer(Phase::svd);
+        svd.compute(theta.matrix_view(sweep_right ? 2 : 1), Eigen::ComputeThinU | Eigen::ComputeThinV);
+    }
+    double discarded = 0.0;
+    const int keep = truncation_rank(svd.singularValues(), truncation_, discarded);
+    Eigen::VectorXd s = svd.singularValues().head(keep);
+    s /= s.norm();
+    const auto weights = s.cast<std::complex<double>>().asDiagonal();
+
+    if (sweep_right) {
+        Tensor a({dl, d, keep}, {"l", "s", "r"});
+        a.matrix_view(2) = svd.matrixU().leftCols(keep);
+        const Tensor& next = sites_[i + 1];
+        Tensor b({keep, next.dimensions[1], next.dimensions[2]}, {"l", "s", "r"});
+        b.matrix_view(1) = weights * svd.matrixV().leftCols(keep).adjoint() * next.matrix_view(1);
+        sites_[i] = std::move(a);
+        sites_[i + 1] = std::move(b);
+        left_[i + 1] = grow_left(left_[i], sites_[i], mpo_[i], ctx);
+    } else {
+        Tensor b({keep, d, dr}, {"l", "s", "r"});
+        b.matrix_view(1) = svd.matrixV().leftCols(keep).adjoint();
+        const Tensor& prev = sites_[i - 1];
+        Tensor a({prev.dimensions[0], prev.dimensions[1], keep}, {"l", "s", "r"});
+        a.matrix_view(2) = prev.matrix_view(2) * svd.matrixU().leftCols(keep) * weights;
+        sites_[i - 1] = std::move(a);
+        sites_[i] = std::move(b);
+        right_[i - 1] = grow_right(right_[i], sites_[i], mpo_[i], ctx);
+    }
+    return discarded;
+}
+
+void DMRGSolver::run_sweeps() {
+    const int n = static_cast<int>(local_operators_.size());
+    if (state_.num_sites() != n) {
+        throw std::runtime_error("initialize_state must be called before build_network");
+    }
+
+    std::unique_ptr<CheckpointWriter> states;
+    if (!checkpoint_dir_.empty()) {
+        states = std::make_unique<CheckpointWriter>(checkpoint_dir_ + "/states.qpsc", checkpoint_compression_,
+                                                    start_step_ > 0);
+        states->set_params(checkpoint_params());
+    }
+    CheckpointSchedule schedule(checkpoint_policy_);
+    const bool profiling = Profiler::enabled() && !checkpoint_dir_.empty();
+    std::unique_ptr<Profiler> run_profile = profiling ? std::make_unique<Profiler>() : nullptr;
+    ProfileScope profile_scope(run_profile.get());
+    const auto run_start = std::chrono::steady_clock::now();
+    ExecutionScope execution(network_.execution_context());
+
+    build_mpo();
+    // sweeps start at site 0 with every other site right-orthonormal
+    state_.move_center(0);
+    sites_.clear();
+    for (int i = 0; i < n; ++i) sites_.push_back(state_.site(i));
+    double truncation_error = state_.truncation_error();
+
+    left_.assign(n, Tensor());
+    right_.assign(n, Tensor());
+    left_[0] = Tensor({1, mpo_[0].dimensions[0], 1}, {"k", "w", "b"});
+    left_[0].data(0, 0, 0) = 1.0;
+    const int w_last = mpo_[n - 1].dimensions[1] - 1;
+    right_[n - 1] = Tensor({1, w_last + 1, 1}, {"k", "w", "b"});
+    right_[n - 1].data(0, w_last, 0) = 1.0;
+    const ExecutionContext& ctx = network_.execution_context();
+    for (int i = n - 1; i > 0; --i) right_[i - 1] = grow_right(right_[i], sites_[i], mpo_[i], ctx);
+
+    const bool two_site = params_.update == DMRGUpdate::two_site && n > 1;
+    sweep_energies_.clear();
+    sweep_truncation_.clear();
+    converged_ = false;
+    // a resumed run compares its first sweep with the checkpointed energy
+    double previous = start_step_ > 0 ? energy_ : std::nan("");
+    for (int sweep = start_step_; sweep < params_.max_sweeps; ++sweep) {
+        ScopedTimer step_timer(Phase::step);
+        double worst = 0.0;
+        auto record = [&](double discarded) {
+            worst = std::max(worst, discarded);
+            truncation_error += discarded;
+        };
+        if (two_site) {
+            for (int i = 0; i + 1 < n; ++i) record(update_two_site(i, true));
+            for (int i = n - 2; i >= 0; --i) record(update_two_site(i, false));
+        } else {
+            for (int i = 0; i < std::max(1, n - 1); ++i) record(update_one_site(i, true));
+            for (int i = n - 1; i > 0; --i) record(update_one_site(i, false));
+        }
+        sweep_energies_.push_back(energy_);
+        sweep_truncation_.push_back(worst);
+        peak_bytes_ = std::max(peak_bytes_, tensors_bytes(sites_) + tensors_bytes(left_) +
+                                                tensors_bytes(right_) + tensors_bytes(mpo_));
+
+        converged_ = sweep + 1 - start_step_ >= params_.min_sweeps &&
+                     std::abs(energy_ - previous) <= params_.energy_tolerance &&
+                     worst <= params_.truncation_tolerance;
+        previous = energy_;
+        if (states && (schedule.due(sweep, sweep + 1 == params_.max_sweeps) || converged_)) {
+            for (int i = 0; i < n; ++i) {
+                states->write("site_" + std::to_string(i), sites_[i], sweep + 1, 0.0);
+            }
+            // orthogonality center, accumulated truncation error and energy
+            Eigen::VectorXcd meta(3);
+            meta << 0.0, truncation_error, energy_;
+            states->write("mps_meta", Tensor::from_vector(meta), sweep + 1, 0.0);
+            states->commit(sweep + 1, 0.0);
+        }
+        if (converged_) break;
+    }
+    // every sweep ends with the center back on site 0
+    state_ = MatrixProductState::from_sites(sites_, 0, truncation_error);
+    start_step_ = 0;
+    if (profiling) write_profile(checkpoint_dir_, "dmrg", *run_profile, run_start);
+}
+
+std::string DMRGSolver::checkpoint_params() const {
+    std::ostringstream params;
+    params << std::setprecision(17) << "{\"solver\": \"dmrg\", \"max_bond_dim\": " << truncation_.max_bond_dim
+           << ", \"max_discarded_weight\": " << truncation_.max_discarded_weight << ", \"update\": \""
+           << (params_.update == DMRGUpdate::two_site ? "two_site" : "single_site") << "\"}";
+    return params.str();
+}
+
+bool DMRGSolver::resume() {
+    const std::string path = checkpoint_dir_ + "/states.qpsc";
+    if (checkpoint_dir_.empty() || !std::filesystem::exists(path)) return false;
+    CheckpointReader reader(path);
+    const int commit = reader.last_commit();
+    if (commit < 0) return false;
+    const CheckpointRecord& marker = reader.records()[commit];
+    if (marker.params != checkpoint_params()) {
+        throw std::runtime_error("checkpoint was written with different solver parameters");
+    }
+    std::vector<Tensor> sites;
+    for (size_t i = 0; i < local_operators_.size(); ++i) {
+        sites.push_back(read_snapshot(reader, commit, "site_" + std::to_string(i)));
+        if (sites.back().dimensions[1] != local_operators_[i].dimensions[0]) {
+            throw std::runtime_error("checkpoint state does not match the local operators");
+        }
+    }
+    Tensor meta = read_snapshot(reader, commit, "mps_meta");
+    state_ = MatrixProductState::from_sites(std::move(sites), static_cast<int>(meta.data(0).real()),
+                                            meta.data(1).real());
+    energy_ = meta.data(2).real();
+    start_step_ = static_cast<int>(marker.step);
+    return true;
 }
 
 void ExpectationValueSolver::initialize_state(const Tensor& initial_state) {
-    network_.add_tensor(initial_state, "psi");
+    // the first index is the physical one the observable acts on
+    Tensor state = initial_state;
+    state.indices[0] = "site";
+    network_.set_tensor("psi", std::move(state));
 }
 
 void ExpectationValueSolver::build_network(const std::vector<double>& params) {
@@ -272,17 +921,30 @@ void ExpectationValueSolver::build_network(const std::vector<double>& params) {
 
 double ExpectationValueSolver::compute_quantity_of_interest() {
     auto result = network_.get_tensor("expectation");
-    return result.data(0, 0);
+    return result.data(0).real();
 }
 
 void ExpectationValueSolver::build_observable_network() {
-    // build network for <psi|O|psi>
-    network_.add_tensor(observable_, "observable");
-    auto result1 = network_.contract("psi", "observable", {"site"});
-    network_.add_tensor(result1, "O_psi");
-    
-    auto result2 = network_.contract("psi", "O_psi", {"site"});
-    network_.add_tensor(result2, "expectation");
+    // build network for <psi|O|psi>: the observable maps site -> site_out
+    // and the bra carries site_out, so every other ket index is summed too
+    const IndexId site("site"), site_out("site_out");
+    ExecutionScope execution(network_.execution_context());
+    Tensor observable = observable_;
+    observable.indices = {site_out, site};
+    TensorHandle obs = network_.set_tensor("observable", std::move(observable));
+    TensorHandle psi = network_.handle("psi");
+
+    // the bra is the complex conjugate of the ket
+    Tensor conj = network_.get_tensor(psi).conj();
+    conj.indices[0] = site_out;
+    TensorHandle bra = network_.set_tensor("psi_conj", std::move(conj));
+
+    // the contraction order is left to the planner
+    network_.set_tensor("expectation", network_.contract_all({bra, obs, psi}, {}));
+
+    // only the scalar is needed afterwards
+    network_.release(obs);
+    network_.release(bra);
 }
 
 } // namespace qps
@@ -0,0 +1,494 @@
+#include "solver/tensor.hh"
+#include "solver/execution.hh"
+#include "solver/thread_pool.hh"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace qps {
+
+template class BasicTensorData<std::complex<float>>;
+template class BasicTensorData<std::complex<double>>;
+
+namespace {
+
+// process-wide table of index names; ids are positions in `names`, and a
+// deque keeps references to earlier names valid while the table grows
+struct IndexRegistry {
+    std::mutex mutex;
+    std::unordered_map<std::string, int> ids;
+    std::deque<std::string> names;
+};
+
+IndexRegistry& index_registry() {
+    static IndexRegistry registry;
+    return registry;
+}
+
+template <typename T>
+using MatrixMap = Eigen::Map<typename BasicTensor<T>::Matrix>;
+template <typename T>
+using ConstMatrixMap = Eigen::Map<const typename BasicTensor<T>::Matrix>;
+
+bool is_identity(const std::vector<int>& order) {
+    for (size_t k = 0; k < order.size(); ++k) {
+        if (order[k] != static_cast<int>(k)) return false;
+    }
+    return true;
+}
+
+// copy runs [first, last) of dst from src, with dst index k taken from src
+// index order[k]. a run is one sweep of the innermost dst index; elements
+// are converted to dst's scalar type on the way
+template <typename In, typename Out>
+void permute_runs(const BasicTensorData<In>& src, const std::vector<int>& order, BasicTensorData<Out>& dst,
+                  Eigen::Index first, Eigen::Index last) {
+    const int rank = static_cast<int>(order.size());
+    const In* in = src.data();
+    Out* out = dst.data();
+
+    if (rank == 0) {
+        out[0] = static_cast<Out>(in[0]);
+        return;
+    }
+
+    // walk dst linearly and keep the matching src offset up to date
+    std::vector<Eigen::Index> counter(rank, 0);
+    std::vector<Eigen::Index> src_stride(rank), extent(rank);
+    for (int k = 0; k < rank; ++k) {
+        src_stride[k] = src.stride(order[k]);
+        extent[k] = dst.dimension(k);
+    }
+
+    // the innermost dst index is handled as a strided run
+    const Eigen::Index run = extent[0];
+    const Eigen::Index run_stride = src_stride[0];
+    Eigen::Index src_off = 0;
+    // coordinates of the first run
+    Eigen::Index rest = first;
+    for (int k = 1; k < rank; ++k) {
+        counter[k] = rest % extent[k];
+        rest /= extent[k];
+        src_off += counter[k] * src_stride[k];
+    }
+    for (Eigen::Index r = first; r < last; ++r) {
+        const Eigen::Index pos = r * run;
+        for (Eigen::Index i = 0; i < run; ++i) {
+            out[pos + i] = static_cast<Out>(in[src_off + i * run_stride]);
+        }
+        for (int k = 1; k < rank; ++k) {
+            src_off += src_stride[k];
+            if (++counter[k] < extent[k]) break;
+            src_off -= src_stride[k] * extent[k];
+            counter[k] = 0;
+        }
+    }
+}
+
+// copy src into dst with dst index k taken from src index order[k]. large
+// permutations are split into contiguous blocks of runs over the context's
+// workers; a caller already on a pool worker stays serial so it never waits
+// on the pool it is running in
+template <typename In, typename Out>
+void permute_into(const BasicTensorData<In>& src, const std::vector<int>& order, BasicTensorData<Out>& dst,
+                  const ExecutionContext& ctx) {
+    const Eigen::Index runs = order.empty() ? 1 : dst.size() / dst.dimension(0);
+    ThreadPool* pool = ctx.pool();
+    if (!ctx.parallel_permute(static_cast<size_t>(dst.size())) || runs < 2 ||
+        ThreadPool::current_worker() >= 0) {
+        permute_runs(src, order, dst, 0, runs);
+        return;
+    }
+    const Eigen::Index blocks = std::min<Eigen::Index>(runs, static_cast<Eigen::Index>(pool->size()));
+    for (Eigen::Index b = 0; b < blocks; ++b) {
+        const Eigen::Index first = runs * b / blocks;
+        const Eigen::Index last = runs * (b + 1) / blocks;
+        pool->submit([&src, &order, &dst, first, last] { permute_runs(src, order, dst, first, last); });
+    }
+    pool->wait();
+}
+
+// out = op(t1) * op(t2) with both operands rounded to complex<float> in
+// the permutation that lays them out for the gemm, and the product widened
+// back into out. order1/order2 are the layouts of a plain (untransposed) gemm
+void mixed_gemm(const TensorData& t1, const std::vector<int>& order1,
+                const TensorData& t2, const std::vector<int>& order2,
+                Eigen::Index m, Eigen::Index n, Eigen::Index k,
+                MatrixMap<TensorData::Scalar> out, const ExecutionContext& ctx) {
+    using Single = BasicTensorData<std::complex<float>>;
+    auto narrow = [&ctx](const TensorData& src, const std::vector<int>& order) {
+        std::vector<int> dims(order.size());
+        for (size_t j = 0; j < order.size(); ++j) dims[j] = static_cast<int>(src.dimension(order[j]));
+        Single dst(dims);
+        permute_into(src, order, dst, ctx);
+        return dst;
+    };
+    const Single a = narrow(t1, order1);
+    const Single b = narrow(t2, order2);
+    Eigen::MatrixXcf c(m, n);
+    c.noalias() = Eigen::Map<const Eigen::MatrixXcf>(a.data(), m, k) *
+                  Eigen::Map<const Eigen::MatrixXcf>(b.data(), k, n);
+    out = c.cast<TensorData::Scalar>();
+}
+
+// the elements of a sparse tensor as a (rows x cols) matrix whose rows run
+// over the indices `row_order` and whose columns run over `col_order`, each
+// in column-major order
+template <typename T>
+typename BasicTensor<T>::SparseMatrix sparse_matricize(const BasicTensor<T>& t, const std::vector<int>& row_order,
+                                                       const std::vector<int>& col_order) {
+    using SparseMatrix = typename BasicTensor<T>::SparseMatrix;
+    const SparseMatrix& s = *t.sparse;
+    const int rank = t.rank();
+    bool stored = row_order.size() == 1 && row_order[0] == 0;
+    for (size_t k = 0; stored && k < col_order.size(); ++k) stored = col_order[k] == static_cast<int>(k) + 1;
+    if (stored) return s;
+    if (rank == 2 && row_order.size() == 1 && row_order[0] == 1) return SparseMatrix(s.transpose());
+
+    std::vector<Eigen::Index> row_stride(rank, 0), col_stride(rank, 0);
+    Eigen::Index rows = 1, cols = 1;
+    for (int k : row_order) {
+        row_stride[k] = rows;
+        rows *= t.dimensions[k];
+    }
+    for (int k : col_order) {
+        col_stride[k] = cols;
+        cols *= t.dimensions[k];
+    }
+    std::vector<Eigen::Triplet<T, typename SparseMatrix::StorageIndex>> triplets;
+    triplets.reserve(s.nonZeros());
+    for (Eigen::Index r = 0; r < s.outerSize(); ++r) {
+        for (typename SparseMatrix::InnerIterator it(s, r); it; ++it) {
+            // coordinates of the element: row is index 0, the column the rest
+            Eigen::Index c = it.col();
+            Eigen::Index row = r * row_stride[0], col = r * col_stride[0];
+            for (int k = 1; k < rank; ++k) {
+                const Eigen::Index x = c % t.dimensions[k];
+                c /= t.dimensions[k];
+                row += x * row_stride[k];
+                col += x * col_stride[k];
+            }
+            triplets.emplace_back(row, col, it.value());
+        }
+    }
+    SparseMatrix m(rows, cols);
+    m.setFromTriplets(triplets.begin(), triplets.end());
+    return m;
+}
+
+// sparse x sparse: the (m x n) product becomes a tensor with indices
+// [free1..., free2...]; its storage takes the first of them as rows
+template <typename T>
+BasicTensor<T> sparse_product(const typename BasicTensor<T>::SparseMatrix& a,
+                              const typename BasicTensor<T>::SparseMatrix& b, const std::vector<int>& dims,
+                              const std::vector<IndexId>& indices) {
+    using SparseMatrix = typename BasicTensor<T>::SparseMatrix;
+    SparseMatrix product = a * b;
+    if (dims.empty()) {
+        BasicTensor<T> scalar(dims, indices);
+        scalar.data(0) = product.sum();
+        return scalar;
+    }
+    if (product.rows() == dims[0]) return BasicTensor<T>::from_sparse(std::move(product), dims, indices);
+
+    const Eigen::Index m = product.rows();
+    std::vector<Eigen::Triplet<T, typename SparseMatrix::StorageIndex>> triplets;
+    triplets.reserve(product.nonZeros());
+    for (Eigen::Index r = 0; r < product.outerSize(); ++r) {
+        for (typename SparseMatrix::InnerIterator it(product, r); it; ++it) {
+            const Eigen::Index offset = r + m * it.col();
+            triplets.emplace_back(offset % dims[0], offset / dims[0], it.value());
+        }
+    }
+    SparseMatrix stored(dims[0], product.size() / dims[0]);
+    stored.setFromTriplets(triplets.begin(), triplets.end());
+    return BasicTensor<T>::from_sparse(std::move(stored), dims, indices);
+}
+
+} // namespace
+
+template <typename T>
+BasicTensor<T> BasicTensor<T>::from_sparse(SparseMatrix mat, const std::vector<int>& dims,
+                                           const std::vector<IndexId>& idx) {
+    if (dims.size() != idx.size()) {
+        throw std::runtime_error("number of dimensions must match number of indices");
+    }
+    if (dims.empty()) {
+        throw std::runtime_error("a sparse tensor needs at least one index");
+    }
+    Eigen::Index cols = 1;
+    for (size_t k = 0; k < dims.size(); ++k) {
+        if (dims[k] <= 0) {
+            throw std::runtime_error("tensor dimensions must be positive");
+        }
+        if (k > 0) cols *= dims[k];
+    }
+    if (mat.rows() != dims[0] || mat.cols() != cols) {
+        throw std::runtime_error("sparse matrix does not match the tensor dimensions");
+    }
+    mat.makeCompressed();
+    BasicTensor tensor;
+    tensor.indices = idx;
+    tensor.dimensions = dims;
+    tensor.sparse = std::make_shared<const SparseMatrix>(std::move(mat));
+    return tensor;
+}
+
+template <typename T>
+BasicTensor<T> BasicTensor<T>::to_dense() const {
+    if (!sparse) return *this;
+    ScopedTimer timer(Phase::copy);
+    BasicTensor dense(dimensions, indices);
+    MatrixView m = dense.matrix_view();
+    for (Eigen::Index r = 0; r < sparse->outerSize(); ++r) {
+        for (typename SparseMatrix::InnerIterator it(*sparse, r); it; ++it) m(r, it.col()) = it.value();
+    }
+    return dense;
+}
+
+template <typename T>
+BasicTensor<T> BasicTensor<T>::to_sparse(double tolerance) const {
+    if (sparse) return *this;
+    if (rank() == 0) {
+        throw std::runtime_error("a sparse tensor needs at least one index");
+    }
+    ScopedTimer timer(Phase::copy);
+    // keeps |x| > tolerance (exact zeros are dropped at tolerance 0)
+    return from_sparse(SparseMatrix(matrix_view().sparseView(Scalar(1), tolerance)), dimensions, indices);
+}
+
+template struct BasicTensor<std::complex<float>>;
+template struct BasicTensor<std::complex<double>>;
+
+Tensor::Scalar trace_product(const Tensor& op, const Eigen::Ref<const Eigen::MatrixXcd>& m) {
+    if (op.rank() != 2 || op.dimensions[0] != m.cols() || op.dimensions[1] != m.rows()) {
+        throw std::runtime_error("trace_product needs a square pair of matrices");
+    }
+    if (!op.is_sparse()) return op.matrix_view().cwiseProduct(m.transpose()).sum();
+    Tensor::Scalar sum = 0.0;
+    for (Eigen::Index r = 0; r < op.sparse->outerSize(); ++r) {
+        for (Tensor::SparseMatrix::InnerIterator it(*op.sparse, r); it; ++it) sum += it.value() * m(it.col(), r);
+    }
+    return sum;
+}
+
+int IndexId::intern(const std::string& name) {
+    IndexRegistry& reg = index_registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto it = reg.ids.find(name);
+    if (it != reg.ids.end()) return it->second;
+    int id = static_cast<int>(reg.names.size());
+    reg.names.push_back(name);
+    reg.ids.emplace(name, id);
+    return id;
+}
+
+const std::string& IndexId::name() const {
+    static const std::string unnamed = "<unnamed>";
+    if (value < 0) return unnamed;
+    IndexRegistry& reg = index_registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    return reg.names.at(value);
+}
+
+std::ostream& operator<<(std::ostream& os, IndexId idx) {
+    return os << idx.name();
+}
+
+template <typename T>
+BasicTensor<T> permute(const BasicTensor<T>& tensor, const std::vector<int>& order) {
+    return permute(tensor, order, ExecutionContext::serial());
+}
+
+template <typename T>
+BasicTensor<T> permute(const BasicTensor<T>& tensor, const std::vector<int>& order, const ExecutionContext& ctx) {
+    ScopedTimer timer(Phase::permute);
+    if (order.size() != static_cast<size_t>(tensor.rank())) {
+        throw std::runtime_error("permutation must list every index exactly once");
+    }
+    std::vector<bool> seen(order.size(), false);
+    std::vector<int> new_dims;
+    std::vector<IndexId> new_indices;
+    for (int k : order) {
+        if (k < 0 || k >= tensor.rank() || seen[k]) {
+            throw std::runtime_error("permutation must list every index exactly once");
+        }
+        seen[k] = true;
+        new_dims.push_back(tensor.dimensions[k]);
+        new_indices.push_back(tensor.indices[k]);
+    }
+
+    if (tensor.is_sparse()) {
+        // the new first index becomes the rows, the others the columns
+        return BasicTensor<T>::from_sparse(
+            sparse_matricize(tensor, {order[0]}, std::vector<int>(order.begin() + 1, order.end())), new_dims,
+            new_indices);
+    }
+
+    BasicTensor<T> result(new_dims, new_indices);
+    permute_into(tensor.data, order, result.data, ctx);
+    return result;
+}
+
+template <typename T>
+BasicTensor<T> contract_tensors(const BasicTensor<T>& t1, const BasicTensor<T>& t2,
+                                const std::vector<std::pair<int, int>>& index_pairs) {
+    return contract_tensors(t1, t2, index_pairs, ExecutionContext::serial());
+}
+
+template <typename T>
+BasicTensor<T> contract_tensors(const BasicTensor<T>& t1, const BasicTensor<T>& t2,
+                                const std::vector<std::pair<int, int>>& index_pairs,
+                                const ExecutionContext& ctx) {
+    using SparseMatrix = typename BasicTensor<T>::SparseMatrix;
+    ScopedTimer timer(Phase::contract);
+    const int r1 = t1.rank();
+    const int r2 = t2.rank();
+
+    std::vector<bool> contracted1(r1, false), contracted2(r2, false);
+    for (const auto& p : index_pairs) {
+        if (p.first < 0 || p.first >= r1 || p.second < 0 || p.second >= r2) {
+            throw std::runtime_error("contraction index out of range");
+        }
+        if (contracted1[p.first] || contracted2[p.second]) {
+            throw std::runtime_error("index contracted more than once");
+        }
+        if (t1.dimensions[p.first] != t2.dimensions[p.second]) {
+            throw std::runtime_error("dimension mismatch in contraction for index '" +
+                                   t1.indices[p.first].name() + "'");
+        }
+        contracted1[p.first] = true;
+        contracted2[p.second] = true;
+    }
+
+    // lay t1 out as [free..., contracted...] and t2 as [contracted..., free...]
+    std::vector<int> free1, free2, shared1, shared2;
+    for (int k = 0; k < r1; ++k) if (!contracted1[k]) free1.push_back(k);
+    for (int k = 0; k < r2; ++k) if (!contracted2[k]) free2.push_back(k);
+    for (const auto& p : index_pairs) {
+        shared1.push_back(p.first);
+        shared2.push_back(p.second);
+    }
+
+    Eigen::Index m = 1, n = 1, k = 1;
+    std::vector<int> new_dims;
+    std::vector<IndexId> new_indices;
+    for (int i : free1) {
+        m *= t1.dimensions[i];
+        new_dims.push_back(t1.dimensions[i]);
+        new_indices.push_back(t1.indices[i]);
+    }
+    for (int i : free2) {
+        n *= t2.dimensions[i];
+        new_dims.push_back(t2.dimensions[i]);
+        new_indices.push_back(t2.indices[i]);
+    }
+    for (int i : shared1) k *= t1.dimensions[i];
+
+    if (t1.is_sparse() || t2.is_sparse()) {
+        // csr times dense: one multiply-add per nonzero and output column
+        if (t1.is_sparse() && t2.is_sparse()) {
+            SparseMatrix a = sparse_matricize(t1, free1, shared1);
+            profile::count_contraction(8 * static_cast<uint64_t>(a.nonZeros()) * n);
+            return sparse_product<T>(a, sparse_matricize(t2, shared2, free2), new_dims, new_indices);
+        }
+        std::vector<int> order1 = free1, order2 = shared2;
+        order1.insert(order1.end(), shared1.begin(), shared1.end());
+        order2.insert(order2.end(), free2.begin(), free2.end());
+        BasicTensor<T> result(new_dims, new_indices);
+        MatrixMap<T> out(result.data.data(), m, n);
+        if (t1.is_sparse()) {
+            const SparseMatrix a = sparse_matricize(t1, free1, shared1);
+            const BasicTensor<T> b = is_identity(order2) ? BasicTensor<T>() : permute(t2, order2, ctx);
+            const T* bp = is_identity(order2) ? t2.data.data() : b.data.data();
+            profile::count_contraction(8 * static_cast<uint64_t>(a.nonZeros()) * n);
+            out.noalias() = a * ConstMatrixMap<T>(bp, k, n);
+        } else {
+            const SparseMatrix b = sparse_matricize(t2, shared2, free2);
+            const BasicTensor<T> a = is_identity(order1) ? BasicTensor<T>() : permute(t1, order1, ctx);
+            const T* ap = is_identity(order1) ? t1.data.data() : a.data.data();
+            profile::count_contraction(8 * static_cast<uint64_t>(m) * b.nonZeros());
+            out.noalias() = ConstMatrixMap<T>(ap, m, k) * b;
+        }
+        return result;
+    }
+    // a complex multiply-add is 8 real flops
+    profile::count_contraction(8 * static_cast<uint64_t>(m) * n * k);
+
+    // an operand already stored as [contracted..., free...] (resp. the
+    // reverse for t2) is used through a transposed map instead of a copy
+    std::vector<int> order1 = free1, order1_t = shared1;
+    order1.insert(order1.end(), shared1.begin(), shared1.end());
+    order1_t.insert(order1_t.end(), free1.begin(), free1.end());
+    std::vector<int> order2 = shared2, order2_t = free2;
+    order2.insert(order2.end(), free2.begin(), free2.end());
+    order2_t.insert(order2_t.end(), shared2.begin(), shared2.end());
+
+    BasicTensor<T> result(new_dims, new_indices);
+    MatrixMap<T> out(result.data.data(), m, n);
+
+    // single-precision tensors are already what a mixed gemm rounds to
+    if constexpr (std::is_same<T, TensorData::Scalar>::value) {
+        if (ctx.precision() == Precision::mixed) {
+            mixed_gemm(t1.data, order1, t2.data, order2, m, n, k, out, ctx);
+            return result;
+        }
+    }
+
+    BasicTensor<T> tmp1, tmp2;
+    const T* a = t1.data.data();
+    const T* b = t2.data.data();
+    bool a_transposed = false, b_transposed = false;
+    if (is_identity(order1_t) && !is_identity(order1)) {
+        a_transposed = true;
+    } else if (!is_identity(order1)) {
+        tmp1 = permute(t1, order1, ctx);
+        a = tmp1.data.data();
+    }
+    if (is_identity(order2_t) && !is_identity(order2)) {
+        b_transposed = true;
+    } else if (!is_identity(order2)) {
+        tmp2 = permute(t2, order2, ctx);
+        b = tmp2.data.data();
+    }
+
+    // single GEMM; with EIGEN_USE_BLAS this is dispatched to BLAS
+    if (!a_transposed && !b_transposed) {
+        out.noalias() = ConstMatrixMap<T>(a, m, k) * ConstMatrixMap<T>(b, k, n);
+    } else if (a_transposed && !b_transposed) {
+        out.noalias() = ConstMatrixMap<T>(a, k, m).transpose() * ConstMatrixMap<T>(b, k, n);
+    } else if (!a_transposed && b_transposed) {
+        out.noalias() = ConstMatrixMap<T>(a, m, k) * ConstMatrixMap<T>(b, n, k).transpose();
+    } else {
+        out.noalias() = ConstMatrixMap<T>(a, k, m).transpose() * ConstMatrixMap<T>(b, n, k).transpose();
+    }
+    return result;
+}
+
+template BasicTensor<std::complex<float>> permute(const BasicTensor<std::complex<float>>&,
+                                                  const std::vector<int>&);
+template BasicTensor<std::complex<double>> permute(const BasicTensor<std::complex<double>>&,
+                                                   const std::vector<int>&);
+template BasicTensor<std::complex<float>> permute(const BasicTensor<std::complex<float>>&,
+                                                  const std::vector<int>&, const ExecutionContext&);
+template BasicTensor<std::complex<double>> permute(const BasicTensor<std::complex<double>>&,
+                                                   const std::vector<int>&, const ExecutionContext&);
+template BasicTensor<std::complex<float>> contract_tensors(const BasicTensor<std::complex<float>>&,
+                                                           const BasicTensor<std::complex<float>>&,
+                                                           const std::vector<std::pair<int, int>>&);
+template BasicTensor<std::complex<double>> contract_tensors(const BasicTensor<std::complex<double>>&,
+                                                            const BasicTensor<std::complex<double>>&,
+                                                            const std::vector<std::pair<int, int>>&);
+template BasicTensor<std::complex<float>> contract_tensors(const BasicTensor<std::complex<float>>&,
+                                                           const BasicTensor<std::complex<float>>&,
+                                                           const std::vector<std::pair<int, int>>&,
+                                                           const ExecutionContext&);
+template BasicTensor<std::complex<double>> contract_tensors(const BasicTensor<std::complex<double>>&,
+                                                            const BasicTensor<std::complex<double>>&,
+                                                            const std::vector<std::pair<int, int>>&,
+                                                            const ExecutionContext&);
+
+} // namespace qps
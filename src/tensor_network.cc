@@ -1,81 +1,196 @@
 #include "solver/tensor.hh"
+#include "solver/execution.hh"
 #include <stdexcept>
 #include <algorithm>
+#include <mutex>
 
 namespace qps {
 
-void TensorNetwork::add_tensor(const Tensor& tensor, const std::string& name) {
-    if (tensors_.find(name) != tensors_.end()) {
+TensorHandle TensorNetwork::add_tensor(const Tensor& tensor, const std::string& name) {
+    return add_tensor(Tensor(tensor), name);
+}
+
+TensorHandle TensorNetwork::add_tensor(Tensor&& tensor, const std::string& name) {
+    if (names_.find(name) != names_.end()) {
         throw std::runtime_error("tensor with name '" + name + "' already exists");
     }
-    tensors_[name] = tensor;
+    int slot;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        slot = static_cast<int>(slots_.size());
+        slots_.emplace_back();
+    }
+    Slot& s = slots_[slot];
+    account(tensor_bytes(tensor), 0);
+    s.tensor = std::move(tensor);
+    s.name = name;
+    s.live = true;
+    names_.emplace(name, slot);
+    return TensorHandle{slot, s.generation};
 }
 
-const Tensor& TensorNetwork::get_tensor(const std::string& name) const {
-    auto it = tensors_.find(name);
-    if (it == tensors_.end()) {
+TensorHandle TensorNetwork::set_tensor(const std::string& name, Tensor tensor) {
+    auto it = names_.find(name);
+    if (it == names_.end()) return add_tensor(std::move(tensor), name);
+    TensorHandle h{it->second, slots_[it->second].generation};
+    update_tensor(h, std::move(tensor));
+    return h;
+}
+
+void TensorNetwork::update_tensor(TensorHandle handle, Tensor tensor) {
+    Slot& s = checked_slot(handle);
+    account(tensor_bytes(tensor), tensor_bytes(s.tensor));
+    s.tensor = std::move(tensor);
+}
+
+void TensorNetwork::release(TensorHandle handle) {
+    Slot& s = checked_slot(handle);
+    account(0, tensor_bytes(s.tensor));
+    s.tensor = Tensor();
+    names_.erase(s.name);
+    s.name.clear();
+    s.live = false;
+    ++s.generation;
+    free_slots_.push_back(handle.slot);
+}
+
+void TensorNetwork::release(const std::string& name) {
+    release(handle(name));
+}
+
+void TensorNetwork::account(size_t added, size_t removed) {
+    bytes_in_use_ = bytes_in_use_ + added - removed;
+    peak_bytes_ = std::max(peak_bytes_, bytes_in_use_);
+}
+
+TensorNetwork::Slot& TensorNetwork::checked_slot(TensorHandle handle) {
+    return const_cast<Slot&>(static_cast<const TensorNetwork*>(this)->checked_slot(handle));
+}
+
+const TensorNetwork::Slot& TensorNetwork::checked_slot(TensorHandle handle) const {
+    if (handle.slot < 0 || handle.slot >= static_cast<int>(slots_.size())) {
+        throw std::runtime_error("invalid tensor handle");
+    }
+    const Slot& s = slots_[handle.slot];
+    if (!s.live || s.generation != handle.generation) {
+        throw std::runtime_error("stale tensor handle");
+    }
+    return s;
+}
+
+TensorHandle TensorNetwork::handle(const std::string& name) const {
+    auto it = names_.find(name);
+    if (it == names_.end()) {
         throw std::runtime_error("tensor with name '" + name + "' not found");
     }
-    return it->second;
+    return TensorHandle{it->second, slots_[it->second].generation};
+}
+
+const Tensor& TensorNetwork::get_tensor(TensorHandle handle) const {
+    return checked_slot(handle).tensor;
+}
+
+const Tensor& TensorNetwork::get_tensor(const std::string& name) const {
+    return get_tensor(handle(name));
+}
+
+const ExecutionContext& TensorNetwork::execution_context() const {
+    return execution_ ? *execution_ : ExecutionContext::serial();
+}
+
+Tensor TensorNetwork::contract(TensorHandle tensor1, TensorHandle tensor2,
+                             const std::vector<IndexId>& indices_to_contract) const {
+    const Tensor& t1 = get_tensor(tensor1);
+    const Tensor& t2 = get_tensor(tensor2);
+
+    // find positions of indices to contract; labels compare as integers
+    std::vector<std::pair<int, int>> pairs;
+    for (IndexId idx : indices_to_contract) {
+        int p1 = t1.index_position(idx);
+        int p2 = t2.index_position(idx);
+        if (p1 < 0 || p2 < 0) {
+            throw std::runtime_error("index '" + idx.name() + "' not found in one or both tensors");
+        }
+        pairs.emplace_back(p1, p2);
+    }
+
+    // dimension checks and the permute + GEMM happen in the kernel
+    return contract_tensors(t1, t2, pairs, execution_context());
 }
 
 Tensor TensorNetwork::contract(const std::string& tensor1_name,
                              const std::string& tensor2_name,
                              const std::vector<std::string>& indices_to_contract) {
-    const Tensor& t1 = get_tensor(tensor1_name);
-    const Tensor& t2 = get_tensor(tensor2_name);
-
-    // find positions of indices to contract
-    std::vector<int> t1_indices, t2_indices;
-    for (const auto& idx : indices_to_contract) {
-        auto it1 = std::find(t1.indices.begin(), t1.indices.end(), idx);
-        auto it2 = std::find(t2.indices.begin(), t2.indices.end(), idx);
-        
-        if (it1 == t1.indices.end() || it2 == t2.indices.end()) {
-            throw std::runtime_error("index '" + idx + "' not found in one or both tensors");
+    std::vector<IndexId> ids(indices_to_contract.begin(), indices_to_contract.end());
+    return contract(handle(tensor1_name), handle(tensor2_name), ids);
+}
+
+Tensor TensorNetwork::contract_all(const std::vector<TensorHandle>& tensors,
+                                 const std::vector<IndexId>& output,
+                                 PathMethod method) const {
+    std::vector<const Tensor*> inputs;
+    for (TensorHandle h : tensors) inputs.push_back(&get_tensor(h));
+
+    // the plan depends only on labels and dimensions, not on the data
+    std::vector<int> key{static_cast<int>(method), static_cast<int>(inputs.size())};
+    for (const Tensor* t : inputs) {
+        key.push_back(t->rank());
+        for (int k = 0; k < t->rank(); ++k) {
+            key.push_back(t->indices[k].value);
+            key.push_back(t->dimensions[k]);
         }
-        
-        t1_indices.push_back(std::distance(t1.indices.begin(), it1));
-        t2_indices.push_back(std::distance(t2.indices.begin(), it2));
     }
+    for (IndexId idx : output) key.push_back(idx.value);
 
-    // verify dimensions match for contracted indices
-    for (size_t i = 0; i < indices_to_contract.size(); ++i) {
-        if (t1.dimensions[t1_indices[i]] != t2.dimensions[t2_indices[i]]) {
-            throw std::runtime_error("dimension mismatch in contraction for index '" + 
-                                   indices_to_contract[i] + "'");
+    ContractionPlan plan;
+    {
+        std::lock_guard<std::mutex> lock(plan_mutex_);
+        auto cached = plan_cache_.find(key);
+        if (cached == plan_cache_.end()) {
+            std::vector<TensorShape> shapes;
+            for (const Tensor* t : inputs) shapes.push_back({t->indices, t->dimensions});
+            cached = plan_cache_.emplace(key, plan_contraction(shapes, output, method)).first;
         }
+        plan = cached->second;
     }
 
-    // fixed-size array for rank-2 tensors
-    Eigen::array<Eigen::IndexPair<int>, 1> dims;
-    dims[0] = Eigen::IndexPair<int>(t1_indices[0], t2_indices[0]);
-
-    auto result_data = t1.data.contract(t2.data, dims);
-
-    // create new tensor with remaining indices
-    std::vector<std::string> new_indices;
-    std::vector<int> new_dims;
-    
-    // add indices and dimensions from first tensor
-    for (size_t i = 0; i < t1.indices.size(); ++i) {
-        if (std::find(t1_indices.begin(), t1_indices.end(), i) == t1_indices.end()) {
-            new_indices.push_back(t1.indices[i]);
-            new_dims.push_back(t1.dimensions[i]);
+    // intermediates are dropped as soon as their consumer has run
+    const int n = static_cast<int>(inputs.size());
+    std::vector<Tensor> intermediates(plan.steps.size());
+    std::vector<const Tensor*> nodes = inputs;
+    for (size_t k = 0; k < plan.steps.size(); ++k) {
+        const Tensor& a = *nodes[plan.steps[k].lhs];
+        const Tensor& b = *nodes[plan.steps[k].rhs];
+        std::vector<std::pair<int, int>> pairs;
+        for (int i = 0; i < a.rank(); ++i) {
+            int j = b.index_position(a.indices[i]);
+            if (j >= 0) pairs.emplace_back(i, j);
         }
-    }
-    
-    // add indices and dimensions from second tensor
-    for (size_t i = 0; i < t2.indices.size(); ++i) {
-        if (std::find(t2_indices.begin(), t2_indices.end(), i) == t2_indices.end()) {
-            new_indices.push_back(t2.indices[i]);
-            new_dims.push_back(t2.dimensions[i]);
+        intermediates[k] = contract_tensors(a, b, pairs, execution_context());
+        nodes.push_back(&intermediates[k]);
+        for (int operand : {plan.steps[k].lhs, plan.steps[k].rhs}) {
+            if (operand >= n) intermediates[operand - n] = Tensor();
         }
     }
 
-    Tensor result(new_dims, new_indices);
-    result.data = result_data;
-    return result;
+    const Tensor& last = *nodes.back();
+    std::vector<int> order;
+    bool identity = true;
+    for (IndexId idx : output) {
+        order.push_back(last.index_position(idx));
+        identity = identity && order.back() == static_cast<int>(order.size()) - 1;
+    }
+    if (identity && !plan.steps.empty()) return std::move(intermediates.back());
+    return permute(last, order);
+}
+
+Tensor TensorNetwork::contract_all(const std::vector<std::string>& names,
+                                 const std::vector<std::string>& output) {
+    std::vector<TensorHandle> handles;
+    for (const auto& name : names) handles.push_back(handle(name));
+    return contract_all(handles, std::vector<IndexId>(output.begin(), output.end()));
 }
 
 } // namespace qps
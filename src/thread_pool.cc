@@ -0,0 +1,129 @@
+#include "solver/thread_pool.hh"
+#include "solver/buffer_pool.hh"
+#include "solver/profiler.hh"
+#include <algorithm>
+#include <chrono>
+
+namespace qps {
+
+namespace {
+
+// the pool and worker index of the calling thread
+thread_local const ThreadPool* tls_pool = nullptr;
+thread_local int tls_worker = -1;
+
+// timed waits are inlined around pthread_cond_clockwait, whereas the untimed
+// condition_variable::wait is versioned in newer libstdc++ releases; this
+// keeps binaries runnable against an older runtime library
+const auto kWaitSlice = std::chrono::milliseconds(100);
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    if (num_threads == 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < num_threads; ++i) queues_.push_back(std::make_unique<Queue>());
+    for (size_t i = 0; i < num_threads; ++i) threads_.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+int ThreadPool::current_worker() {
+    return tls_worker;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    // the task's work counts towards the submitting run's profile
+    if (Profiler* run = Profiler::current()) {
+        task = [run, inner = std::move(task)] {
+            ProfileScope scope(run);
+            inner();
+        };
+    }
+    const size_t id = (tls_pool == this) ? static_cast<size_t>(tls_worker)
+                                         : next_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[id]->mutex);
+        queues_[id]->tasks.push_back(std::move(task));
+    }
+    {
+        // counted under the wake mutex so a worker about to sleep sees it
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++pending_;
+        queued_.fetch_add(1, std::memory_order_relaxed);
+    }
+    wake_.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!idle_.wait_for(lock, kWaitSlice, [this] { return pending_ == 0; })) {
+    }
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+bool ThreadPool::try_pop(size_t id, std::function<void()>& task) {
+    {
+        Queue& own = *queues_[id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues_.size(); ++k) {
+        Queue& other = *queues_[(id + k) % queues_.size()];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(size_t id) {
+    tls_pool = this;
+    tls_worker = static_cast<int>(id);
+    std::function<void()> task;
+    for (;;) {
+        if (try_pop(id, task)) {
+            std::exception_ptr error;
+            try {
+                task();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            task = nullptr;  // release captures before reporting completion
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (error && !error_) error_ = error;
+            if (--pending_ == 0) idle_.notify_all();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!wake_.wait_for(lock, kWaitSlice,
+                               [this] { return stop_ || queued_.load(std::memory_order_relaxed) > 0; })) {
+        }
+        if (stop_ && queued_.load(std::memory_order_relaxed) == 0) break;
+    }
+    // buffers the tasks freed on this worker go back to the system now,
+    // not when the last thread_local destructor happens to run
+    BufferPool::clear();
+}
+
+} // namespace qps
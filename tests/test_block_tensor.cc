@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <Eigen/Dense>
+#include <algorithm>
+#include "solver/block_tensor.hh"
+
+using namespace qps;
+
+namespace {
+
+// a u(1) index with charges 0..n-1 and the given sector dimensions
+QnIndex u1_index(const std::string& label, const std::vector<int>& dims, int flow) {
+    QnIndex idx{label, {}, flow};
+    for (size_t q = 0; q < dims.size(); ++q) idx.sectors.push_back({static_cast<int>(q), dims[q]});
+    return idx;
+}
+
+double max_diff(const Tensor& a, const Tensor& b) {
+    return (a.vector_view() - b.vector_view()).cwiseAbs().maxCoeff();
+}
+
+} // namespace
+
+TEST(BlockTensorTest, DenseRoundTripAndForbiddenElements) {
+    // a hopping term conserves particle number: charge 0 between in and out
+    std::vector<QnIndex> idx = {u1_index("i", {1, 2, 1}, 1), u1_index("j", {1, 2, 1}, -1)};
+    BlockTensor t = BlockTensor::random(Symmetry::u1, idx);
+    EXPECT_EQ(t.blocks().size(), 3u);
+    EXPECT_EQ(t.nonzeros(), 6);
+
+    Tensor dense = t.to_dense();
+    EXPECT_EQ(dense.dimensions, (std::vector<int>{4, 4}));
+    BlockTensor back = BlockTensor::from_dense(dense, Symmetry::u1, idx);
+    EXPECT_EQ(max_diff(back.to_dense(), dense), 0.0);
+    EXPECT_NEAR(back.norm(), dense.vector_view().norm(), 1e-12);
+
+    // element (0, 1) moves a particle from sector 1 into sector 0
+    dense.data(0, 1) = 1.0;
+    EXPECT_THROW(BlockTensor::from_dense(dense, Symmetry::u1, idx), std::runtime_error);
+    EXPECT_THROW(t.block({0, 1}), std::runtime_error);
+}
+
+TEST(BlockTensorTest, ContractionMatchesDense) {
+    // u(1): a charged operator times a neutral one
+    BlockTensor a = BlockTensor::random(Symmetry::u1,
+                                        {u1_index("l", {2, 3, 2}, 1), u1_index("s", {1, 1}, 1),
+                                         u1_index("r", {2, 3, 2, 1}, -1)});
+    BlockTensor b = BlockTensor::random(Symmetry::u1,
+                                        {u1_index("r", {2, 3, 2, 1}, 1), u1_index("t", {1, 1}, 1),
+                                         u1_index("x", {2, 2, 3, 1, 1}, -1)}, 0);
+    BlockTensor c = contract_tensors(a, b, {{2, 0}});
+    Tensor expected = contract_tensors(a.to_dense(), b.to_dense(), {{2, 0}});
+    EXPECT_LT(max_diff(c.to_dense(), expected), 1e-12);
+    EXPECT_LT(c.nonzeros(), expected.data.size());
+
+    // z2 with two contracted indices and a charged result
+    auto z2_index = [](const std::string& label, int even, int odd, int flow) {
+        return QnIndex{label, {{0, even}, {1, odd}}, flow};
+    };
+    BlockTensor p = BlockTensor::random(Symmetry::z2,
+                                        {z2_index("a", 2, 3, 1), z2_index("b", 1, 2, 1), z2_index("c", 3, 1, -1)}, 1);
+    BlockTensor q = BlockTensor::random(Symmetry::z2,
+                                        {z2_index("c", 3, 1, 1), z2_index("d", 2, 2, 1), z2_index("b", 1, 2, -1)}, 0);
+    BlockTensor pq = contract_tensors(p, q, {{2, 0}, {1, 2}});
+    EXPECT_EQ(pq.charge(), 1);
+    Tensor pq_dense = contract_tensors(p.to_dense(), q.to_dense(), {{2, 0}, {1, 2}});
+    EXPECT_LT(max_diff(pq.to_dense(), pq_dense), 1e-12);
+
+    // <a|a> through the conjugate
+    std::vector<std::pair<int, int>> all = {{0, 0}, {1, 1}, {2, 2}};
+    BlockTensor norm2 = contract_tensors(a.conj(), a, all);
+    EXPECT_NEAR(norm2.to_dense().data(0).real(), a.norm() * a.norm(), 1e-10);
+
+    // mismatched flows cannot be contracted
+    EXPECT_THROW(contract_tensors(a, a, {{2, 2}}), std::runtime_error);
+}
+
+TEST(BlockTensorTest, PermuteMatchesDense) {
+    BlockTensor t = BlockTensor::random(Symmetry::u1,
+                                        {u1_index("a", {2, 1}, 1), u1_index("b", {1, 3, 1}, -1),
+                                         u1_index("c", {2, 2}, 1)}, 1);
+    BlockTensor p = permute(t, {2, 0, 1});
+    EXPECT_EQ(p.indices()[0].label, IndexId("c"));
+    EXPECT_EQ(max_diff(p.to_dense(), permute(t.to_dense(), {2, 0, 1})), 0.0);
+}
+
+TEST(BlockTensorTest, SvdPerBlock) {
+    BlockTensor t = BlockTensor::random(Symmetry::u1,
+                                        {u1_index("l", {2, 3, 2}, 1), u1_index("s", {1, 1}, 1),
+                                         u1_index("r", {2, 3, 2, 1}, -1)}, 0);
+    BlockSvd full = svd(t, 2, "k", TruncationParams{100, 0.0});
+    EXPECT_EQ(full.discarded, 0.0);
+
+    // u is an isometry and u s vh rebuilds t
+    BlockTensor uu = contract_tensors(full.u.conj(), full.u, {{0, 0}, {1, 1}});
+    Tensor id = uu.to_dense();
+    EXPECT_LT((id.to_matrix() - Eigen::MatrixXcd::Identity(id.dimensions[0], id.dimensions[1])).norm(), 1e-12);
+
+    BlockTensor svh = full.vh;
+    int sector = 0;
+    for (const auto& entry : full.singular_values) {
+        for (const auto& blk : full.vh.blocks()) {
+            if (blk.first[0] != sector) continue;
+            svh.block(blk.first).matrix_view(1) = entry.second.asDiagonal() * blk.second.matrix_view(1);
+        }
+        ++sector;
+    }
+    BlockTensor rebuilt = contract_tensors(full.u, svh, {{2, 0}});
+    EXPECT_LT(max_diff(rebuilt.to_dense(), t.to_dense()), 1e-12);
+
+    // the spectrum over all charges is the dense one, and truncation keeps
+    // its largest values
+    std::vector<double> values;
+    for (const auto& entry : full.singular_values)
+        for (Eigen::Index k = 0; k < entry.second.size(); ++k) values.push_back(entry.second(k));
+    std::sort(values.rbegin(), values.rend());
+    Eigen::VectorXd dense_s = t.to_dense().matrix_view(2).bdcSvd().singularValues();
+    ASSERT_LE(values.size(), static_cast<size_t>(dense_s.size()));
+    for (size_t k = 0; k < values.size(); ++k) EXPECT_NEAR(values[k], dense_s(k), 1e-10);
+
+    BlockSvd cut = svd(t, 2, "k", TruncationParams{3, 0.0});
+    int kept = 0;
+    double smallest = values[0];
+    for (const auto& entry : cut.singular_values) {
+        kept += static_cast<int>(entry.second.size());
+        smallest = std::min(smallest, entry.second.minCoeff());
+    }
+    EXPECT_EQ(kept, 3);
+    EXPECT_NEAR(smallest, dense_s(2), 1e-10);
+    EXPECT_GT(cut.discarded, 0.0);
+    EXPECT_EQ(cut.u.indices().back().dimension(), 3);
+}
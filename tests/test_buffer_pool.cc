@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <Eigen/Dense>
+#include <thread>
+#include "solver/buffer_pool.hh"
+#include "solver/profiler.hh"
+#include "solver/solver.hh"
+#include "solver/thread_pool.hh"
+
+using namespace qps;
+
+namespace {
+
+Eigen::MatrixXcd random_hermitian(int d) {
+    Eigen::MatrixXcd a = Eigen::MatrixXcd::Random(d, d);
+    return (a + a.adjoint()) / 2.0;
+}
+
+} // namespace
+
+TEST(BufferPoolTest, ReusesBuffersOfTheSameSize) {
+    BufferPool::clear();
+    BufferPool::reset_stats();
+    const Tensor::Scalar* first = nullptr;
+    {
+        Tensor t({4, 5}, {"a", "b"});
+        first = t.data.data();
+    }
+    EXPECT_EQ(BufferPool::stats().releases, 1u);
+    EXPECT_EQ(BufferPool::stats().cached_bytes, 20 * sizeof(Tensor::Scalar));
+
+    // same element count, other shape: the cached buffer, zeroed
+    Tensor u({2, 10}, {"a", "b"});
+    EXPECT_EQ(u.data.data(), first);
+    EXPECT_EQ(u.vector_view().norm(), 0.0);
+    Tensor v({3, 3}, {"a", "b"});
+    BufferPoolStats s = BufferPool::stats();
+    EXPECT_EQ(s.hits, 1u);
+    EXPECT_EQ(s.misses, 2u);
+    EXPECT_EQ(s.cached_bytes, 0u);
+
+    // copies draw from the pool too, and keep their own data
+    v.data(1, 1) = 2.0;
+    Tensor w = v;
+    w.data(1, 1) = 3.0;
+    EXPECT_EQ(v.data(1, 1), Tensor::Scalar(2.0));
+    EXPECT_EQ(BufferPool::stats().misses, 3u);
+}
+
+TEST(BufferPoolTest, CapacityLimitsTheCache) {
+    const size_t capacity = BufferPool::capacity();
+    BufferPool::set_capacity(0);
+    BufferPool::reset_stats();
+    { Tensor t({8}, {"a"}); }
+    EXPECT_EQ(BufferPool::stats().dropped, 1u);
+    EXPECT_EQ(BufferPool::stats().cached_bytes, 0u);
+    BufferPool::set_capacity(capacity);
+}
+
+TEST(BufferPoolTest, CapacityBoundsAllThreadsTogether) {
+    const size_t capacity = BufferPool::capacity();
+    BufferPool::clear();
+    BufferPool::set_capacity(8 * sizeof(Tensor::Scalar));
+    BufferPool::reset_stats();
+    std::thread other([] { Tensor t({8}, {"a"}); });
+    other.join();  // its cache went with it
+    { Tensor t({8}, {"a"}); }
+    std::thread holder([] {
+        { Tensor t({8}, {"a"}); }
+        // the main thread's cache holds the whole capacity
+        EXPECT_EQ(BufferPool::stats().dropped, 1u);
+    });
+    holder.join();
+    EXPECT_EQ(BufferPool::stats().cached_bytes, 8 * sizeof(Tensor::Scalar));
+    BufferPool::clear();
+    BufferPool::set_capacity(capacity);
+}
+
+TEST(BufferPoolTest, WorkersFreeTheirCacheOnExit) {
+    BufferPool::clear();
+    {
+        ThreadPool pool(2);
+        for (int k = 0; k < 4; ++k) pool.submit([] { Tensor t({16, 16}, {"a", "b"}); });
+        pool.wait();
+        EXPECT_GT(BufferPool::stats().cached_bytes, 0u);
+    }
+    EXPECT_EQ(BufferPool::stats().cached_bytes, 0u);
+}
+
+TEST(BufferPoolTest, OnlyMissesCountAsAllocations) {
+    BufferPool::clear();
+    Profiler::set_enabled(true);
+    const ProfileSnapshot before = Profiler::global().snapshot();
+    { Tensor t({6, 7}, {"a", "b"}); }
+    Tensor u({7, 6}, {"a", "b"});
+    const ProfileSnapshot d = Profiler::global().snapshot() - before;
+    Profiler::set_enabled(false);
+    EXPECT_EQ(d.bytes_allocated, 42 * sizeof(Tensor::Scalar));
+}
+
+TEST(BufferPoolTest, SteadyTrotterStepsAllocateNoTensors) {
+    const int n = 8, d = 2;
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(random_hermitian(d)));
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(random_hermitian(d * d)));
+    TruncationParams truncation;
+    truncation.max_bond_dim = 4;
+
+    TimeEvolutionSolver warmup(1.0, 10, onsite);
+    warmup.set_bond_operators(bonds);
+    warmup.set_truncation(truncation);
+    warmup.initialize_state(MatrixProductState::product_state(
+        std::vector<Eigen::VectorXcd>(n, Eigen::VectorXcd::Ones(d).normalized())));
+    warmup.build_network({});
+    const MatrixProductState entangled = warmup.state();
+    ASSERT_EQ(entangled.max_bond_dim(), 4);
+
+    // the bonds are at the cap, so every step repeats the shapes; the first
+    // run fills the pool and the second is served from it
+    for (int run = 0; run < 2; ++run) {
+        BufferPool::reset_stats();
+        TimeEvolutionSolver solver(0.05, 3, onsite);
+        solver.set_bond_operators(bonds);
+        solver.set_truncation(truncation);
+        solver.initialize_state(entangled);
+        solver.build_network({});
+    }
+    const BufferPoolStats s = BufferPool::stats();
+    EXPECT_GT(s.hits, 0u);
+    EXPECT_EQ(s.misses, 0u);
+}
@@ -0,0 +1,291 @@
+#include <gtest/gtest.h>
+#include <Eigen/Dense>
+#include <unsupported/Eigen/KroneckerProduct>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include "solver/checkpoint.hh"
+#include "solver/solver.hh"
+
+using namespace qps;
+
+namespace {
+
+std::string temp_path(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+Tensor random_tensor(const std::vector<int>& dims, const std::vector<std::string>& idx) {
+    Tensor t(dims, idx);
+    t.vector_view() = Eigen::VectorXcd::Random(t.data.size());
+    return t;
+}
+
+} // namespace
+
+TEST(Checkpoint, RoundTripIsBitExact) {
+    const std::string path = temp_path("qps_roundtrip.qpsc");
+    Tensor a = random_tensor({3, 2, 5}, {"b_0", "s_0", "b_1"});
+    Tensor b = random_tensor({7}, {"i"});
+    {
+        CheckpointWriter writer(path);
+        writer.set_params("{\"dt\": 0.1}");
+        writer.write("site_0", a, 1, 0.1);
+        writer.write("site_0", b, 2, 0.2);
+        writer.write("scalar", Tensor({}, {}), 2, 0.2);
+    }
+
+    CheckpointReader reader(path);
+    ASSERT_EQ(reader.records().size(), 3u);
+    const CheckpointRecord& r = reader.records()[0];
+    EXPECT_EQ(r.name, "site_0");
+    EXPECT_EQ(r.dims, (std::vector<int64_t>{3, 2, 5}));
+    EXPECT_EQ(r.index_names, (std::vector<std::string>{"b_0", "s_0", "b_1"}));
+    EXPECT_EQ(r.params, "{\"dt\": 0.1}");
+    EXPECT_EQ(r.step, 1);
+    EXPECT_EQ(r.payload_offset % 64, 0u);
+
+    // uncompressed payloads are used in place, and nothing is rounded
+    const std::complex<double>* mapped = reader.data(r);
+    for (Eigen::Index i = 0; i < a.data.size(); ++i) EXPECT_EQ(mapped[i], a.data(i));
+    Tensor back = reader.read(reader.records()[reader.find("site_0")]);
+    EXPECT_EQ(back.dimensions, b.dimensions);
+    EXPECT_EQ((back.vector_view() - b.vector_view()).norm(), 0.0);
+    EXPECT_EQ(reader.find("site_0", 1), 0);
+    EXPECT_EQ(reader.find("missing"), -1);
+    EXPECT_EQ(reader.read(reader.records()[2]).rank(), 0);
+    std::remove(path.c_str());
+}
+
+TEST(Checkpoint, CompressionAndTruncatedTail) {
+    const std::string path = temp_path("qps_compressed.qpsc");
+    Tensor sparse({64, 64}, {"i", "j"});
+    sparse.data(3, 5) = 1.5;
+    try {
+        CheckpointWriter writer(path, Compression::zlib);
+        writer.write("rho", sparse, 1, 0.5);
+        writer.write("rho", sparse, 2, 1.0);
+    } catch (const std::runtime_error&) {
+        GTEST_SKIP() << "built without zlib";
+    }
+
+    {
+        CheckpointReader reader(path);
+        ASSERT_EQ(reader.records().size(), 2u);
+        EXPECT_LT(reader.records()[0].payload_bytes, reader.records()[0].raw_bytes / 10);
+        EXPECT_EQ(reader.read(reader.records()[1]).data(3, 5), Tensor::Scalar(1.5));
+        EXPECT_THROW(reader.data(reader.records()[0]), std::runtime_error);
+    }
+
+    // a partially written last record is ignored, and appending replaces it
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 10);
+    EXPECT_EQ(CheckpointReader(path).records().size(), 1u);
+    {
+        CheckpointWriter writer(path, Compression::zlib, true);
+        writer.write("rho", sparse, 2, 1.0);
+    }
+    EXPECT_EQ(CheckpointReader(path).records().size(), 2u);
+    std::remove(path.c_str());
+}
+
+TEST(Checkpoint, SolversWriteOneFilePerRun) {
+    const std::string dir = temp_path("qps_checkpoint_run");
+    std::filesystem::create_directories(dir);
+
+    Eigen::Matrix2d H;
+    H << 1, 2,
+         2, -1;
+    Eigen::Vector2d psi0;
+    psi0 << 1, 0;
+    TimeEvolutionSolver solver(1.0, 4, {Tensor::from_matrix(H), Tensor::from_matrix(H)});
+    solver.set_checkpoint_dir(dir);
+    Eigen::VectorXcd psi = Eigen::VectorXcd::Zero(4);
+    psi(0) = 1.0;
+    solver.initialize_state(Tensor::from_vector(psi));
+    solver.build_network({});
+
+    CheckpointReader reader(dir + "/states.qpsc");
+    ASSERT_EQ(reader.records().size(), 16u);  // 4 steps x (2 sites, mps_meta, commit)
+    EXPECT_EQ(reader.last_commit(), 15);
+    const CheckpointRecord& last = reader.records()[reader.find("site_1")];
+    EXPECT_EQ(last.step, 4);
+    EXPECT_DOUBLE_EQ(last.time, 1.0);
+    EXPECT_NE(last.params.find("\"solver\": \"tebd\""), std::string::npos);
+    // the snapshot is taken after the step's measurements, so it is the final state
+    Tensor site = reader.read(last);
+    EXPECT_EQ((site.vector_view() - solver.state().site(1).vector_view()).norm(), 0.0);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Checkpoint, AppendDropsUncommittedRecords) {
+    const std::string path = temp_path("qps_commit.qpsc");
+    Tensor a = random_tensor({4}, {"i"});
+    {
+        CheckpointWriter writer(path);
+        writer.write("a", a, 1, 0.1);
+        writer.commit(1, 0.1);
+        writer.write("a", a, 2, 0.2);  // never committed
+    }
+    EXPECT_EQ(CheckpointReader(path).records().size(), 3u);
+    {
+        CheckpointWriter writer(path, Compression::none, true);
+    }
+    CheckpointReader reader(path);
+    ASSERT_EQ(reader.records().size(), 2u);
+    EXPECT_EQ(reader.last_commit(), 1);
+    EXPECT_EQ(reader.records()[1].step, 1);
+    std::remove(path.c_str());
+}
+
+TEST(Checkpoint, PeriodicPolicy) {
+    const std::string dir = temp_path("qps_checkpoint_policy");
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    Eigen::Matrix2d H;
+    H << 0.5, 0.2,
+         0.2, -0.5;
+    ThermalSolver solver(1.0, 10, {Tensor::from_matrix(H)});
+    solver.set_checkpoint_dir(dir);
+    CheckpointPolicy policy;
+    policy.every_steps = 4;
+    solver.set_checkpoint_policy(policy);
+    solver.initialize_state(Tensor::from_matrix(Eigen::Matrix2d::Identity()));
+    solver.build_network({});
+
+    // snapshots after steps 4, 8 and the last one
+    CheckpointReader reader(dir + "/states.qpsc");
+    std::vector<int64_t> committed;
+    for (const auto& r : reader.records()) {
+        if (r.name == CheckpointReader::kCommitRecord) committed.push_back(r.step);
+    }
+    EXPECT_EQ(committed, (std::vector<int64_t>{4, 8, 10}));
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Checkpoint, TebdResumeMatchesUninterruptedRun) {
+    const std::string dir = temp_path("qps_resume_tebd");
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    Eigen::Matrix2d H;
+    H << 1, 2,
+         2, -1;
+    Eigen::Matrix4d bond = Eigen::Matrix4d::Identity();
+    bond(1, 2) = bond(2, 1) = 0.5;
+    const std::vector<Tensor> ops = {Tensor::from_matrix(H), Tensor::from_matrix(H), Tensor::from_matrix(H)};
+    Eigen::VectorXcd psi = Eigen::VectorXcd::Zero(8);
+    psi(1) = 1.0;
+    auto make_solver = [&] {
+        auto solver = std::make_unique<TimeEvolutionSolver>(1.0, 6, ops);
+        solver->set_bond_operators({Tensor::from_matrix(bond), Tensor::from_matrix(bond)});
+        solver->set_checkpoint_dir(dir);
+        CheckpointPolicy policy;
+        policy.every_steps = 3;
+        solver->set_checkpoint_policy(policy);
+        return solver;
+    };
+
+    auto full = make_solver();
+    EXPECT_FALSE(full->resume());  // nothing to resume from yet
+    full->initialize_state(Tensor::from_vector(psi));
+    full->build_network({});
+
+    // simulate a crash during the last snapshot: cut the file inside it
+    const std::string path = dir + "/states.qpsc";
+    {
+        CheckpointReader reader(path);
+        const CheckpointRecord& step3 = reader.records()[reader.find(CheckpointReader::kCommitRecord, 3)];
+        std::filesystem::resize_file(path, step3.payload_offset + step3.payload_bytes + 100);
+    }
+
+    auto resumed = make_solver();
+    ASSERT_TRUE(resumed->resume());
+    EXPECT_EQ(resumed->start_step(), 3);
+    resumed->build_network({});
+
+    // identical operations on identical data: the result is bit-exact
+    EXPECT_EQ(resumed->state().to_dense(), full->state().to_dense());
+    EXPECT_EQ(resumed->state().truncation_error(), full->state().truncation_error());
+    CheckpointReader reader(path);
+    EXPECT_EQ(reader.records()[reader.last_commit()].step, 6);
+
+    // a checkpoint from a different configuration is rejected
+    TimeEvolutionSolver other(2.0, 6, ops);
+    other.set_checkpoint_dir(dir);
+    EXPECT_THROW(other.resume(), std::runtime_error);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Checkpoint, ThermalResumeMatchesUninterruptedRun) {
+    const std::string dir = temp_path("qps_resume_thermal");
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    Eigen::Matrix2d H;
+    H << 0.5, 0.2,
+         0.2, -0.5;
+    ThermalSolver full(1.0, 8, {Tensor::from_matrix(H)});
+    full.set_checkpoint_dir(dir);
+    full.initialize_state(Tensor::from_matrix(Eigen::Matrix2d::Identity()));
+    full.build_network({});
+
+    // keep only the snapshots up to step 5
+    const std::string path = dir + "/states.qpsc";
+    {
+        CheckpointReader reader(path);
+        const CheckpointRecord& step5 = reader.records()[reader.find(CheckpointReader::kCommitRecord, 5)];
+        std::filesystem::resize_file(path, step5.payload_offset + step5.payload_bytes);
+    }
+
+    ThermalSolver resumed(1.0, 8, {Tensor::from_matrix(H)});
+    resumed.set_checkpoint_dir(dir);
+    ASSERT_TRUE(resumed.resume());
+    EXPECT_EQ(resumed.start_step(), 5);
+    resumed.build_network({});
+    EXPECT_EQ(resumed.state().matrix_view(), full.state().matrix_view());
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Checkpoint, DmrgResumeContinuesTheSweeps) {
+    const std::string dir = temp_path("qps_resume_dmrg");
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    // transverse-field ising chain on 6 sites
+    Eigen::Matrix2d x, z;
+    x << 0, 1, 1, 0;
+    z << 1, 0, 0, -1;
+    Eigen::Matrix4d zz = -Eigen::kroneckerProduct(z, z);
+    std::vector<Tensor> onsite(6, Tensor::from_matrix(Eigen::Matrix2d(-0.9 * x)));
+    std::vector<Tensor> bonds(5, Tensor::from_matrix(zz));
+    Eigen::VectorXcd psi = Eigen::VectorXcd::Ones(64) / 8.0;
+
+    DMRGSolver full(onsite);
+    full.set_bond_operators(bonds);
+    full.initialize_state(Tensor::from_vector(psi));
+    full.build_network({});
+    ASSERT_TRUE(full.converged());
+
+    DMRGParams one_sweep;
+    one_sweep.max_sweeps = 1;
+    DMRGSolver first(onsite);
+    first.set_bond_operators(bonds);
+    first.set_params(one_sweep);
+    first.set_checkpoint_dir(dir);
+    first.initialize_state(Tensor::from_vector(psi));
+    first.build_network({});
+
+    DMRGSolver resumed(onsite);
+    resumed.set_bond_operators(bonds);
+    resumed.set_checkpoint_dir(dir);
+    ASSERT_TRUE(resumed.resume());
+    EXPECT_EQ(resumed.start_step(), 1);
+    EXPECT_DOUBLE_EQ(resumed.energy(), first.energy());
+    resumed.build_network({});
+    EXPECT_TRUE(resumed.converged());
+    EXPECT_NEAR(resumed.energy(), full.energy(), 1e-10);
+    std::filesystem::remove_all(dir);
+}
@@ -39,8 +39,8 @@ TEST(EigenTest, SVD) {
     Eigen::JacobiSVD<Eigen::Matrix3d> svd(mat, Eigen::ComputeFullU | Eigen::ComputeFullV);
     
     // test orthogonality of u and v
-    EXPECT_NEAR((svd.matrixU() * svd.matrixU().transpose()).norm(), 3.0, 1e-10);
-    EXPECT_NEAR((svd.matrixV() * svd.matrixV().transpose()).norm(), 3.0, 1e-10);
+    EXPECT_NEAR((svd.matrixU() * svd.matrixU().transpose()).norm(), std::sqrt(3.0), 1e-10);
+    EXPECT_NEAR((svd.matrixV() * svd.matrixV().transpose()).norm(), std::sqrt(3.0), 1e-10);
 
     // test reconstruction
     Eigen::Matrix3d reconstructed = svd.matrixU() * svd.singularValues().asDiagonal() * svd.matrixV().transpose();
@@ -79,9 +79,7 @@ TEST(TensorNetworkTest, FourTensorContraction) {
     network.add_tensor(result1, "AB");
     auto result2 = network.contract("C", "D", {"l"});
     network.add_tensor(result2, "CD");
-    auto result3 = network.contract("AB", "CD", {"k"});
-    network.add_tensor(result3, "ABCD");
-    auto final_result = network.contract("ABCD", "i", {"i"});
+    auto final_result = network.contract("AB", "CD", {"k", "i"});
 
     // compute expected result directly using matrix multiplication
     Eigen::Matrix2d matA, matB, matC, matD;
@@ -93,5 +91,7 @@ TEST(TensorNetworkTest, FourTensorContraction) {
     double expected = (matA * matB * matC * matD).trace();
 
     // compare results
-    EXPECT_NEAR(final_result.data(0), expected, 1e-10);
+    EXPECT_EQ(final_result.rank(), 0);
+    EXPECT_NEAR(final_result.data(0).real(), expected, 1e-10);
+    EXPECT_NEAR(final_result.data(0).imag(), 0.0, 1e-10);
 } 
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <Eigen/Dense>
+#include <atomic>
+#include "solver/ensemble.hh"
+
+using namespace qps;
+
+namespace {
+
+// two-site TEBD chain with on-site field params[0]
+std::unique_ptr<Solver> make_chain(const std::vector<double>& params) {
+    Eigen::Matrix2d H;
+    H << params.at(0), 1,
+         1, -params.at(0);
+    return std::make_unique<TimeEvolutionSolver>(0.5, 5, std::vector<Tensor>{Tensor::from_matrix(H),
+                                                                             Tensor::from_matrix(H)});
+}
+
+Tensor basis_state(int k) {
+    Eigen::VectorXcd psi = Eigen::VectorXcd::Zero(4);
+    psi(k) = 1.0;
+    return Tensor::from_vector(psi);
+}
+
+} // namespace
+
+TEST(ThreadPool, RunsEveryTaskIncludingNestedOnes) {
+    ThreadPool pool(4);
+    std::atomic<int> count{0};
+    for (int i = 0; i < 50; ++i) {
+        pool.submit([&] {
+            // tasks spawned by a worker land on its own deque
+            for (int k = 0; k < 10; ++k) pool.submit([&] { ++count; });
+            ++count;
+        });
+    }
+    pool.wait();
+    EXPECT_EQ(count.load(), 50 * 11);
+
+    // a throwing task is reported by wait, and the pool stays usable
+    pool.submit([] { throw std::runtime_error("boom"); });
+    EXPECT_THROW(pool.wait(), std::runtime_error);
+    pool.submit([&] { ++count; });
+    pool.wait();
+    EXPECT_EQ(count.load(), 50 * 11 + 1);
+}
+
+TEST(Ensemble, MatchesSerialRunsInJobOrder) {
+    std::vector<EnsembleJob> jobs;
+    for (int j = 0; j < 12; ++j) jobs.push_back({{0.1 * (j % 3)}, basis_state(j % 4)});
+
+    PropagatorCache cache;
+    EnsembleRunner runner(make_chain, 3);
+    runner.set_propagator_cache(cache);
+    std::vector<EnsembleResult> results = runner.run(jobs);
+
+    ASSERT_EQ(results.size(), jobs.size());
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        auto solver = make_chain(jobs[j].params);
+        solver->initialize_state(jobs[j].initial_state);
+        solver->build_network(jobs[j].params);
+        EXPECT_TRUE(results[j].ok()) << results[j].error;
+        EXPECT_EQ(results[j].job, j);
+        EXPECT_GE(results[j].worker, 0);
+        EXPECT_NEAR(results[j].value, solver->compute_quantity_of_interest(), 1e-12);
+    }
+    // jobs with the same field share their propagators: one two-site and one
+    // one-site exponential per distinct field
+    EXPECT_EQ(cache.size(), 2u * 3);
+    EXPECT_EQ(cache.hits() + cache.misses(), 2u * 12);
+    EXPECT_EQ(runner.summary().jobs, 12u);
+    EXPECT_EQ(runner.summary().failed, 0u);
+    EXPECT_NEAR(runner.summary().mean, 1.0, 1e-10);  // unitary evolution keeps the norm
+    EXPECT_GT(runner.summary().throughput(), 0.0);
+}
+
+TEST(Ensemble, FailedJobsAreReportedNotFatal) {
+    std::vector<EnsembleJob> jobs = {{{0.3}, basis_state(0)}, {{}, basis_state(0)}, {{0.3}, basis_state(1)}};
+    EnsembleRunner runner(make_chain, 2);
+    std::vector<EnsembleResult> results = runner.run(jobs);
+    EXPECT_TRUE(results[0].ok());
+    EXPECT_FALSE(results[1].ok());  // params.at(0) throws
+    EXPECT_TRUE(results[2].ok());
+    EXPECT_EQ(runner.summary().failed, 1u);
+    EXPECT_NEAR(runner.summary().min, 1.0, 1e-10);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <Eigen/Dense>
+#include <unsupported/Eigen/MatrixFunctions>
+#include "solver/fixed_kernels.hh"
+#include "solver/mps.hh"
+
+using namespace qps;
+
+namespace {
+
+Tensor random_tensor(const std::vector<int>& dims) {
+    std::vector<IndexId> idx;
+    for (size_t k = 0; k < dims.size(); ++k) idx.push_back(IndexId("i" + std::to_string(k)));
+    Tensor t(dims, idx);
+    t.vector_view() = Eigen::VectorXcd::Random(t.data.size());
+    return t;
+}
+
+} // namespace
+
+TEST(FixedKernelsTest, MatrixExponential) {
+    for (int d : {2, 3, 4, 5, 6, 9}) {
+        const Eigen::MatrixXcd a = Eigen::MatrixXcd::Random(d, d);
+        const Eigen::MatrixXcd expected = a.exp();
+        EXPECT_LT((matrix_exponential(a) - expected).norm(), 1e-12 * expected.norm()) << "d = " << d;
+    }
+    // degenerate 2 x 2 cases: a multiple of the identity and a nilpotent part
+    Eigen::MatrixXcd scalar = Eigen::MatrixXcd::Identity(2, 2) * std::complex<double>(0.3, -1.1);
+    EXPECT_LT((matrix_exponential(scalar) - Eigen::MatrixXcd(scalar.exp())).norm(), 1e-14);
+    Eigen::MatrixXcd nilpotent = Eigen::MatrixXcd::Zero(2, 2);
+    nilpotent(0, 1) = 2.0;
+    EXPECT_LT((matrix_exponential(nilpotent) - Eigen::MatrixXcd(nilpotent.exp())).norm(), 1e-14);
+    EXPECT_THROW(matrix_exponential(Eigen::MatrixXcd::Zero(2, 3)), std::runtime_error);
+}
+
+TEST(FixedKernelsTest, GatesMatchContraction) {
+    for (int d : {2, 3}) {
+        Tensor site = random_tensor({5, d, 7});
+        const Eigen::MatrixXcd gate = Eigen::MatrixXcd::Random(d, d);
+        // gate_(t, s) a_(l, s, r), permuted back to (l, t, r)
+        Tensor expected = permute(contract_tensors(Tensor::from_matrix(gate, {"t", "s"}), site, {{1, 1}}),
+                                  {1, 0, 2});
+        ASSERT_TRUE(apply_fixed_gate(gate, site));
+        EXPECT_LT((site.vector_view() - expected.vector_view()).norm(), 1e-12);
+    }
+    for (auto dims : {std::pair<int, int>{2, 2}, {2, 3}, {3, 3}}) {
+        const int d1 = dims.first, d2 = dims.second;
+        Tensor theta = random_tensor({4, d1, d2, 3});
+        const Eigen::MatrixXcd gate = Eigen::MatrixXcd::Random(d1 * d2, d1 * d2);
+        // the gate in kronecker order as a (t1, t2, s1, s2) tensor is the
+        // column-major (t2, t1, s2, s1) one
+        Tensor g({d2, d1, d2, d1}, {"t2", "t1", "s2", "s1"});
+        g.matrix_view(2) = gate;
+        Tensor expected = permute(contract_tensors(g, theta, {{3, 1}, {2, 2}}), {2, 1, 0, 3});
+        ASSERT_TRUE(apply_fixed_gate(gate, theta));
+        EXPECT_LT((theta.vector_view() - expected.vector_view()).norm(), 1e-12);
+    }
+    Tensor wide = random_tensor({2, 5, 2});
+    EXPECT_FALSE(apply_fixed_gate(Eigen::MatrixXcd::Identity(5, 5), wide));
+}
+
+TEST(FixedKernelsTest, MpsGatesUseTheKernels) {
+    // the same gates on d = 2 (fixed kernels) and through a local update
+    // (generic path) give the same state
+    const int n = 5;
+    std::vector<Eigen::VectorXcd> states;
+    for (int i = 0; i < n; ++i) states.push_back(Eigen::VectorXcd::Random(2));
+    MatrixProductState fixed = MatrixProductState::product_state(states);
+    MatrixProductState generic = fixed;
+    const Eigen::MatrixXcd bond = Eigen::MatrixXcd::Random(4, 4);
+    const Eigen::MatrixXcd one = Eigen::MatrixXcd::Random(2, 2);
+    auto by = [](const Eigen::MatrixXcd& gate) {
+        return [gate](const Eigen::Ref<const Eigen::MatrixXcd>& block) { return Eigen::MatrixXcd(gate * block); };
+    };
+    const TruncationParams exact{64, 0.0};
+    for (int i = 0; i + 1 < n; ++i) {
+        fixed.apply_two_site_gate(bond, i, exact);
+        generic.apply_two_site(by(bond), i, exact);
+    }
+    fixed.apply_one_site_gate(one, 2);
+    generic.apply_one_site(by(one), 2);
+    fixed.apply_layer({{0, {}, &bond}, {2, {}, &bond}}, exact);
+    generic.apply_layer({{0, by(bond)}, {2, by(bond)}}, exact);
+    EXPECT_LT((fixed.to_dense() - generic.to_dense()).norm(), 1e-10 * generic.to_dense().norm());
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <Eigen/Dense>
+#include <unsupported/Eigen/KroneckerProduct>
+#include <unsupported/Eigen/MatrixFunctions>
+#include "solver/krylov.hh"
+#include "solver/solver.hh"
+
+using namespace qps;
+
+namespace {
+
+Eigen::MatrixXcd random_hermitian(int d) {
+    Eigen::MatrixXcd a = Eigen::MatrixXcd::Random(d, d);
+    return (a + a.adjoint()) / 2.0;
+}
+
+// truncated bosonic mode: H = omega n + U n (n - 1) / 2 + g (a + a^dagger)
+Eigen::MatrixXcd bose_site(int d) {
+    Eigen::MatrixXcd h = Eigen::MatrixXcd::Zero(d, d);
+    for (int n = 0; n < d; ++n) {
+        h(n, n) = 1.0 * n + 0.25 * n * (n - 1);
+        if (n + 1 < d) h(n, n + 1) = h(n + 1, n) = 0.3 * std::sqrt(n + 1.0);
+    }
+    return h;
+}
+
+} // namespace
+
+TEST(Krylov, MatchesDenseExponential) {
+    const int d = 60;
+    Eigen::MatrixXcd H = random_hermitian(d);
+    Eigen::MatrixXcd v = Eigen::MatrixXcd::Random(d, 3);
+
+    KrylovStats stats;
+    Eigen::MatrixXcd real_time = expmv(H, std::complex<double>(0, -0.7), v, KrylovParams(), &stats);
+    Eigen::MatrixXcd expected = (std::complex<double>(0, -0.7) * H).exp() * v;
+    EXPECT_NEAR((real_time - expected).norm() / v.norm(), 0.0, 1e-10);
+    EXPECT_NEAR(real_time.norm(), v.norm(), 1e-10);  // unitary
+    EXPECT_LT(stats.max_dim_used, d);
+
+    Eigen::MatrixXcd imag_time = expmv(H, -0.4, v);
+    Eigen::MatrixXcd expected_imag = (-0.4 * H).exp() * v;
+    EXPECT_NEAR((imag_time - expected_imag).norm() / expected_imag.norm(), 0.0, 1e-10);
+}
+
+TEST(Krylov, SplitsStepsWhenTheSpaceIsCapped) {
+    Eigen::MatrixXcd H = random_hermitian(40);
+    Eigen::VectorXcd v = Eigen::VectorXcd::Random(40);
+
+    KrylovParams small;
+    small.max_dim = 6;
+    KrylovStats stats;
+    Eigen::MatrixXcd y = expmv(H, std::complex<double>(0, -3.0), v, small, &stats);
+    Eigen::VectorXcd expected = (std::complex<double>(0, -3.0) * H).exp() * v;
+    EXPECT_GT(stats.substeps, 1);
+    EXPECT_LE(stats.max_dim_used, 6);
+    EXPECT_NEAR((y - expected).norm() / v.norm(), 0.0, 1e-9);
+}
+
+TEST(Krylov, LowestEigenpair) {
+    const int d = 120;
+    Eigen::MatrixXcd H = random_hermitian(d);
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXcd> exact(H);
+
+    // a small space forces restarts
+    KrylovParams params;
+    params.max_dim = 25;
+    params.tolerance = 1e-9;
+    KrylovStats stats;
+    Eigen::MatrixXcd v = Eigen::MatrixXcd::Random(d, 1);
+    const double e = lowest_eigenpair(
+        [&H](const Eigen::MatrixXcd& x, Eigen::MatrixXcd& y) { y.noalias() = H * x; }, v, params, &stats);
+    EXPECT_NEAR(e, exact.eigenvalues()(0), 1e-10);
+    EXPECT_NEAR(v.norm(), 1.0, 1e-12);
+    EXPECT_LE((H * v - e * v).norm(), 1e-9);
+    EXPECT_GT(stats.substeps, 1);
+    EXPECT_LE(stats.max_error_estimate, 1e-9);
+}
+
+TEST(Krylov, TebdModesAgree) {
+    // two coupled bosonic sites, truncated at d = 12
+    const int n = 4, d = 12;
+    Eigen::MatrixXcd a = Eigen::MatrixXcd::Zero(d, d);
+    for (int k = 0; k + 1 < d; ++k) a(k, k + 1) = std::sqrt(k + 1.0);
+    Eigen::MatrixXcd hop = -0.5 * (Eigen::kroneckerProduct(a.adjoint(), a).eval() +
+                                   Eigen::kroneckerProduct(a, a.adjoint()).eval());
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(bose_site(d)));
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(hop));
+    Eigen::VectorXcd vac = Eigen::VectorXcd::Zero(d);
+    vac(1) = 1.0;  // one boson per site
+
+    auto run = [&](PropagationMode mode) {
+        TimeEvolutionSolver solver(0.5, 10, onsite);
+        solver.set_bond_operators(bonds);
+        solver.set_propagation_mode(mode);
+        solver.initialize_state(MatrixProductState::product_state(std::vector<Eigen::VectorXcd>(n, vac)));
+        solver.build_network({});
+        return solver.state().to_dense();
+    };
+    Eigen::VectorXcd dense = run(PropagationMode::dense);
+    Eigen::VectorXcd krylov = run(PropagationMode::krylov);
+    EXPECT_NEAR((dense - krylov).norm(), 0.0, 1e-9);
+}
+
+TEST(Krylov, ThermalModesAgree) {
+    Eigen::MatrixXcd H = bose_site(20);
+    auto run = [&](PropagationMode mode) {
+        ThermalSolver solver(2.0, 8, {Tensor::from_matrix(H)});
+        solver.set_propagation_mode(mode);
+        solver.initialize_state(Tensor::from_matrix(Eigen::MatrixXcd::Identity(20, 20)));
+        solver.build_network({});
+        EXPECT_NEAR(solver.compute_quantity_of_interest(), 1.0, 1e-10);
+        return solver.krylov_stats().calls;
+    };
+    EXPECT_EQ(run(PropagationMode::dense), 0);
+    EXPECT_EQ(run(PropagationMode::krylov), 8);
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <Eigen/Dense>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include "solver/metrics.hh"
+#include "solver/solver.hh"
+
+using namespace qps;
+
+namespace {
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+int count(const std::string& text, const std::string& needle) {
+    int n = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) ++n;
+    return n;
+}
+
+// runs a two-site TEBD evolution with the given metrics settings and returns
+// the checkpoint directory
+std::string run_tebd(const std::string& name, const MetricsConfig& config, int num_steps) {
+    const std::string dir = (std::filesystem::temp_directory_path() / name).string();
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    Eigen::Matrix2d H;
+    H << 1, 2,
+         2, -1;
+    TimeEvolutionSolver solver(1.0, num_steps, {Tensor::from_matrix(H), Tensor::from_matrix(H)});
+    solver.set_checkpoint_dir(dir);
+    solver.set_metrics(config);
+    Eigen::VectorXcd psi = Eigen::VectorXcd::Zero(4);
+    psi(0) = 1.0;
+    solver.initialize_state(Tensor::from_vector(psi));
+    solver.build_network({});
+    return dir;
+}
+
+} // namespace
+
+TEST(Metrics, QueuePreservesOrderAcrossThreads) {
+    SpscQueue<int> queue(8);
+    const int n = 20000;
+    std::thread consumer([&] {
+        int expected = 0;
+        int value;
+        while (expected < n) {
+            if (!queue.try_pop(value)) {
+                std::this_thread::yield();
+                continue;
+            }
+            ASSERT_EQ(value, expected);
+            ++expected;
+        }
+    });
+    for (int i = 0; i < n; ++i) {
+        while (!queue.try_push(i)) std::this_thread::yield();
+    }
+    consumer.join();
+}
+
+TEST(Metrics, WritesEveryStepByDefault) {
+    const std::string dir = run_tebd("qps_metrics_default", MetricsConfig(), 5);
+    const std::string json = read_file(dir + "/solver_data.json");
+    EXPECT_EQ(count(json, "\"total_energy\""), 5);
+    EXPECT_NE(json.find("\"dropped_records\": 0"), std::string::npos);
+    EXPECT_EQ(json.substr(json.size() - 2), "}\n");
+    // per-gate entries are opt-in
+    EXPECT_EQ(count(json, "\"site\""), 0);
+    EXPECT_EQ(count(read_file(dir + "/debug.log"), " forward "), 0);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Metrics, GateVerbosityLogsEveryGate) {
+    MetricsConfig config;
+    config.verbosity = Verbosity::gate;
+    const std::string dir = run_tebd("qps_metrics_gate", config, 5);
+    const std::string json = read_file(dir + "/solver_data.json");
+    EXPECT_EQ(count(json, "\"total_energy\""), 5);
+    if (verbosity_compiled_in<Verbosity::gate>) {
+        // one entry per gate per sweep
+        EXPECT_EQ(count(json, "\"site\""), 5 * 2 * 2);
+        EXPECT_EQ(count(read_file(dir + "/debug.log"), " forward "), 5 * 2);
+    } else {
+        EXPECT_EQ(count(json, "\"site\""), 0);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Metrics, SamplingAndVerbosity) {
+    MetricsConfig config;
+    config.sample_every = 4;
+    const std::string dir = run_tebd("qps_metrics_sampled", config, 10);
+    // steps 0, 4, 8 and the last one
+    EXPECT_EQ(count(read_file(dir + "/solver_data.json"), "\"total_energy\""), 4);
+    std::filesystem::remove_all(dir);
+
+    config.sample_every = 1;
+    config.verbosity = Verbosity::summary;
+    const std::string summary = run_tebd("qps_metrics_summary", config, 10);
+    const std::string json = read_file(summary + "/solver_data.json");
+    EXPECT_EQ(count(json, "\"total_energy\""), 1);
+    EXPECT_NE(json.find("\"step\": 9"), std::string::npos);
+    EXPECT_EQ(count(json, "\"site\""), 0);
+    std::filesystem::remove_all(summary);
+
+    config.verbosity = Verbosity::off;
+    const std::string off = run_tebd("qps_metrics_off", config, 3);
+    EXPECT_FALSE(std::filesystem::exists(off + "/solver_data.json"));
+    EXPECT_TRUE(std::filesystem::exists(off + "/states.qpsc"));
+    std::filesystem::remove_all(off);
+}
+
+TEST(Metrics, DropPolicyNeverBlocks) {
+    const std::string dir = (std::filesystem::temp_directory_path() / "qps_metrics_drop").string();
+    std::filesystem::create_directories(dir);
+    MetricsConfig config;
+    config.backpressure = Backpressure::drop;
+    config.queue_capacity = 2;
+    MetricsSink sink(dir, "", config);
+    MetricRecord r;
+    r.kind = MetricRecord::Kind::step;
+    for (int i = 0; i < 10000; ++i) {
+        r.step = i;
+        sink.push(r);
+    }
+    sink.close();
+    // whatever was dropped is reported, and everything else was written
+    const std::string json = read_file(dir + "/solver_data.json");
+    const size_t dropped = sink.dropped();
+    EXPECT_EQ(count(json, "\"total_energy\"") + dropped, 10000u);
+    EXPECT_NE(json.find("\"dropped_records\": " + std::to_string(dropped)), std::string::npos);
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,529 @@
+#include <gtest/gtest.h>
+#include <Eigen/Dense>
+#include <unsupported/Eigen/KroneckerProduct>
+#include <unsupported/Eigen/MatrixFunctions>
+#include "solver/mps.hh"
+#include "solver/solver.hh"
+
+using namespace qps;
+
+namespace {
+
+Eigen::MatrixXcd pauli_x() {
+    Eigen::MatrixXcd m(2, 2);
+    m << 0, 1, 1, 0;
+    return m;
+}
+
+Eigen::MatrixXcd pauli_z() {
+    Eigen::MatrixXcd m(2, 2);
+    m << 1, 0, 0, -1;
+    return m;
+}
+
+// op acting on `site` of an n-site qubit chain (site 0 slowest)
+Eigen::MatrixXcd embed(const Eigen::MatrixXcd& op, int site, int span, int n) {
+    Eigen::MatrixXcd left = Eigen::MatrixXcd::Identity(1 << site, 1 << site);
+    int right_sites = n - site - span;
+    Eigen::MatrixXcd right = Eigen::MatrixXcd::Identity(1 << right_sites, 1 << right_sites);
+    Eigen::MatrixXcd tmp = Eigen::kroneckerProduct(left, op);
+    return Eigen::kroneckerProduct(tmp, right);
+}
+
+Eigen::VectorXcd random_state(int dim) {
+    Eigen::VectorXcd v = Eigen::VectorXcd::Random(dim);
+    return v / v.norm();
+}
+
+} // namespace
+
+TEST(MatrixProductState, DenseRoundTrip) {
+    Eigen::VectorXcd psi = random_state(2 * 3 * 2 * 2);
+    auto mps = MatrixProductState::from_dense(psi, {2, 3, 2, 2});
+    EXPECT_EQ(mps.num_sites(), 4);
+    EXPECT_EQ(mps.physical_dim(1), 3);
+    EXPECT_NEAR((mps.to_dense() - psi).norm(), 0.0, 1e-12);
+    EXPECT_NEAR(mps.norm(), 1.0, 1e-12);
+}
+
+TEST(MatrixProductState, CanonicalFormTracking) {
+    Eigen::VectorXcd psi = random_state(1 << 6);
+    auto mps = MatrixProductState::from_dense(psi, std::vector<int>(6, 2));
+    EXPECT_EQ(mps.center(), 5);
+
+    mps.move_center(2);
+    EXPECT_EQ(mps.center(), 2);
+    EXPECT_NEAR((mps.to_dense() - psi).norm(), 0.0, 1e-12);
+
+    // left of the center: sum_s A^dagger A = 1, right of it: sum_s B B^dagger = 1
+    for (int i = 0; i < 6; ++i) {
+        const Tensor& a = mps.site(i);
+        const int dl = a.dimensions[0], d = a.dimensions[1], dr = a.dimensions[2];
+        if (i < 2) {
+            Eigen::Map<const Eigen::MatrixXcd> m(a.data.data(), dl * d, dr);
+            EXPECT_NEAR(((m.adjoint() * m) - Eigen::MatrixXcd::Identity(dr, dr)).norm(), 0.0, 1e-12);
+        } else if (i > 2) {
+            Eigen::Map<const Eigen::MatrixXcd> m(a.data.data(), dl, d * dr);
+            EXPECT_NEAR(((m * m.adjoint()) - Eigen::MatrixXcd::Identity(dl, dl)).norm(), 0.0, 1e-12);
+        }
+    }
+}
+
+TEST(MatrixProductState, TwoSiteGateMatchesDense) {
+    const int n = 5;
+    Eigen::VectorXcd psi = random_state(1 << n);
+    auto mps = MatrixProductState::from_dense(psi, std::vector<int>(n, 2));
+
+    Eigen::MatrixXcd h = Eigen::kroneckerProduct(pauli_x(), pauli_z()).eval() +
+                         Eigen::kroneckerProduct(pauli_z(), pauli_z()).eval();
+    Eigen::MatrixXcd gate = (std::complex<double>(0, -0.3) * h).exp();
+
+    TruncationParams exact;
+    exact.max_bond_dim = 1 << n;
+    exact.max_discarded_weight = 0.0;
+    mps.apply_two_site_gate(gate, 1, exact);
+    mps.apply_two_site_gate(gate, 3, exact, false);
+
+    Eigen::VectorXcd expected = embed(gate, 3, 2, n) * (embed(gate, 1, 2, n) * psi);
+    EXPECT_NEAR((mps.to_dense() - expected).norm(), 0.0, 1e-10);
+    EXPECT_NEAR(mps.truncation_error(), 0.0, 1e-14);
+
+    std::complex<double> zz = mps.expectation_two_site(h, 2);
+    Eigen::VectorXcd dense = mps.to_dense();
+    EXPECT_NEAR(std::abs(zz - dense.dot(embed(h, 2, 2, n) * dense)), 0.0, 1e-10);
+}
+
+TEST(MatrixProductState, LayerMeasurementsKeepTheCanonicalForm) {
+    const int n = 6;
+    auto mps = MatrixProductState::from_dense(random_state(1 << n), std::vector<int>(n, 2));
+    Eigen::MatrixXcd zz = Eigen::kroneckerProduct(pauli_z(), pauli_z()).eval();
+    Eigen::MatrixXcd gate = (std::complex<double>(0, -0.3) * (zz + embed(pauli_x(), 0, 1, 2))).exp();
+    TruncationParams exact;
+    exact.max_bond_dim = 1 << n;
+    exact.max_discarded_weight = 0.0;
+    auto layer = [&](int parity) {
+        std::vector<MatrixProductState::LayerGate> gates;
+        for (int i = parity; i + 1 < n; i += 2) gates.push_back({i, MatrixProductState::LocalUpdate(), &gate});
+        return gates;
+    };
+    mps.apply_layer(layer(0), exact);
+    const Eigen::VectorXcd dense = mps.to_dense();
+    const double nrm2 = dense.squaredNorm();
+
+    const bool was_enabled = Profiler::enabled();
+    Profiler::set_enabled(true);
+    const ProfileSnapshot before = Profiler::global().snapshot();
+    // read from the bond spectra, without moving the center
+    for (int i = 0; i + 1 < n; ++i) {
+        EXPECT_NEAR(std::abs(mps.expectation_two_site(zz, i) - dense.dot(embed(zz, i, 2, n) * dense) / nrm2),
+                    0.0, 1e-10);
+        EXPECT_NEAR(std::abs(mps.expectation_one_site(pauli_x(), i) -
+                             dense.dot(embed(pauli_x(), i, 1, n) * dense) / nrm2), 0.0, 1e-10);
+    }
+    EXPECT_EQ(mps.center(), 0);
+    // so the next layer needs one svd per gate and no canonicalization sweep
+    mps.apply_layer(layer(1), exact);
+    const ProfileSnapshot after = Profiler::global().snapshot() - before;
+    Profiler::set_enabled(was_enabled);
+    EXPECT_EQ(after.phases[static_cast<size_t>(Phase::svd)].calls, layer(1).size());
+}
+
+TEST(MatrixProductState, TruncationByBondDimAndWeight) {
+    Eigen::VectorXcd psi = random_state(1 << 8);
+
+    TruncationParams capped;
+    capped.max_bond_dim = 4;
+    auto mps = MatrixProductState::from_dense(psi, std::vector<int>(8, 2), capped);
+    EXPECT_LE(mps.max_bond_dim(), 4);
+    EXPECT_GT(mps.truncation_error(), 0.0);
+
+    // a product state needs bond dimension 1 once negligible weight is dropped
+    Eigen::VectorXcd up(2), plus(2);
+    up << 1, 0;
+    plus << 1, 1;
+    auto product = MatrixProductState::product_state({up, plus, up, plus});
+    auto recompressed = MatrixProductState::from_dense(product.to_dense(), {2, 2, 2, 2});
+    EXPECT_EQ(recompressed.max_bond_dim(), 1);
+    EXPECT_NEAR(std::abs(recompressed.overlap(product)), product.norm() * recompressed.norm(), 1e-12);
+}
+
+TEST(MatrixProductState, SinglePrecisionSitesMatchDouble) {
+    const int n = 6;
+    Eigen::VectorXcd psi = random_state(1 << n);
+    auto full = MatrixProductState::from_dense(psi, std::vector<int>(n, 2));
+    BasicMatrixProductState<std::complex<float>> single = full.cast<std::complex<float>>();
+    EXPECT_EQ(2 * single.memory_bytes(), full.memory_bytes());
+
+    Eigen::MatrixXcd h = Eigen::MatrixXcd::Random(4, 4);
+    h = (h + h.adjoint()).eval();
+    const Eigen::MatrixXcd gate = (std::complex<double>(0, -0.3) * h).exp();
+    for (int site : {0, 2, 4, 1}) {
+        full.apply_two_site_gate(gate, site, TruncationParams());
+        single.apply_two_site_gate(gate, site, TruncationParams());
+    }
+    full.apply_one_site_gate(pauli_x(), 3);
+    single.apply_one_site_gate(pauli_x(), 3);
+    // the layered path keeps the spectra in double
+    std::vector<MatrixProductState::LayerGate> layer{{1, {}, &gate}, {3, {}, &gate}};
+    std::vector<BasicMatrixProductState<std::complex<float>>::LayerGate> single_layer{{1, {}, &gate}, {3, {}, &gate}};
+    full.apply_layer(layer, TruncationParams());
+    single.apply_layer(single_layer, TruncationParams());
+
+    EXPECT_LT((widen(single).to_dense() - full.to_dense()).norm(), 1e-5);
+    EXPECT_NEAR(single.norm(), full.norm(), 1e-5);
+    EXPECT_NEAR(std::abs(single.expectation_two_site(h, 2) - full.expectation_two_site(h, 2)), 0.0, 1e-5);
+}
+
+TEST(TimeEvolution, TebdMatchesExactEvolution) {
+    // transverse-field ising chain H = -sum Z_i Z_{i+1} - g sum X_i
+    const int n = 6;
+    const double g = 0.8, t = 0.5;
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(Eigen::MatrixXcd(-g * pauli_x())));
+    Eigen::MatrixXcd zz = -Eigen::kroneckerProduct(pauli_z(), pauli_z()).eval();
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(zz));
+
+    Eigen::MatrixXcd H = Eigen::MatrixXcd::Zero(1 << n, 1 << n);
+    for (int i = 0; i < n; ++i) H += embed(-g * pauli_x(), i, 1, n);
+    for (int i = 0; i + 1 < n; ++i) H += embed(zz, i, 2, n);
+
+    Eigen::VectorXcd psi0 = Eigen::VectorXcd::Zero(1 << n);
+    psi0(0) = 1.0;  // all spins up
+
+    TimeEvolutionSolver solver(t, 50, onsite);
+    solver.set_bond_operators(bonds);
+    solver.initialize_state(Tensor::from_vector(psi0));
+    solver.build_network({});
+
+    Eigen::VectorXcd exact = (std::complex<double>(0, -t) * H).exp() * psi0;
+    Eigen::VectorXcd tebd = solver.state().to_dense();
+    EXPECT_NEAR(solver.compute_quantity_of_interest(), 1.0, 1e-10);
+    EXPECT_LT((tebd - exact).norm(), 1e-3);
+
+    // energy is conserved by unitary evolution
+    double e0 = psi0.dot(H * psi0).real();
+    EXPECT_NEAR(solver.energy(), e0, 1e-3);
+}
+
+TEST(TimeEvolution, LongChainStaysBounded) {
+    const int n = 80;
+    Eigen::MatrixXcd hx = -0.5 * pauli_x();
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(hx));
+    Eigen::MatrixXcd zz = -Eigen::kroneckerProduct(pauli_z(), pauli_z()).eval();
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(zz));
+
+    Eigen::VectorXcd up(2);
+    up << 1, 0;
+    TimeEvolutionSolver solver(0.4, 8, onsite);
+    solver.set_bond_operators(bonds);
+    TruncationParams truncation;
+    truncation.max_bond_dim = 8;
+    solver.set_truncation(truncation);
+    solver.initialize_state(MatrixProductState::product_state(std::vector<Eigen::VectorXcd>(n, up)));
+    solver.build_network({});
+
+    EXPECT_LE(solver.state().max_bond_dim(), 8);
+    EXPECT_GT(solver.state().max_bond_dim(), 1);
+    EXPECT_NEAR(solver.compute_quantity_of_interest(), 1.0, 1e-10);
+    // polynomial memory: n * d * chi^2 complex numbers at most
+    EXPECT_LE(solver.state().memory_bytes(), n * 2 * 8 * 8 * sizeof(std::complex<double>));
+}
+
+TEST(TimeEvolution, TranslationInvariantChainSharesPropagators) {
+    const int n = 10;
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(Eigen::MatrixXcd(-0.7 * pauli_x())));
+    Eigen::MatrixXcd zz = -Eigen::kroneckerProduct(pauli_z(), pauli_z()).eval();
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(zz));
+    Eigen::VectorXcd up(2);
+    up << 1, 0;
+
+    PropagatorCache cache;
+    for (int run = 0; run < 2; ++run) {
+        TimeEvolutionSolver solver(0.2, 4, onsite);
+        solver.set_propagator_cache(cache);
+        solver.set_bond_operators(bonds);
+        solver.initialize_state(MatrixProductState::product_state(std::vector<Eigen::VectorXcd>(n, up)));
+        solver.build_network({});
+    }
+    // one bulk two-site gate and the last one-site gate, computed once
+    EXPECT_EQ(cache.misses(), 2u);
+    EXPECT_EQ(cache.hits(), 2u * n - 2u);
+
+    // a different step size or time kind is a different propagator
+    auto real_step = cache.get(zz, 0.1, TimeKind::real);
+    auto imag_step = cache.get(zz, 0.1, TimeKind::imaginary);
+    Eigen::MatrixXcd expected = (-0.1 * zz).exp();
+    EXPECT_NEAR((*imag_step - expected).norm(), 0.0, 1e-12);
+    EXPECT_GT((*real_step - *imag_step).norm(), 1e-3);
+    EXPECT_EQ(cache.size(), 4u);
+
+    cache.set_capacity(1);
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_NEAR((*imag_step - expected).norm(), 0.0, 1e-12);  // still owned by the caller
+}
+
+TEST(TimeEvolution, EvenOddLayersMatchExactEvolution) {
+    const int n = 7;  // odd length: the last bond also carries h_{N-1}
+    const double g = 0.8, t = 0.5;
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(Eigen::MatrixXcd(-g * pauli_x())));
+    Eigen::MatrixXcd zz = -Eigen::kroneckerProduct(pauli_z(), pauli_z()).eval();
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(zz));
+
+    Eigen::MatrixXcd H = Eigen::MatrixXcd::Zero(1 << n, 1 << n);
+    for (int i = 0; i < n; ++i) H += embed(-g * pauli_x(), i, 1, n);
+    for (int i = 0; i + 1 < n; ++i) H += embed(zz, i, 2, n);
+    Eigen::VectorXcd psi0 = random_state(1 << n);
+
+    TimeEvolutionSolver solver(t, 50, onsite);
+    solver.set_bond_operators(bonds);
+    solver.set_sweep_order(SweepOrder::even_odd, 3);
+    solver.initialize_state(Tensor::from_vector(psi0));
+    solver.build_network({});
+
+    Eigen::VectorXcd exact = (std::complex<double>(0, -t) * H).exp() * psi0;
+    EXPECT_NEAR(solver.compute_quantity_of_interest(), 1.0, 1e-10);
+    EXPECT_LT((solver.state().to_dense() - exact).norm(), 1e-3);
+}
+
+TEST(TimeEvolution, EvenOddIsIndependentOfThreadCount) {
+    const int n = 24;
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(Eigen::MatrixXcd(-0.9 * pauli_x())));
+    Eigen::MatrixXcd zz = -Eigen::kroneckerProduct(pauli_z(), pauli_z()).eval();
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(zz));
+    Eigen::VectorXcd up(2);
+    up << 1, 0;
+    TruncationParams truncation;
+    truncation.max_bond_dim = 6;  // truncating, so every gate's svd matters
+
+    auto run = [&](size_t threads, PropagationMode mode) {
+        TimeEvolutionSolver solver(1.0, 10, onsite);
+        solver.set_bond_operators(bonds);
+        solver.set_truncation(truncation);
+        solver.set_propagation_mode(mode);
+        solver.set_sweep_order(SweepOrder::even_odd, threads);
+        solver.initialize_state(MatrixProductState::product_state(std::vector<Eigen::VectorXcd>(n, up)));
+        solver.build_network({});
+        return solver.state();
+    };
+
+    MatrixProductState serial = run(1, PropagationMode::dense);
+    MatrixProductState parallel = run(4, PropagationMode::dense);
+    for (int i = 0; i < n; ++i) {
+        ASSERT_EQ(serial.site(i).dimensions, parallel.site(i).dimensions);
+        EXPECT_EQ(serial.site(i).vector_view(), parallel.site(i).vector_view());
+    }
+    EXPECT_EQ(serial.truncation_error(), parallel.truncation_error());
+    EXPECT_GT(serial.truncation_error(), 0.0);
+    EXPECT_NEAR(serial.norm(), 1.0, 1e-10);
+
+    // krylov gates in the layers agree with the dense ones
+    MatrixProductState krylov = run(4, PropagationMode::krylov);
+    EXPECT_NEAR(std::abs(krylov.overlap(serial)), 1.0, 1e-8);
+}
+
+TEST(TimeEvolution, MixedPrecisionRunsInSinglePrecision) {
+    const int n = 10;
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(Eigen::MatrixXcd(-0.9 * pauli_x())));
+    Eigen::MatrixXcd zz = -Eigen::kroneckerProduct(pauli_z(), pauli_z()).eval();
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(zz));
+    Eigen::VectorXcd up(2);
+    up << 1, 0;
+    ExecutionConfig config;
+    config.precision = Precision::mixed;
+    auto mixed = std::make_shared<ExecutionContext>(config);
+
+    for (SweepOrder order : {SweepOrder::sequential, SweepOrder::even_odd}) {
+        auto run = [&](std::shared_ptr<const ExecutionContext> ctx) {
+            auto solver = std::make_unique<TimeEvolutionSolver>(1.0, 10, onsite);
+            solver->set_bond_operators(bonds);
+            solver->set_sweep_order(order, 1);
+            if (ctx) solver->set_execution_context(ctx);
+            solver->initialize_state(MatrixProductState::product_state(std::vector<Eigen::VectorXcd>(n, up)));
+            solver->build_network({});
+            return solver;
+        };
+        auto full = run(nullptr);
+        auto single = run(mixed);
+        EXPECT_NEAR(std::abs(single->state().overlap(full->state())), 1.0, 1e-5);
+        EXPECT_NEAR(single->energy(), full->energy(), 1e-4);
+        // the state was held in complex<float> throughout the run
+        EXPECT_LT(single->peak_memory_bytes(), 0.6 * full->peak_memory_bytes());
+    }
+}
+
+TEST(TimeEvolution, IntegratorsReachTheirOrder) {
+    const int n = 5;
+    const double g = 0.8, t = 1.0;
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(Eigen::MatrixXcd(-g * pauli_x())));
+    Eigen::MatrixXcd zz = -Eigen::kroneckerProduct(pauli_z(), pauli_z()).eval();
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(zz));
+    Eigen::MatrixXcd H = Eigen::MatrixXcd::Zero(1 << n, 1 << n);
+    for (int i = 0; i < n; ++i) H += embed(-g * pauli_x(), i, 1, n);
+    for (int i = 0; i + 1 < n; ++i) H += embed(zz, i, 2, n);
+    Eigen::VectorXcd psi0 = random_state(1 << n);
+    Eigen::VectorXcd exact = (std::complex<double>(0, -t) * H).exp() * psi0;
+
+    auto error = [&](Integrator integrator, SweepOrder order, int steps) {
+        TimeEvolutionSolver solver(t, steps, onsite);
+        solver.set_bond_operators(bonds);
+        solver.set_integrator(integrator);
+        solver.set_sweep_order(order, 1);
+        solver.initialize_state(Tensor::from_vector(psi0));
+        solver.build_network({});
+        return (solver.state().to_dense() - exact).norm();
+    };
+
+    for (SweepOrder order : {SweepOrder::sequential, SweepOrder::even_odd}) {
+        // halving the step divides the error by about 2^order
+        const double e2 = error(Integrator::second_order, order, 8);
+        EXPECT_NEAR(e2 / error(Integrator::second_order, order, 16), 4.0, 0.4);
+        for (Integrator integrator : {Integrator::forest_ruth, Integrator::suzuki, Integrator::omelyan}) {
+            const double e4 = error(integrator, order, 4);
+            EXPECT_NEAR(e4 / error(integrator, order, 8), 16.0, 3.0) << integrator_name(integrator);
+            EXPECT_LT(e4, e2) << integrator_name(integrator);
+        }
+        // the optimized scheme beats the triple jump at equal cost per stage
+        EXPECT_LT(error(Integrator::omelyan, order, 3), error(Integrator::forest_ruth, order, 4));
+    }
+}
+
+TEST(TimeEvolution, AdaptiveStepsMeetTheTolerance) {
+    const int n = 5;
+    const double g = 0.8, t = 1.0;
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(Eigen::MatrixXcd(-g * pauli_x())));
+    Eigen::MatrixXcd zz = -Eigen::kroneckerProduct(pauli_z(), pauli_z()).eval();
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(zz));
+    Eigen::MatrixXcd H = Eigen::MatrixXcd::Zero(1 << n, 1 << n);
+    for (int i = 0; i < n; ++i) H += embed(-g * pauli_x(), i, 1, n);
+    for (int i = 0; i + 1 < n; ++i) H += embed(zz, i, 2, n);
+    Eigen::VectorXcd psi0 = random_state(1 << n);
+    Eigen::VectorXcd exact = (std::complex<double>(0, -t) * H).exp() * psi0;
+
+    AdaptiveParams adaptive;
+    adaptive.enabled = true;
+    adaptive.tolerance = 1e-6;
+    TimeEvolutionSolver solver(t, 1, onsite);  // the first trial step is the whole run
+    solver.set_bond_operators(bonds);
+    solver.set_integrator(Integrator::omelyan);
+    solver.set_adaptive(adaptive);
+    solver.initialize_state(Tensor::from_vector(psi0));
+    solver.build_network({});
+
+    double total = 0.0;
+    for (double h : solver.step_sizes()) total += h;
+    EXPECT_NEAR(total, t, 1e-12);
+    EXPECT_GT(solver.rejected_steps(), 0);
+    EXPECT_LT(solver.step_sizes().size(), 40u);
+    // the kept half steps are more accurate than the per-step tolerance
+    EXPECT_LT((solver.state().to_dense() - exact).norm(), 1e-5);
+}
+
+namespace {
+
+// xxz chain with a staggered field, complex through its Y Y terms:
+// H = sum (X X + Y Y + 0.7 Z Z) + sum h_i Z_i + 0.3 sum X_i
+struct XxzChain {
+    std::vector<Tensor> onsite;
+    std::vector<Tensor> bonds;
+    Eigen::MatrixXcd dense;
+};
+
+XxzChain xxz_chain(int n) {
+    Eigen::MatrixXcd y(2, 2);
+    y << 0, std::complex<double>(0, -1), std::complex<double>(0, 1), 0;
+    Eigen::MatrixXcd bond = Eigen::kroneckerProduct(pauli_x(), pauli_x()).eval() +
+                            Eigen::kroneckerProduct(y, y).eval() +
+                            0.7 * Eigen::kroneckerProduct(pauli_z(), pauli_z()).eval();
+    XxzChain chain;
+    chain.dense = Eigen::MatrixXcd::Zero(1 << n, 1 << n);
+    for (int i = 0; i < n; ++i) {
+        Eigen::MatrixXcd h = (i % 2 ? -0.4 : 0.25) * pauli_z() + 0.3 * pauli_x();
+        chain.onsite.push_back(Tensor::from_matrix(h));
+        chain.dense += embed(h, i, 1, n);
+    }
+    for (int i = 0; i + 1 < n; ++i) {
+        chain.bonds.push_back(Tensor::from_matrix(bond));
+        chain.dense += embed(bond, i, 2, n);
+    }
+    return chain;
+}
+
+} // namespace
+
+TEST(DMRG, TwoSiteFindsTheGroundState) {
+    const int n = 8;
+    XxzChain chain = xxz_chain(n);
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXcd> exact(chain.dense);
+
+    DMRGSolver solver(chain.onsite);
+    solver.set_bond_operators(chain.bonds);
+    solver.set_truncation(TruncationParams{32, 1e-14});
+    // a product state: the two-site update grows the bonds
+    solver.initialize_state(MatrixProductState::product_state(
+        std::vector<Eigen::VectorXcd>(n, Eigen::VectorXcd::Ones(2))));
+    solver.build_network({});
+
+    EXPECT_TRUE(solver.converged());
+    EXPECT_LT(solver.sweep_energies().size(), 20u);
+    EXPECT_NEAR(solver.compute_quantity_of_interest(), exact.eigenvalues()(0), 1e-9);
+    Eigen::VectorXcd psi = solver.state().to_dense();
+    EXPECT_NEAR(std::abs(psi.dot(exact.eigenvectors().col(0))), 1.0, 1e-7);
+    EXPECT_NEAR(psi.dot(chain.dense * psi).real(), exact.eigenvalues()(0), 1e-9);
+}
+
+TEST(DMRG, SingleSiteAndTruncatedRuns) {
+    const int n = 8;
+    XxzChain chain = xxz_chain(n);
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXcd> exact(chain.dense);
+
+    // single-site keeps the bonds of its start state, here exact ones
+    DMRGParams params;
+    params.update = DMRGUpdate::single_site;
+    DMRGSolver single(chain.onsite);
+    single.set_bond_operators(chain.bonds);
+    single.set_params(params);
+    single.initialize_state(Tensor::from_vector(random_state(1 << n)));
+    single.build_network({});
+    EXPECT_TRUE(single.converged());
+    EXPECT_NEAR(single.energy(), exact.eigenvalues()(0), 1e-9);
+
+    // a bond cap below the exact rank: the energy is an upper bound, and the
+    // truncation never falls below the convergence tolerance
+    DMRGSolver capped(chain.onsite);
+    capped.set_bond_operators(chain.bonds);
+    capped.set_truncation(TruncationParams{3, 1e-14});
+    capped.set_params(DMRGParams{6});
+    capped.initialize_state(Tensor::from_vector(random_state(1 << n)));
+    capped.build_network({});
+    EXPECT_FALSE(capped.converged());
+    EXPECT_EQ(capped.sweep_energies().size(), 6u);
+    EXPECT_GT(capped.sweep_truncation().back(), params.truncation_tolerance);
+    EXPECT_LE(capped.state().max_bond_dim(), 3);
+    EXPECT_GT(capped.energy(), exact.eigenvalues()(0));
+    EXPECT_LT(capped.energy(), exact.eigenvalues()(0) + 0.1);
+}
+
+TEST(DMRG, MixedPrecisionContractions) {
+    const int n = 8;
+    XxzChain chain = xxz_chain(n);
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXcd> exact(chain.dense);
+
+    // single-precision gemms bound the attainable accuracy near 1e-6
+    ExecutionConfig config;
+    config.precision = Precision::mixed;
+    DMRGParams params;
+    params.energy_tolerance = 1e-6;
+    params.eigensolver = KrylovParams{20, 1e-6};
+    DMRGSolver solver(chain.onsite);
+    solver.set_execution_context(std::make_shared<ExecutionContext>(config));
+    solver.set_bond_operators(chain.bonds);
+    solver.set_truncation(TruncationParams{32, 1e-12});
+    solver.set_params(params);
+    solver.initialize_state(MatrixProductState::product_state(
+        std::vector<Eigen::VectorXcd>(n, Eigen::VectorXcd::Ones(2))));
+    solver.build_network({});
+
+    EXPECT_TRUE(solver.converged());
+    EXPECT_NEAR(solver.energy(), exact.eigenvalues()(0), 1e-5);
+    Eigen::VectorXcd psi = solver.state().to_dense();
+    EXPECT_NEAR(psi.dot(chain.dense * psi).real(), exact.eigenvalues()(0), 1e-5);
+}
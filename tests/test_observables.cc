@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <Eigen/Dense>
+#include <unsupported/Eigen/KroneckerProduct>
+#include <functional>
+#include "solver/observables.hh"
+#include "solver/profiler.hh"
+#include "solver/solver.hh"
+
+using namespace qps;
+
+namespace {
+
+Eigen::MatrixXcd pauli_x() {
+    Eigen::MatrixXcd m(2, 2);
+    m << 0, 1, 1, 0;
+    return m;
+}
+
+Eigen::MatrixXcd pauli_z() {
+    Eigen::MatrixXcd m(2, 2);
+    m << 1, 0, 0, -1;
+    return m;
+}
+
+// product of one-site operators on an n-site qubit chain (site 0 slowest)
+Eigen::MatrixXcd dense_product(const std::vector<ObservableBatch::Factor>& factors, int n) {
+    Eigen::MatrixXcd out = Eigen::MatrixXcd::Identity(1, 1);
+    for (int i = 0; i < n; ++i) {
+        Eigen::MatrixXcd op = Eigen::MatrixXcd::Identity(2, 2);
+        for (const auto& f : factors) {
+            if (f.first == i) op = f.second;
+        }
+        out = Eigen::kroneckerProduct(out, op).eval();
+    }
+    return out;
+}
+
+uint64_t contractions_during(const std::function<void()>& f) {
+    const ProfileSnapshot before = Profiler::global().snapshot();
+    f();
+    return (Profiler::global().snapshot() - before).contractions;
+}
+
+} // namespace
+
+TEST(Observables, BatchMatchesDense) {
+    const int n = 7;
+    // an unnormalized state with its center in the middle
+    const Eigen::VectorXcd psi = 1.7 * Eigen::VectorXcd::Random(1 << n);
+    MatrixProductState mps = MatrixProductState::from_dense(psi, std::vector<int>(n, 2));
+    mps.move_center(3);
+
+    Eigen::MatrixXcd y(2, 2);
+    y << 0, std::complex<double>(0, -1), std::complex<double>(0, 1), 0;
+    ObservableBatch batch;
+    std::vector<std::vector<ObservableBatch::Factor>> all;
+    auto add = [&](std::vector<ObservableBatch::Factor> factors) {
+        batch.add("o" + std::to_string(all.size()), factors);
+        all.push_back(factors);
+    };
+    for (int i = 0; i < n; ++i) {
+        add({{i, pauli_z()}});
+        add({{i, pauli_x()}});
+    }
+    for (int i = 0; i < n; ++i)
+        for (int j = i + 1; j < n; ++j) add({{i, pauli_z()}, {j, y}});
+    add({{5, pauli_x()}, {1, y}, {3, pauli_z()}});  // any order, three factors
+    add({{2, pauli_z()}});                          // a repeat
+
+    std::vector<std::complex<double>> values = batch.measure(mps);
+    ASSERT_EQ(values.size(), all.size());
+    const double norm2 = psi.squaredNorm();
+    for (size_t k = 0; k < all.size(); ++k) {
+        const std::complex<double> expected = psi.dot(dense_product(all[k], n) * psi) / norm2;
+        EXPECT_NEAR(std::abs(values[k] - expected), 0.0, 1e-12) << batch.name(k);
+    }
+
+    EXPECT_THROW(batch.add("bad", {{1, pauli_z()}, {1, pauli_x()}}), std::runtime_error);
+    ObservableBatch outside;
+    outside.add_local("far", pauli_z(), n);
+    EXPECT_THROW(outside.measure(mps), std::runtime_error);
+}
+
+TEST(Observables, SharedEnvironmentsScaleLinearly) {
+    const bool was_enabled = Profiler::enabled();
+    Profiler::set_enabled(true);
+    auto count = [](int n) {
+        MatrixProductState mps = MatrixProductState::from_dense(
+            Eigen::VectorXcd::Random(1 << n), std::vector<int>(n, 2), TruncationParams{4, 0.0});
+        ObservableBatch locals;
+        ObservableBatch correlators;
+        for (int i = 0; i < n; ++i) {
+            locals.add_local("z", pauli_z(), i);
+            locals.add_local("x", pauli_x(), i);
+            if (i > 0) correlators.add_correlator("zz", pauli_z(), 0, pauli_z(), i);
+        }
+        return std::make_pair(contractions_during([&] { locals.measure(mps); }),
+                              contractions_during([&] { correlators.measure(mps); }));
+    };
+    // doubling the chain doubles the work for all locals, and for all
+    // correlators from one site, rather than quadrupling it
+    const auto small = count(6);
+    const auto large = count(12);
+    EXPECT_LE(large.first, 2 * small.first + 8);
+    EXPECT_LE(large.second, 2 * small.second + 8);
+    Profiler::set_enabled(was_enabled);
+}
+
+TEST(Observables, MeasuredDuringTebd) {
+    const int n = 4;
+    std::vector<Tensor> onsite(n, Tensor::from_matrix(Eigen::MatrixXcd(-0.8 * pauli_x())));
+    Eigen::MatrixXcd zz = -Eigen::kroneckerProduct(pauli_z(), pauli_z()).eval();
+    std::vector<Tensor> bonds(n - 1, Tensor::from_matrix(zz));
+
+    ObservableBatch batch;
+    for (int i = 0; i < n; ++i) batch.add_local("z_" + std::to_string(i), pauli_z(), i);
+    batch.add_correlator("zz_03", pauli_z(), 0, pauli_z(), 3);
+
+    TimeEvolutionSolver solver(0.5, 5, onsite);
+    solver.set_bond_operators(bonds);
+    solver.set_observables(batch, 2);
+    Eigen::VectorXcd psi0 = Eigen::VectorXcd::Zero(1 << n);
+    psi0(0) = 1.0;
+    solver.initialize_state(Tensor::from_vector(psi0));
+    solver.build_network({});
+
+    // after steps 2 and 4 and the last one (step indices 1, 3, 4)
+    const auto& records = solver.measurements();
+    ASSERT_EQ(records.size(), 3u);
+    EXPECT_EQ(records[0].step, 1);
+    EXPECT_EQ(records[2].step, 4);
+    EXPECT_DOUBLE_EQ(records[2].time, 0.5);
+    Eigen::VectorXcd psi = solver.state().to_dense();
+    const std::complex<double> zz_03 =
+        psi.dot(dense_product({{0, pauli_z()}, {3, pauli_z()}}, n) * psi) / psi.squaredNorm();
+    EXPECT_NEAR(std::abs(records[2].values[4] - zz_03), 0.0, 1e-12);
+    for (int i = 0; i < n; ++i) {
+        const std::complex<double> z = psi.dot(dense_product({{i, pauli_z()}}, n) * psi) / psi.squaredNorm();
+        EXPECT_NEAR(std::abs(records[2].values[i] - z), 0.0, 1e-12);
+    }
+}
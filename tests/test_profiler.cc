@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include <Eigen/Dense>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "solver/buffer_pool.hh"
+#include "solver/profiler.hh"
+#include "solver/solver.hh"
+#include "solver/thread_pool.hh"
+
+using namespace qps;
+
+namespace {
+
+// profiling is process-wide; every test leaves it disabled
+struct ProfilingOn {
+    ProfilingOn() { Profiler::set_enabled(true); }
+    ~ProfilingOn() { Profiler::set_enabled(false); }
+};
+
+const PhaseStats& phase(const ProfileSnapshot& s, Phase p) {
+    return s.phases[static_cast<size_t>(p)];
+}
+
+} // namespace
+
+TEST(Profiler, DisabledRecordsNothing) {
+    ASSERT_FALSE(Profiler::enabled());
+    const ProfileSnapshot before = Profiler::global().snapshot();
+    Tensor a = Tensor::from_matrix(Eigen::MatrixXcd::Random(4, 4), {"i", "j"});
+    Tensor b = Tensor::from_matrix(Eigen::MatrixXcd::Random(4, 4), {"j", "k"});
+    contract_tensors(a, b, {{1, 0}});
+    const ProfileSnapshot d = Profiler::global().snapshot() - before;
+    EXPECT_EQ(d.contractions, 0u);
+    EXPECT_EQ(d.bytes_allocated, 0u);
+    EXPECT_EQ(phase(d, Phase::contract).calls, 0u);
+}
+
+TEST(Profiler, CountsContractionsAndCopies) {
+    Tensor a = Tensor::from_matrix(Eigen::MatrixXcd::Random(3, 4), {"i", "j"});
+    Tensor b = Tensor::from_matrix(Eigen::MatrixXcd::Random(4, 5), {"j", "k"});
+    ProfilingOn on;
+    BufferPool::clear();  // the result is a pool miss
+    const ProfileSnapshot before = Profiler::global().snapshot();
+    Tensor c = contract_tensors(a, b, {{1, 0}});
+    Eigen::MatrixXcd m = c.to_matrix();
+    const ProfileSnapshot d = Profiler::global().snapshot() - before;
+
+    EXPECT_EQ(d.contractions, 1u);
+    EXPECT_EQ(d.flops, 8u * 3 * 4 * 5);
+    EXPECT_EQ(d.bytes_allocated, 3u * 5 * sizeof(Tensor::Scalar));
+    EXPECT_EQ(phase(d, Phase::contract).calls, 1u);
+    EXPECT_EQ(phase(d, Phase::copy).calls, 1u);
+    uint64_t in_histogram = 0;
+    for (uint64_t n : phase(d, Phase::contract).histogram) in_histogram += n;
+    EXPECT_EQ(in_histogram, 1u);
+}
+
+TEST(Profiler, ScopedTimerFillsHistogram) {
+    ProfilingOn on;
+    Profiler::global().reset();
+    Profiler::global().record(Phase::io, 1);
+    Profiler::global().record(Phase::io, 1000);
+    const ProfileSnapshot s = Profiler::global().snapshot();
+    EXPECT_EQ(phase(s, Phase::io).calls, 2u);
+    EXPECT_EQ(phase(s, Phase::io).nanoseconds, 1001u);
+    EXPECT_EQ(phase(s, Phase::io).histogram[0], 1u);
+    EXPECT_EQ(phase(s, Phase::io).histogram[9], 1u);  // 512 <= 1000 < 1024
+    { ScopedTimer timer(Phase::step); }
+    EXPECT_EQ(phase(Profiler::global().snapshot(), Phase::step).calls, 1u);
+}
+
+TEST(Profiler, RunProfilerSeesOnlyItsOwnWork) {
+    ProfilingOn on;
+    Profiler run;
+    ThreadPool pool(2);
+    {
+        ProfileScope scope(&run);
+        { ScopedTimer timer(Phase::step); }
+        // tasks run on the pool count towards the run that submitted them
+        for (int k = 0; k < 3; ++k) pool.submit([] { profile::count_contraction(10); });
+        pool.wait();
+        // a thread outside the scope is some other run
+        std::thread other([] { profile::count_contraction(1000); });
+        other.join();
+    }
+    profile::count_contraction(1000);
+    const ProfileSnapshot s = run.snapshot();
+    EXPECT_EQ(phase(s, Phase::step).calls, 1u);
+    EXPECT_EQ(s.contractions, 3u);
+    EXPECT_EQ(s.flops, 30u);
+    EXPECT_EQ(Profiler::current(), nullptr);
+}
+
+TEST(Profiler, ConcurrentSolversWriteSeparateProfiles) {
+    const auto root = std::filesystem::temp_directory_path() / "qps_profile_concurrent";
+    std::filesystem::remove_all(root);
+    Eigen::Matrix2cd h;
+    h << 0.3, 0.5, 0.5, -0.3;
+    Eigen::VectorXcd up(2);
+    up << 1, 0;
+    ProfilingOn on;
+    auto run = [&](int steps) {
+        const std::string dir = (root / std::to_string(steps)).string();
+        std::filesystem::create_directories(dir);
+        TimeEvolutionSolver solver(1.0, steps, std::vector<Tensor>(3, Tensor::from_matrix(h)));
+        solver.set_checkpoint_dir(dir);
+        solver.initialize_state(MatrixProductState::product_state(std::vector<Eigen::VectorXcd>(3, up)));
+        solver.build_network({});
+    };
+    std::thread a(run, 4), b(run, 7);
+    a.join();
+    b.join();
+    for (int steps : {4, 7}) {
+        std::ifstream in(root / std::to_string(steps) / "profile.json");
+        ASSERT_TRUE(in.good());
+        std::stringstream text;
+        text << in.rdbuf();
+        EXPECT_NE(text.str().find("\"step\": {\"calls\": " + std::to_string(steps) + ","), std::string::npos);
+    }
+    std::filesystem::remove_all(root);
+}
+
+TEST(Profiler, SolverWritesProfileNextToItsData) {
+    const std::string dir = (std::filesystem::temp_directory_path() / "qps_profile").string();
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    Eigen::Matrix2cd h;
+    h << 0.3, 0.5, 0.5, -0.3;
+    Eigen::VectorXcd up(2);
+    up << 1, 0;
+    {
+        ProfilingOn on;
+        TimeEvolutionSolver solver(1.0, 4, std::vector<Tensor>(3, Tensor::from_matrix(h)));
+        solver.set_checkpoint_dir(dir);
+        solver.initialize_state(MatrixProductState::product_state(std::vector<Eigen::VectorXcd>(3, up)));
+        solver.build_network({});
+    }
+    std::ifstream in(dir + "/profile.json");
+    ASSERT_TRUE(in.good());
+    std::stringstream text;
+    text << in.rdbuf();
+    EXPECT_NE(text.str().find("\"solver\": \"tebd\""), std::string::npos);
+    EXPECT_NE(text.str().find("\"step\": {\"calls\": 4"), std::string::npos);
+    EXPECT_NE(text.str().find("\"svd\""), std::string::npos);
+    EXPECT_NE(text.str().find("\"io\""), std::string::npos);
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,487 @@
+#include <gtest/gtest.h>
+#include <Eigen/Dense>
+#include "solver/tensor.hh"
+#include "solver/execution.hh"
+#include <thread>
+
+using namespace qps;
+
+// fill a tensor with distinct deterministic values
+static void fill(Tensor& t, double offset) {
+    for (Eigen::Index i = 0; i < t.data.size(); ++i) {
+        t.data(i) = Tensor::Scalar(offset + 0.5 * i - 0.01 * i * i, 0.1 * i - offset);
+    }
+}
+
+TEST(TensorTest, ArbitraryRank) {
+    Tensor t({2, 3, 4}, {"a", "b", "c"});
+    EXPECT_EQ(t.rank(), 3);
+    EXPECT_EQ(t.data.size(), 24);
+
+    t.data(1, 2, 3) = 7.0;
+    EXPECT_EQ(t.data(1 + 2 * 2 + 3 * 6), Tensor::Scalar(7.0));  // column-major layout
+
+    Tensor scalar({}, {});
+    EXPECT_EQ(scalar.rank(), 0);
+    EXPECT_EQ(scalar.data.size(), 1);
+}
+
+TEST(TensorTest, Permute) {
+    Tensor t({2, 3, 4}, {"a", "b", "c"});
+    fill(t, 1.0);
+
+    Tensor p = permute(t, {2, 0, 1});
+    EXPECT_EQ(p.indices, (std::vector<IndexId>{"c", "a", "b"}));
+    EXPECT_EQ(p.dimensions, (std::vector<int>{4, 2, 3}));
+    for (int a = 0; a < 2; ++a)
+        for (int b = 0; b < 3; ++b)
+            for (int c = 0; c < 4; ++c)
+                EXPECT_EQ(p.data(c, a, b), t.data(a, b, c));
+}
+
+TEST(TensorNetworkTest, MatrixProduct) {
+    Eigen::MatrixXd A = Eigen::MatrixXd::Random(3, 4);
+    Eigen::MatrixXd B = Eigen::MatrixXd::Random(4, 5);
+
+    TensorNetwork network;
+    network.add_tensor(Tensor::from_matrix(A, {"i", "k"}), "A");
+    network.add_tensor(Tensor::from_matrix(B, {"k", "j"}), "B");
+
+    auto result = network.contract("A", "B", {"k"});
+    EXPECT_EQ(result.indices, (std::vector<IndexId>{"i", "j"}));
+    EXPECT_NEAR((result.to_matrix() - (A * B).cast<Tensor::Scalar>()).norm(), 0.0, 1e-12);
+
+    // contracting against the leading index of the first tensor
+    auto result_t = network.contract("B", "A", {"k"});
+    EXPECT_EQ(result_t.indices, (std::vector<IndexId>{"j", "i"}));
+    EXPECT_NEAR((result_t.to_matrix() - (A * B).transpose().cast<Tensor::Scalar>()).norm(), 0.0, 1e-12);
+}
+
+TEST(TensorNetworkTest, ComplexMatrixProduct) {
+    Eigen::MatrixXcd A = Eigen::MatrixXcd::Random(3, 4);
+    Eigen::MatrixXcd B = Eigen::MatrixXcd::Random(4, 5);
+
+    TensorNetwork network;
+    network.add_tensor(Tensor::from_matrix(A, {"i", "k"}), "A");
+    network.add_tensor(Tensor::from_matrix(B, {"k", "j"}), "B");
+
+    auto result = network.contract("A", "B", {"k"});
+    EXPECT_NEAR((result.to_matrix() - A * B).norm(), 0.0, 1e-12);
+
+    // no implicit conjugation: <a|b> needs an explicit conj()
+    network.add_tensor(Tensor::from_matrix(A, {"i", "k"}).conj(), "A_conj");
+    auto overlap = network.contract("A_conj", "A", {"i", "k"});
+    EXPECT_NEAR(overlap.data(0).real(), A.squaredNorm(), 1e-12);
+    EXPECT_NEAR(overlap.data(0).imag(), 0.0, 1e-12);
+}
+
+TEST(TensorNetworkTest, MpsMpoMultiIndexContraction) {
+    // rank-3 mps site tensor and rank-4 mpo tensor sharing two indices
+    const int dl = 3, d = 2, dr = 4, wl = 2, wr = 3;
+    Tensor A({dl, d, dr}, {"l", "s", "r"});
+    Tensor W({wl, d, d, wr}, {"wl", "s", "t", "wr"});
+    Tensor B({dr, wr, 5}, {"r", "wr", "x"});
+    fill(A, 0.3);
+    fill(W, -1.0);
+    fill(B, 2.0);
+
+    TensorNetwork network;
+    network.add_tensor(A, "A");
+    network.add_tensor(W, "W");
+    network.add_tensor(B, "B");
+
+    auto AW = network.contract("A", "W", {"s"});
+    EXPECT_EQ(AW.indices, (std::vector<IndexId>{"l", "r", "wl", "t", "wr"}));
+    network.add_tensor(AW, "AW");
+
+    // two shared indices in one call
+    auto result = network.contract("AW", "B", {"r", "wr"});
+    EXPECT_EQ(result.indices, (std::vector<IndexId>{"l", "wl", "t", "x"}));
+
+    for (int l = 0; l < dl; ++l)
+        for (int a = 0; a < wl; ++a)
+            for (int t = 0; t < d; ++t)
+                for (int x = 0; x < 5; ++x) {
+                    Tensor::Scalar expected = 0.0;
+                    for (int s = 0; s < d; ++s)
+                        for (int r = 0; r < dr; ++r)
+                            for (int b = 0; b < wr; ++b)
+                                expected += A.data(l, s, r) * W.data(a, s, t, b) * B.data(r, b, x);
+                    EXPECT_NEAR(std::abs(result.data(l, a, t, x) - expected), 0.0, 1e-10);
+                }
+}
+
+TEST(TensorNetworkTest, FullContractionGivesScalar) {
+    Tensor A({2, 3, 4}, {"a", "b", "c"});
+    Tensor B({4, 2, 3}, {"c", "a", "b"});
+    fill(A, 1.0);
+    fill(B, -0.5);
+
+    TensorNetwork network;
+    network.add_tensor(A, "A");
+    network.add_tensor(B, "B");
+    auto result = network.contract("A", "B", {"a", "b", "c"});
+
+    Tensor::Scalar expected = 0.0;
+    for (int a = 0; a < 2; ++a)
+        for (int b = 0; b < 3; ++b)
+            for (int c = 0; c < 4; ++c)
+                expected += A.data(a, b, c) * B.data(c, a, b);
+    EXPECT_EQ(result.rank(), 0);
+    EXPECT_NEAR(std::abs(result.data(0) - expected), 0.0, 1e-10);
+}
+
+TEST(TensorNetworkTest, HandlesAndIndexIds) {
+    IndexId i("i"), k("k"), j("j");
+    EXPECT_EQ(i, IndexId("i"));
+    EXPECT_NE(i, k);
+    EXPECT_EQ(k.name(), "k");
+
+    Eigen::MatrixXcd A = Eigen::MatrixXcd::Random(2, 3);
+    Eigen::MatrixXcd B = Eigen::MatrixXcd::Random(3, 4);
+    TensorNetwork network;
+    TensorHandle ha = network.add_tensor(Tensor::from_matrix(A, {i, k}), "A");
+    TensorHandle hb = network.add_tensor(Tensor::from_matrix(B, {k, j}), "B");
+    EXPECT_NE(ha, hb);
+    EXPECT_EQ(network.handle("B"), hb);
+
+    auto by_handle = network.contract(ha, hb, {k});
+    auto by_name = network.contract("A", "B", {"k"});
+    EXPECT_EQ(by_handle.indices, (std::vector<IndexId>{i, j}));
+    EXPECT_EQ(by_handle.index_names(), by_name.index_names());
+    EXPECT_NEAR((by_handle.to_matrix() - A * B).norm(), 0.0, 1e-12);
+
+    EXPECT_THROW(network.get_tensor(TensorHandle{}), std::runtime_error);
+    EXPECT_THROW(network.handle("missing"), std::runtime_error);
+}
+
+TEST(TensorNetworkTest, DimensionMismatchThrows) {
+    TensorNetwork network;
+    network.add_tensor(Tensor({2, 3}, {"i", "k"}), "A");
+    network.add_tensor(Tensor({4, 2}, {"k", "j"}), "B");
+    EXPECT_THROW(network.contract("A", "B", {"k"}), std::runtime_error);
+    EXPECT_THROW(network.contract("A", "B", {"x"}), std::runtime_error);
+}
+
+TEST(TensorNetworkTest, MoveInAndUpdateInPlace) {
+    Tensor t({4, 4}, {"i", "j"});
+    fill(t, 1.0);
+    const Tensor::Scalar* storage = t.data.data();
+
+    TensorNetwork network;
+    TensorHandle h = network.add_tensor(std::move(t), "rho");
+    EXPECT_EQ(network.get_tensor(h).data.data(), storage);  // adopted, not copied
+    EXPECT_EQ(network.bytes_in_use(), 16 * sizeof(Tensor::Scalar));
+
+    // re-registering a name replaces the tensor under the same handle
+    Tensor next({4, 4}, {"i", "j"});
+    fill(next, 2.0);
+    EXPECT_EQ(network.set_tensor("rho", next), h);
+    EXPECT_EQ(network.get_tensor(h).data(3), next.data(3));
+    network.update_tensor(h, Tensor({2, 2}, {"i", "j"}));
+    EXPECT_EQ(network.num_tensors(), 1u);
+    EXPECT_EQ(network.bytes_in_use(), 4 * sizeof(Tensor::Scalar));
+    EXPECT_EQ(network.peak_bytes(), 16 * sizeof(Tensor::Scalar));
+}
+
+TEST(TensorNetworkTest, ReleaseInvalidatesHandles) {
+    TensorNetwork network;
+    TensorHandle tmp = network.add_tensor(Tensor({8}, {"i"}), "tmp");
+    network.release(tmp);
+    EXPECT_FALSE(network.contains("tmp"));
+    EXPECT_EQ(network.bytes_in_use(), 0u);
+    EXPECT_THROW(network.get_tensor(tmp), std::runtime_error);
+
+    // the slot is reused, but the old handle stays stale
+    TensorHandle reused = network.add_tensor(Tensor({8}, {"i"}), "tmp");
+    EXPECT_EQ(reused.slot, tmp.slot);
+    EXPECT_NE(reused, tmp);
+    EXPECT_THROW(network.update_tensor(tmp, Tensor({8}, {"i"})), std::runtime_error);
+    EXPECT_NO_THROW(network.release("tmp"));
+}
+
+TEST(TensorTest, ZeroCopyViews) {
+    Eigen::MatrixXcd m = Eigen::MatrixXcd::Random(3, 5);
+    const Eigen::MatrixXcd expected = m;
+    const Tensor::Scalar* storage = m.data();
+    Tensor t = Tensor::from_matrix(std::move(m), {"a", "b"});
+    EXPECT_EQ(t.data.data(), storage);  // adopted
+    EXPECT_EQ(t.data(2, 4), expected(2, 4));
+
+    // views alias the buffer
+    t.matrix_view()(1, 3) = 9.0;
+    EXPECT_EQ(t.data(1, 3), Tensor::Scalar(9.0));
+    EXPECT_EQ(t.vector_view().data(), t.data.data());
+
+    // a rank-3 tensor seen as (a b) x c
+    Tensor r({2, 3, 4}, {"a", "b", "c"});
+    fill(r, 0.5);
+    Tensor::ConstMatrixView grouped = static_cast<const Tensor&>(r).matrix_view(2);
+    EXPECT_EQ(grouped.rows(), 6);
+    EXPECT_EQ(grouped(1 + 2 * 2, 3), r.data(1, 2, 3));
+    EXPECT_THROW(r.matrix_view(4), std::runtime_error);
+    EXPECT_EQ(r.tensor_view<3>()(1, 2, 3), r.data(1, 2, 3));
+    EXPECT_THROW(r.tensor_view<2>(), std::runtime_error);
+
+    Eigen::Vector3d real_vec(1.0, 2.0, 3.0);
+    EXPECT_EQ(Tensor::from_vector(real_vec).to_vector()(2), Tensor::Scalar(3.0));
+}
+
+TEST(TensorNetworkTest, ContractAllMatchesPairwise) {
+    // trace of a ring of four matrices plus an open pair
+    Eigen::MatrixXcd A = Eigen::MatrixXcd::Random(3, 4), B = Eigen::MatrixXcd::Random(4, 5);
+    Eigen::MatrixXcd C = Eigen::MatrixXcd::Random(5, 2), D = Eigen::MatrixXcd::Random(2, 3);
+    TensorNetwork network;
+    TensorHandle a = network.add_tensor(Tensor::from_matrix(A, {"i", "j"}), "A");
+    TensorHandle b = network.add_tensor(Tensor::from_matrix(B, {"j", "k"}), "B");
+    TensorHandle c = network.add_tensor(Tensor::from_matrix(C, {"k", "l"}), "C");
+    TensorHandle d = network.add_tensor(Tensor::from_matrix(D, {"l", "i"}), "D");
+
+    auto trace = network.contract_all({"A", "B", "C", "D"}, {});
+    EXPECT_EQ(trace.rank(), 0);
+    EXPECT_NEAR(std::abs(trace.data(0) - (A * B * C * D).trace()), 0.0, 1e-10);
+
+    // open indices come out in the requested order, whatever the plan
+    auto open = network.contract_all({d, c, b}, {IndexId("i"), IndexId("j")}, PathMethod::greedy);
+    EXPECT_NEAR((open.to_matrix() - (B * C * D).transpose()).norm(), 0.0, 1e-10);
+    auto open_exact = network.contract_all({a, b, c}, {IndexId("i"), IndexId("l")}, PathMethod::exhaustive);
+    EXPECT_NEAR((open_exact.to_matrix() - A * B * C).norm(), 0.0, 1e-10);
+
+    EXPECT_THROW(network.contract_all({"A", "B"}, {"i"}), std::runtime_error);  // k left dangling
+}
+
+TEST(TensorNetworkTest, PlannerAvoidsExpensiveOrders) {
+    // a matrix chain where the left-to-right order is far more expensive:
+    // (100x2)(2x100)(100x2)(2x100) vs contracting the 2-wide bonds first
+    std::vector<TensorShape> chain = {
+        {{"a", "b"}, {100, 2}}, {{"b", "c"}, {2, 100}},
+        {{"c", "d"}, {100, 2}}, {{"d", "e"}, {2, 100}}};
+    ContractionPlan exact = plan_contraction(chain, {"a", "e"}, PathMethod::exhaustive);
+    ContractionPlan greedy = plan_contraction(chain, {"a", "e"}, PathMethod::greedy);
+    EXPECT_EQ(exact.steps.size(), 3u);
+    EXPECT_LT(exact.flops, 100.0 * 100.0 * 100.0);
+    EXPECT_LE(exact.flops, greedy.flops);
+    EXPECT_LE(exact.peak_elements, 100.0 * 100.0);
+
+    // greedy stays exact on a long mps-like chain too large for the search
+    std::vector<TensorShape> mps;
+    for (int i = 0; i < 12; ++i) {
+        mps.push_back({{"b" + std::to_string(i), "s" + std::to_string(i), "b" + std::to_string(i + 1)},
+                       {i == 0 ? 1 : 8, 2, 8}});
+    }
+    mps.back().dimensions[2] = 1;
+    std::vector<IndexId> open = {"b0", "b12"};
+    for (int i = 0; i < 12; ++i) open.push_back("s" + std::to_string(i));
+    EXPECT_EQ(plan_contraction(mps, open).steps.size(), 11u);
+}
+
+TEST(TensorNetworkTest, ContractAllReusesPlans) {
+    TensorNetwork network;
+    Eigen::MatrixXcd A = Eigen::MatrixXcd::Random(3, 3);
+    network.add_tensor(Tensor::from_matrix(A, {"i", "j"}), "A");
+    network.add_tensor(Tensor::from_matrix(A, {"j", "k"}), "B");
+    network.contract_all({"A", "B"}, {"i", "k"});
+    EXPECT_EQ(network.cached_plans(), 1u);
+
+    // same shapes with new data: the plan is reused
+    network.set_tensor("A", Tensor::from_matrix(Eigen::MatrixXcd::Random(3, 3), {"i", "j"}));
+    auto product = network.contract_all({"A", "B"}, {"i", "k"});
+    EXPECT_EQ(network.cached_plans(), 1u);
+    EXPECT_NEAR((product.to_matrix() - network.get_tensor("A").to_matrix() * A).norm(), 0.0, 1e-10);
+
+    network.contract_all({"A", "B"}, {"k", "i"});
+    EXPECT_EQ(network.cached_plans(), 2u);
+}
+
+TEST(TensorNetworkTest, ConcurrentContractAllSharesPlans) {
+    Eigen::MatrixXcd A = Eigen::MatrixXcd::Random(4, 5), B = Eigen::MatrixXcd::Random(5, 6);
+    TensorNetwork network;
+    TensorHandle a = network.add_tensor(Tensor::from_matrix(A, {"i", "j"}), "A");
+    TensorHandle b = network.add_tensor(Tensor::from_matrix(B, {"j", "k"}), "B");
+    const TensorNetwork& shared = network;
+
+    // every thread plans the same two shapes through the one cache
+    std::vector<double> errors(8, 1.0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < errors.size(); ++t) {
+        threads.emplace_back([&, t] {
+            const bool swapped = t % 2 == 1;
+            std::vector<IndexId> output = swapped ? std::vector<IndexId>{"k", "i"} : std::vector<IndexId>{"i", "k"};
+            Eigen::MatrixXcd expected = A * B;
+            if (swapped) expected.transposeInPlace();
+            double worst = 0.0;
+            for (int rep = 0; rep < 50; ++rep) {
+                worst = std::max(worst, (shared.contract_all({a, b}, output).to_matrix() - expected).norm());
+            }
+            errors[t] = worst;
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    for (double e : errors) EXPECT_LT(e, 1e-10);
+    EXPECT_EQ(network.cached_plans(), 2u);
+}
+
+TEST(TensorNetworkTest, ThreadedContextMatchesSerial) {
+    // a threshold of zero sends every permutation down the threaded path
+    ExecutionConfig config;
+    config.num_threads = 3;
+    config.permute_threshold = 0;
+    auto ctx = std::make_shared<ExecutionContext>(config);
+    const int blas_before = BlasThreads::get();
+
+    Tensor t({3, 4, 5, 2}, {"a", "b", "c", "d"});
+    t.vector_view() = Eigen::VectorXcd::Random(t.data.size());
+    Tensor serial = permute(t, {2, 0, 3, 1});
+    Tensor threaded = permute(t, {2, 0, 3, 1}, *ctx);
+    EXPECT_EQ(threaded.dimensions, serial.dimensions);
+    EXPECT_EQ((threaded.vector_view() - serial.vector_view()).norm(), 0.0);
+
+    TensorNetwork plain, parallel;
+    parallel.set_execution_context(ctx);
+    Tensor u({5, 6, 3}, {"c", "e", "a"});
+    u.vector_view() = Eigen::VectorXcd::Random(u.data.size());
+    Tensor v({6, 2, 7}, {"e", "d", "f"});
+    v.vector_view() = Eigen::VectorXcd::Random(v.data.size());
+    for (TensorNetwork* network : {&plain, &parallel}) {
+        network->add_tensor(t, "T");
+        network->add_tensor(u, "U");
+        network->add_tensor(v, "V");
+    }
+    auto pair_serial = plain.contract("T", "U", {"a", "c"});
+    auto pair_threaded = parallel.contract("T", "U", {"a", "c"});
+    EXPECT_NEAR((pair_threaded.vector_view() - pair_serial.vector_view()).norm(), 0.0, 1e-12);
+
+    auto all_serial = plain.contract_all({"T", "U", "V"}, {"b", "f"});
+    auto all_threaded = parallel.contract_all({"T", "U", "V"}, {"b", "f"});
+    EXPECT_NEAR((all_threaded.vector_view() - all_serial.vector_view()).norm(), 0.0, 1e-12);
+
+    // contractions leave the BLAS setting alone
+    EXPECT_EQ(BlasThreads::get(), blas_before);
+}
+
+TEST(TensorNetworkTest, OverlappingBlasScopesRestoreTheOriginal) {
+    const int original = BlasThreads::get();
+    ExecutionConfig config;
+    config.num_threads = 3;
+    ExecutionContext ctx(config);
+    {
+        auto outer = std::make_unique<ExecutionScope>(ctx);
+        EXPECT_EQ(BlasThreads::get(), 3);
+        {
+            BlasThreads pinned(1);
+            EXPECT_EQ(BlasThreads::get(), 1);
+            // the outer scope ends first, as on another thread; the
+            // original comes back only when the last scope closes
+            outer.reset();
+            EXPECT_EQ(BlasThreads::get(), 1);
+        }
+        EXPECT_EQ(BlasThreads::get(), original);
+    }
+    // a serial context does not touch the setting
+    ExecutionScope serial(ExecutionContext::serial());
+    EXPECT_EQ(BlasThreads::get(), original);
+}
+
+TEST(TensorNetworkTest, MixedPrecisionContraction) {
+    ExecutionConfig config;
+    config.precision = Precision::mixed;
+    ExecutionContext mixed(config);
+
+    Tensor t({6, 5, 4}, {"a", "b", "c"});
+    fill(t, 0.3);
+    Tensor u({4, 7, 6}, {"c", "d", "a"});
+    fill(u, -1.2);
+    Tensor full = contract_tensors(t, u, {{0, 2}, {2, 0}});
+    Tensor single = contract_tensors(t, u, {{0, 2}, {2, 0}}, mixed);
+    EXPECT_EQ(single.dimensions, full.dimensions);
+    const double error = (single.vector_view() - full.vector_view()).norm() / full.vector_view().norm();
+    EXPECT_GT(error, 0.0);
+    EXPECT_LT(error, 1e-6);
+
+    // complex<float> tensors contract as cgemms
+    const Tensor narrow_product = widen(
+        contract_tensors(t.cast<std::complex<float>>(), u.cast<std::complex<float>>(), {{0, 2}, {2, 0}}));
+    EXPECT_EQ(narrow_product.indices, full.indices);
+    EXPECT_LT((narrow_product.vector_view() - full.vector_view()).norm() / full.vector_view().norm(), 1e-6);
+
+    // single-precision storage round-trips through a cast
+    BasicTensorData<std::complex<float>> narrow = t.data.cast<std::complex<float>>();
+    EXPECT_EQ(narrow.dimension(2), 4);
+    TensorData wide = narrow.cast<Tensor::Scalar>();
+    EXPECT_NEAR(std::abs(wide(1, 2, 3) - t.data(1, 2, 3)), 0.0, 1e-6 * std::abs(t.data(1, 2, 3)));
+}
+
+TEST(TensorTest, SparseRoundTripAndPermute) {
+    Tensor dense({3, 4, 2}, {"a", "b", "c"});
+    dense.data(0, 1, 0) = {1.0, 2.0};
+    dense.data(2, 3, 1) = -3.0;
+    dense.data(1, 0, 1) = {0.0, 0.5};
+    Tensor sparse = dense.to_sparse();
+    EXPECT_TRUE(sparse.is_sparse());
+    EXPECT_EQ(sparse.nonzeros(), 3);
+    EXPECT_EQ((sparse.to_dense().vector_view() - dense.vector_view()).norm(), 0.0);
+    EXPECT_THROW(sparse.matrix_view(), std::runtime_error);
+
+    Tensor p = permute(sparse, {2, 0, 1});
+    EXPECT_TRUE(p.is_sparse());
+    EXPECT_EQ(p.indices, (std::vector<IndexId>{"c", "a", "b"}));
+    EXPECT_EQ((p.to_dense().vector_view() - permute(dense, {2, 0, 1}).vector_view()).norm(), 0.0);
+    EXPECT_EQ((sparse.conj().to_dense().vector_view() - dense.conj().vector_view()).norm(), 0.0);
+}
+
+TEST(TensorNetworkTest, SparseContractionsMatchDense) {
+    // a sparse rank-3 operator and a rank-2 one, against dense partners
+    Tensor op({4, 3, 4}, {"i", "k", "j"});
+    Eigen::VectorXcd values = Eigen::VectorXcd::Random(op.data.size());
+    for (Eigen::Index x = 0; x < values.size(); ++x) op.data(x) = (x % 5 == 0) ? values(x) : 0.0;
+    Tensor h = Tensor::from_matrix(Eigen::MatrixXcd::Random(4, 4), {"j", "m"});
+    h.data(1, 2) = 0.0;
+    Tensor psi({4, 3}, {"j", "c"});
+    psi.vector_view() = Eigen::VectorXcd::Random(psi.data.size());
+
+    struct Case {
+        const Tensor* t1;
+        const Tensor* t2;
+        std::vector<std::pair<int, int>> pairs;
+    };
+    Tensor psi_t = permute(psi, {1, 0});
+    std::vector<Case> cases = {
+        {&op, &psi, {{2, 0}}},    // sparse x dense
+        {&psi, &op, {{0, 2}}},    // dense x sparse
+        {&op, &psi_t, {{0, 1}}},  // contracting the sparse row index
+        {&h, &psi, {{0, 0}}},     // transposed rank-2 operator
+        {&op, &h, {{2, 0}}},      // sparse x sparse
+        {&h, &h, {{0, 0}, {1, 1}}},
+    };
+    for (const Case& c : cases) {
+        Tensor expected = contract_tensors(c.t1->to_dense(), c.t2->to_dense(), c.pairs);
+        Tensor s1 = c.t1 == &psi || c.t1 == &psi_t ? *c.t1 : c.t1->to_sparse();
+        Tensor s2 = c.t2 == &psi || c.t2 == &psi_t ? *c.t2 : c.t2->to_sparse();
+        Tensor got = contract_tensors(s1, s2, c.pairs);
+        EXPECT_EQ(got.is_sparse(), s1.is_sparse() && s2.is_sparse() && got.rank() > 0);
+        EXPECT_EQ(got.indices, expected.indices);
+        EXPECT_NEAR((got.to_dense().vector_view() - expected.vector_view()).norm(), 0.0, 1e-12);
+    }
+
+    // mixed in a network, through contract_all
+    TensorNetwork network, dense_network;
+    network.add_tensor(op.to_sparse(), "O");
+    dense_network.add_tensor(op, "O");
+    Tensor g = Tensor::from_matrix(Eigen::MatrixXcd::Random(3, 3), {"k", "m"});
+    for (TensorNetwork* n : {&network, &dense_network}) {
+        n->add_tensor(psi, "P");
+        n->add_tensor(g, "G");
+    }
+    auto expected = dense_network.contract_all({"O", "P", "G"}, {"i", "c", "m"});
+    auto mixed = network.contract_all({"O", "P", "G"}, {"i", "c", "m"});
+    EXPECT_NEAR((mixed.vector_view() - expected.vector_view()).norm(), 0.0, 1e-12);
+    EXPECT_LT(network.bytes_in_use(), dense_network.bytes_in_use());
+}
+
+TEST(TensorTest, TraceProduct) {
+    Eigen::MatrixXcd a = Eigen::MatrixXcd::Random(5, 5), b = Eigen::MatrixXcd::Random(5, 5);
+    a(0, 1) = a(3, 2) = 0.0;
+    const std::complex<double> expected = (a * b).trace();
+    EXPECT_NEAR(std::abs(trace_product(Tensor::from_matrix(a), b) - expected), 0.0, 1e-12);
+    EXPECT_NEAR(std::abs(trace_product(Tensor::from_matrix(a).to_sparse(), b) - expected), 0.0, 1e-12);
+}